@@ -0,0 +1,125 @@
+#ifndef ALMACENAMIENTO_H
+#define ALMACENAMIENTO_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Dónde se reflejan las inserciones y eliminaciones del árbol
+enum class TipoAlmacenamiento {
+    Memoria, // Ninguna E/S: el árbol es solo un índice en memoria
+    Sistema, // Escritura síncrona en el directorio cargado
+    Espejo   // Escritura síncrona en otro directorio (p. ej. en tmpfs)
+};
+
+// Backend de almacenamiento. El árbol le pide la ruta de destino de cada
+// ruta relativa y luego le pasa esa ruta para crear o eliminar; el diario de
+// escritura diferida guarda la misma ruta, así que las operaciones deben ser
+// seguras de llamar desde el hilo de volcado
+class Almacenamiento {
+public:
+    virtual ~Almacenamiento() = default;
+    
+    // Ruta donde se refleja 'rutaRelativa' del árbol cargado desde 'directorioBase'
+    virtual string rutaDestino(const string& directorioBase, string_view rutaRelativa) const = 0;
+    
+    // Retornan si la operación tuvo éxito
+    virtual bool crearArchivo(const string& ruta) = 0;
+    virtual bool crearDirectorio(const string& ruta) = 0;
+    virtual bool eliminar(const string& ruta) = 0;
+    
+    // Papelera: un directorio fuera del destino pero en su mismo sistema de
+    // archivos, adonde 'mover' aparta con un rename lo que se borrará en
+    // segundo plano. Vacía si el backend no tiene dónde apartar
+    virtual string rutaPapelera(const string& directorioBase) const { return string(); }
+    virtual bool mover(const string& origen, const string& destino) { return false; }
+    
+    // Renombrar con un solo rename, sin reemplazar: falla si el destino existe
+    virtual bool renombrar(const string& origen, const string& destino) { return false; }
+    
+    // Operaciones relativas a un directorio abierto (ver directorio.h): el
+    // kernel no vuelve a resolver la ruta. abrirDirectorio retorna -1 si el
+    // backend no las tiene; el descriptor lo cierra quien lo abrió
+    virtual int abrirDirectorio(const string& ruta) { return -1; }
+    virtual bool crearArchivoEn(int directorio, const string& nombre) { return false; }
+    virtual bool crearDirectorioEn(int directorio, const string& nombre) { return false; }
+    virtual bool eliminarArchivoEn(int directorio, const string& nombre) { return false; }
+    
+    // false si no hace E/S (no tiene sentido diferirla)
+    virtual bool persistente() const { return true; }
+    
+    virtual TipoAlmacenamiento tipo() const = 0;
+};
+
+// Sin E/S: todas las operaciones tienen éxito de inmediato
+class AlmacenamientoMemoria : public Almacenamiento {
+public:
+    string rutaDestino(const string& directorioBase, string_view rutaRelativa) const override { return string(); }
+    bool crearArchivo(const string& ruta) override { return true; }
+    bool crearDirectorio(const string& ruta) override { return true; }
+    bool eliminar(const string& ruta) override { return true; }
+    bool persistente() const override { return false; }
+    TipoAlmacenamiento tipo() const override { return TipoAlmacenamiento::Memoria; }
+};
+
+// Escritura síncrona en el directorio cargado (el comportamiento original)
+class AlmacenamientoSistema : public Almacenamiento {
+public:
+    string rutaDestino(const string& directorioBase, string_view rutaRelativa) const override;
+    bool crearArchivo(const string& ruta) override;
+    bool crearDirectorio(const string& ruta) override;
+    bool eliminar(const string& ruta) override;
+    string rutaPapelera(const string& directorioBase) const override;
+    bool mover(const string& origen, const string& destino) override;
+    bool renombrar(const string& origen, const string& destino) override;
+    int abrirDirectorio(const string& ruta) override;
+    bool crearArchivoEn(int directorio, const string& nombre) override;
+    bool crearDirectorioEn(int directorio, const string& nombre) override;
+    bool eliminarArchivoEn(int directorio, const string& nombre) override;
+    TipoAlmacenamiento tipo() const override { return TipoAlmacenamiento::Sistema; }
+};
+
+// Escritura síncrona bajo otra raíz, normalmente un directorio en tmpfs:
+// mide el costo de las llamadas al sistema sin el del disco. El espejo solo
+// contiene lo creado después de la carga, así que eliminar o renombrar algo
+// que no está y crear un directorio que ya existe cuentan como éxito
+class AlmacenamientoEspejo : public AlmacenamientoSistema {
+private:
+    string raiz;
+
+public:
+    // Constructor: no toca el sistema de archivos; ver abrir()
+    explicit AlmacenamientoEspejo(const string& raizEspejo);
+    
+    // Crear la raíz si no existe. Avisa por stderr si no está en tmpfs
+    bool abrir();
+    
+    string rutaDestino(const string& directorioBase, string_view rutaRelativa) const override;
+    bool crearDirectorio(const string& ruta) override;
+    bool eliminar(const string& ruta) override;
+    string rutaPapelera(const string& directorioBase) const override;
+    bool renombrar(const string& origen, const string& destino) override;
+    bool crearDirectorioEn(int directorio, const string& nombre) override;
+    bool eliminarArchivoEn(int directorio, const string& nombre) override;
+    TipoAlmacenamiento tipo() const override { return TipoAlmacenamiento::Espejo; }
+    
+    const string& obtenerRaiz() const { return raiz; }
+};
+
+// Raíz por defecto del espejo
+const char* const RAIZ_ESPEJO_POR_DEFECTO = "/dev/shm/arbol_espejo";
+
+// Sufijo del directorio de la papelera, junto al destino
+const char* const SUFIJO_PAPELERA = ".papelera";
+
+// Crear un backend; retorna nullptr si el espejo no se pudo abrir
+unique_ptr<Almacenamiento> crearAlmacenamiento(TipoAlmacenamiento tipo,
+                                               const string& raizEspejo = RAIZ_ESPEJO_POR_DEFECTO);
+
+// Nombre para mostrar ("memoria", "sistema", "espejo") y su inverso
+const char* nombreAlmacenamiento(TipoAlmacenamiento tipo);
+bool tipoAlmacenamientoDesdeNombre(string_view nombre, TipoAlmacenamiento& tipo);
+
+#endif // ALMACENAMIENTO_H
@@ -0,0 +1,139 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+struct NodoArbol;
+struct BloqueHijos;
+
+// Asignador por bloques (bump allocation). La memoria solo se libera en bloque
+// al destruir la arena o al llamar a liberarTodo().
+class Arena {
+private:
+    vector<char*> bloques;
+    char* actual;
+    size_t restante;
+    size_t tamBloque;
+    size_t bytesReservados;
+    size_t bytesUsados;
+
+    void nuevoBloque(size_t minimo);
+
+public:
+    // Constructor
+    explicit Arena(size_t tamBloque = 1 << 20);
+
+    // Destructor
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Reservar memoria cruda alineada
+    void* reservar(size_t bytes, size_t alineacion = alignof(max_align_t));
+
+    // Copiar una cadena dentro de la arena (sin terminador nulo)
+    string_view copiarCadena(string_view cadena);
+
+    // Liberar todos los bloques de una vez
+    void liberarTodo();
+
+    // Tomar posesión de los bloques de otra arena (la otra queda vacía)
+    void absorber(Arena& otra);
+
+    // Estadísticas de memoria
+    size_t obtenerBytesReservados() const { return bytesReservados; }
+    size_t obtenerBytesUsados() const { return bytesUsados; }
+};
+
+// Bytes pedidos al sistema por todas las arenas del proceso, y el máximo
+// alcanzado desde el último reiniciarPicoArenas (contadores atómicos que
+// se actualizan solo al pedir o liberar bloques, no en cada reserva)
+size_t obtenerBytesArenas();
+size_t obtenerPicoArenas();
+void reiniciarPicoArenas();
+
+const int CLASES_HIJOS = 32; // Clases de tamaño de los bloques de hijos
+
+// Nodos y bloques de hijos ya desenlazados, encadenados igual que en las listas
+// libres del almacén. Otro hilo puede armarlo mientras el dueño del almacén
+// sigue trabajando; devolverlo cuesta O(clases), no O(nodos)
+class LoteLibre {
+private:
+    NodoArbol* primerNodo;
+    NodoArbol* ultimoNodo;
+    size_t nodos;
+    void* primerBloque[CLASES_HIJOS];
+    void* ultimoBloque[CLASES_HIJOS];
+
+    friend class AlmacenNodos;
+
+public:
+    // Constructor
+    LoteLibre();
+
+    // Agregar un nodo (sin sus hijos) o un bloque; el bloque vacío compartido se ignora
+    void agregarNodo(NodoArbol* nodo);
+    void agregarBloque(BloqueHijos* bloque);
+
+    // Pasar todo lo de 'otro' a este lote (el otro queda vacío)
+    void unir(LoteLibre& otro);
+
+    size_t obtenerNodos() const { return nodos; }
+};
+
+// Almacén de nodos del árbol: nodos en slabs, nombres en una arena de cadenas
+// y arreglos de hijos reciclados por clase de tamaño (potencias de dos).
+class AlmacenNodos {
+private:
+    Arena arenaNodos;
+    Arena arenaNombres;
+    Arena arenaHijos;
+    NodoArbol* nodosLibres;                 // Lista enlazada intrusiva
+    void* hijosLibres[CLASES_HIJOS];        // Una lista intrusiva por clase
+    size_t nodosVivos;
+    uint64_t generacion;                    // Sello de los bloques que se reservan
+
+public:
+    // Constructor
+    AlmacenNodos();
+
+    AlmacenNodos(const AlmacenNodos&) = delete;
+    AlmacenNodos& operator=(const AlmacenNodos&) = delete;
+
+    // Crear un nodo con su nombre copiado en la arena de cadenas
+    NodoArbol* crearNodo(string_view nombre);
+
+    // Devolver un nodo (sin sus hijos) a la lista libre
+    void liberarNodo(NodoArbol* nodo);
+
+    // Reservar (vacío) o devolver un bloque de hijos de capacidad 2^clase
+    BloqueHijos* reservarHijos(int clase);
+    void liberarHijos(BloqueHijos* bloque);
+
+    // Generación con que se sellan los bloques reservados desde ahora (la del
+    // árbol; con ella se sabe si una instantánea comparte el bloque)
+    void fijarGeneracion(uint64_t nueva) { generacion = nueva; }
+
+    // Devolver de una vez lo encadenado en un lote (que queda vacío)
+    void devolver(LoteLibre& lote);
+
+    // Liberar todo el contenido de golpe
+    void liberarTodo();
+
+    // Adoptar la memoria y las listas libres de otro almacén (el otro queda vacío).
+    // Permite construir subárboles en paralelo con un almacén por hilo.
+    void absorber(AlmacenNodos& otro);
+
+    // Estadísticas de memoria
+    size_t obtenerNodosVivos() const { return nodosVivos; }
+    size_t obtenerBytesReservados() const;
+    size_t obtenerBytesUsados() const;
+};
+
+#endif // ARENA_H
@@ -0,0 +1,117 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "tree.h"
+
+using namespace std;
+
+// Histograma log-lineal de latencias en nanosegundos: cada potencia de dos se
+// divide en 2^BITS_SUBCUBETA cubetas, así que un percentil se reporta con un
+// error relativo menor a 1 / 2^BITS_SUBCUBETA sin guardar las muestras
+class HistogramaLatencias {
+private:
+    static const int BITS_SUBCUBETA = 5;
+    static const int SUBCUBETAS = 1 << BITS_SUBCUBETA;
+    
+    vector<uint64_t> cubetas;
+    uint64_t conteo;
+    uint64_t suma;
+    uint64_t minimo;
+    uint64_t maximo;
+    
+    static size_t cubeta(uint64_t valor);
+    static uint64_t limiteSuperior(size_t indice);
+
+public:
+    // Constructor
+    HistogramaLatencias();
+    
+    void registrar(uint64_t nanosegundos);
+    void fusionar(const HistogramaLatencias& otro);
+    
+    uint64_t obtenerConteo() const { return conteo; }
+    uint64_t obtenerMinimo() const { return conteo == 0 ? 0 : minimo; }
+    uint64_t obtenerMaximo() const { return maximo; }
+    double obtenerMedia() const { return conteo == 0 ? 0.0 : static_cast<double>(suma) / static_cast<double>(conteo); }
+    
+    // Valor bajo el cual cae la fracción 'p' (0..1) de las muestras
+    uint64_t percentil(double p) const;
+};
+
+const size_t TAM_LOTE_BENCHMARK = 1000; // Rutas por llamada a insertarLote
+const size_t MANEJADORES_BENCHMARK = 64; // Directorios abiertos por el escenario 'manejador'
+
+// Parámetros de una corrida; con la misma semilla y los mismos datos se
+// repiten exactamente las mismas operaciones
+struct ConfiguracionBenchmark {
+    string directorio = "datos_pequenos";
+    string salida = "benchmark";   // Prefijo de los archivos .json y .csv
+    uint64_t semilla = 42;
+    int ensayos = 5;                // Ensayos medidos por escenario
+    int calentamiento = 1;          // Ensayos previos que no se registran
+    int operaciones = 100000;       // Búsquedas y listados por ensayo
+    int operacionesEscritura = 10000; // Inserciones y eliminaciones por ensayo (tocan el disco)
+    int hilos = 1;                  // Hilos para la carga
+    TipoAlmacenamiento almacenamiento = TipoAlmacenamiento::Sistema; // Destino de las escrituras
+    string raizEspejo = RAIZ_ESPEJO_POR_DEFECTO;
+};
+
+// Resultado de un escenario: las latencias de todos los ensayos medidos y la
+// duración total de cada ensayo
+struct ResultadoEscenario {
+    string nombre;
+    string unidad;                  // Qué mide cada muestra del histograma
+    HistogramaLatencias latencias;
+    vector<double> segundosPorEnsayo;
+};
+
+// Banco de pruebas del árbol: carga el directorio y ejecuta los escenarios
+// (carga, búsqueda, búsqueda con índice, inserción, eliminación, inserción por
+// lotes y recorrido) con calentamiento y ensayos repetidos
+class BancoPruebas {
+private:
+    ConfiguracionBenchmark configuracion;
+    ArbolSistemaArchivos arbol;
+    mt19937_64 generador;
+    vector<string> rutas;           // Todas las rutas, en orden lexicográfico
+    vector<string> directorios;
+    vector<ResultadoEscenario> resultados;
+    double sobrecargaReloj;         // ns que cuesta tomar una marca de tiempo
+    
+    static uint64_t ahora();
+    static double medirSobrecargaReloj();
+    
+    // Ejecutar 'ensayo' con calentamiento y registrar los ensayos medidos
+    template <typename Ensayo>
+    void ejecutarEscenario(const string& nombre, const string& unidad, Ensayo ensayo);
+    
+    void escenarioCarga();
+    void escenarioBusqueda(const string& nombre, bool conIndice);
+    void escenarioSucinto();
+    void escenarioInsercionEliminacion();
+    void escenarioInsercionLote();
+    void escenarioManejadores();
+    void escenarioRecorrido();
+    
+    vector<string> rutasNuevas(int cantidad, int ensayo);
+
+public:
+    // Constructor
+    explicit BancoPruebas(const ConfiguracionBenchmark& config);
+    
+    // Ejecutar todos los escenarios. Retorna false si el directorio no existe
+    // o si no se pudo abrir el almacenamiento pedido
+    bool ejecutar();
+    
+    // Escribir los resultados (<salida>.json y <salida>.csv)
+    bool escribirJson(const string& archivo) const;
+    bool escribirCsv(const string& archivo) const;
+    void imprimirResumen() const;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,76 @@
+#ifndef CONTADORES_H
+#define CONTADORES_H
+
+#include <cstdint>
+
+using namespace std;
+
+// Contadores de la ruta caliente del árbol, por hilo. Solo se compilan con
+// -DCONTADORES_ARBOL (make CONTADORES=1, después de un make clean); sin eso
+// CONTAR no genera código y leerContadores retorna todo en cero
+struct ContadoresArbol {
+    uint64_t nodosVisitados = 0;  // Nodos por los que baja una búsqueda
+    uint64_t comparaciones = 0;   // Comparaciones de nombres completos (los empates de prefijo)
+    uint64_t reservas = 0;        // Nodos y bloques de hijos pedidos al almacén
+    uint64_t llamadasSistema = 0; // Operaciones que llegan al sistema de archivos
+};
+
+#ifdef CONTADORES_ARBOL
+extern thread_local ContadoresArbol contadoresHilo;
+#define CONTAR(campo) (++contadoresHilo.campo)
+#define CONTAR_N(campo, n) (contadoresHilo.campo += (n))
+#else
+#define CONTAR(campo) ((void)0)
+#define CONTAR_N(campo, n) ((void)0)
+#endif
+
+// Si los contadores están compilados
+constexpr bool contadoresCompilados() {
+#ifdef CONTADORES_ARBOL
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Contadores del hilo actual desde el último reinicio
+ContadoresArbol leerContadores();
+void reiniciarContadores();
+
+// Lectura de los contadores de hardware de una fase
+struct LecturaHardware {
+    bool disponible = false;
+    uint64_t ciclos = 0;
+    uint64_t instrucciones = 0;
+    uint64_t fallosCache = 0; // Fallos del último nivel de caché
+    uint64_t fallosRama = 0;
+};
+
+// Contadores de hardware con perf_event_open: ciclos, instrucciones, fallos
+// de LLC y de predicción de saltos en modo usuario, del hilo que lo crea y de
+// los que ese hilo cree después. Si el kernel no los ofrece (máquinas
+// virtuales, perf_event_paranoid alto) queda no disponible y las lecturas
+// vienen vacías
+class ContadoresHardware {
+private:
+    static const int NUM_EVENTOS = 4;
+    int descriptores[NUM_EVENTOS];
+
+public:
+    // Constructor: abre los eventos, detenidos
+    ContadoresHardware();
+    ~ContadoresHardware();
+    
+    ContadoresHardware(const ContadoresHardware&) = delete;
+    ContadoresHardware& operator=(const ContadoresHardware&) = delete;
+    
+    bool disponible() const { return descriptores[0] >= 0; }
+    
+    // Poner en cero y empezar a contar
+    void iniciar();
+    
+    // Dejar de contar y leer lo acumulado desde iniciar
+    LecturaHardware detener();
+};
+
+#endif // CONTADORES_H
@@ -0,0 +1,87 @@
+#ifndef DIARIO_H
+#define DIARIO_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Operación del sistema de archivos pendiente de aplicar
+enum class TipoOperacion : uint8_t {
+    CrearArchivo = 1,
+    CrearDirectorio = 2,
+    Eliminar = 3,
+    Mover = 4
+};
+
+struct OperacionDiario {
+    TipoOperacion tipo;
+    string ruta;    // Ruta completa en el sistema de archivos
+    string destino; // Solo en Mover: adónde se renombra 'ruta'
+};
+
+// Diario de rehacer para escritura diferida. Las operaciones se encolan en
+// memoria; un hilo de volcado las escribe en lote al archivo del diario
+// (registros tipo | longitud | ruta, y en Mover además longitud | destino),
+// hace fdatasync, las aplica en orden y vacía el diario. Al abrirlo se
+// reaplican los registros que hayan quedado de una ejecución interrumpida;
+// las operaciones son idempotentes.
+// Durabilidad: sincronizar() es el único punto en que lo encolado es durable.
+// agregar() no escribe nada; una operación llega al archivo recién cuando el
+// hilo de volcado toma su lote, así que cualquier operación encolada después
+// del último sincronizar() que retornó puede perderse si el proceso cae. El
+// archivo solo protege el lote que se está aplicando en ese momento.
+// Un lote que no se pudo escribir o un diario que no se pudo vaciar cuentan
+// como fallas para sincronizar()
+class Diario {
+public:
+    using Aplicador = function<bool(const OperacionDiario&)>;
+
+private:
+    Aplicador aplicar;
+    int fd;
+    thread volcador;
+    mutex cerrojo;
+    condition_variable hayTrabajo;
+    condition_variable aplicadas;
+    vector<OperacionDiario> pendientes;
+    uint64_t totalAgregadas;
+    uint64_t totalAplicadas;
+    size_t fallidas; // Desde el último sincronizar()
+    bool detener;
+
+    size_t reproducir();
+    bool escribirLote(const vector<OperacionDiario>& lote);
+    void volcar();
+
+public:
+    // Constructor: 'aplicar' ejecuta una operación y retorna si tuvo éxito
+    explicit Diario(Aplicador aplicar);
+
+    // Destructor: aplica lo pendiente y detiene el hilo
+    ~Diario();
+
+    Diario(const Diario&) = delete;
+    Diario& operator=(const Diario&) = delete;
+
+    // Abrir (o crear) el archivo, reaplicar lo que tenga y lanzar el volcado
+    bool abrir(const string& archivo);
+
+    // Encolar una operación (no bloquea por E/S ni la hace durable)
+    void agregar(TipoOperacion tipo, string ruta, string destino = string());
+
+    // Esperar a que todo lo encolado esté aplicado: el único punto de durabilidad.
+    // Retorna false si alguna operación falló desde la última sincronización,
+    // o si el diario no pudo registrarla o vaciarse
+    bool sincronizar();
+
+    // Sincronizar, detener el volcado y cerrar el archivo
+    void cerrar();
+};
+
+#endif // DIARIO_H
@@ -0,0 +1,62 @@
+#ifndef DIRECTORIO_H
+#define DIRECTORIO_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "indice.h"
+#include "tree.h"
+
+using namespace std;
+
+// Manejador de un directorio del árbol, resuelto una sola vez: buscarEn,
+// insertarEn y eliminarEn trabajan con nombres relativos a él sin volver a
+// recorrer la ruta, y en el almacenamiento con un descriptor abierto del
+// directorio (openat, mkdirat, unlinkat) en vez de rutas completas. El
+// descriptor queda abierto mientras vive el manejador; si el árbol ya tiene
+// MAXIMO_DESCRIPTORES_MANEJADORES abiertos, el manejador no tiene y usa rutas.
+// El árbol registra los manejadores vivos: al mover su directorio (o un
+// ancestro) les anota la ruta nueva, y al eliminarlo, revertirlo o recargar el
+// árbol los marca como desenlazados. Cuando los nodos solo se copian (por una
+// instantánea o al compactar), el siguiente uso los vuelve a buscar por la ruta
+// y conserva el descriptor. Un manejador desenlazado queda inválido en su
+// siguiente uso y nunca pasa a otro directorio creado en la misma ruta. Se usa
+// desde un solo hilo y debe destruirse antes que el árbol
+class DirectorioAbierto {
+private:
+    ArbolSistemaArchivos* arbol = nullptr;
+    string ruta;                  // Ruta relativa normalizada ("" es la raíz)
+    vector<NodoArbol*> ancestros; // Desde la raíz hasta el directorio
+    HashRuta huella{};            // Huella de 'ruta' para el índice
+    uint64_t version = 0;         // versionDirectorios del árbol al resolverlo
+    int fd = -1;                  // Descriptor del directorio (-1 si no hay)
+    
+    // Los escribe el árbol con cerrojoManejadores y se aplican al resolverlo
+    string rutaMovida;            // Ruta nueva si 'movido'
+    bool movido = false;
+    bool desenlazado = false;
+    
+    void cerrar();
+    void soltar();
+    void tomar(DirectorioAbierto& otro);
+    
+    friend class ArbolSistemaArchivos;
+
+public:
+    DirectorioAbierto() = default;
+    
+    // Destructor: cierra el descriptor
+    ~DirectorioAbierto();
+    
+    DirectorioAbierto(const DirectorioAbierto&) = delete;
+    DirectorioAbierto& operator=(const DirectorioAbierto&) = delete;
+    DirectorioAbierto(DirectorioAbierto&& otro) noexcept;
+    DirectorioAbierto& operator=(DirectorioAbierto&& otro) noexcept;
+    
+    // false si nunca existió o si el árbol lo invalidó al volver a resolverlo
+    bool valido() const { return arbol != nullptr; }
+    const string& obtenerRuta() const { return ruta; }
+    bool tieneDescriptor() const { return fd >= 0; }
+};
+
+#endif // DIRECTORIO_H
@@ -0,0 +1,39 @@
+#ifndef EPOCAS_H
+#define EPOCAS_H
+
+#include <cstdint>
+
+using namespace std;
+
+// Reclamación diferida por épocas para lectores sin cerrojos.
+// Cada lector anuncia en su ranura la época global vigente al entrar y la
+// limpia al salir. Un escritor que desenlaza memoria la etiqueta con avanzar()
+// y solo puede liberarla cuando minimaActiva() es mayor que esa etiqueta:
+// ningún lector que pudiera haberla visto sigue activo.
+class Epocas {
+public:
+    static const int MAX_LECTORES = 256; // Hilos lectores registrados a la vez
+
+    // Etiqueta para lo recién desenlazado (y avanza la época global)
+    static uint64_t avanzar();
+
+    // Menor época anunciada por un lector activo (UINT64_MAX si no hay)
+    static uint64_t minimaActiva();
+};
+
+// Sección de lectura: mientras existe, nada de lo que el hilo pueda alcanzar
+// se libera. Se puede anidar dentro del mismo hilo (p. ej. buscar mientras un
+// recorrido sigue abierto); solo la más externa anuncia la época
+class GuardiaLectura {
+private:
+    int ranura;
+
+public:
+    GuardiaLectura();
+    ~GuardiaLectura();
+
+    GuardiaLectura(const GuardiaLectura&) = delete;
+    GuardiaLectura& operator=(const GuardiaLectura&) = delete;
+};
+
+#endif // EPOCAS_H
@@ -2,30 +2,65 @@
 #define EXPERIMENTACION_H
 
 #include <vector>
+#include <random>
 #include <string>
+#include <utility>
+#include "contadores.h"
 #include "tree.h"    
 using namespace std;
 
 // Constantes para la experimentación
 const int REP = 100000;
 const int DIRECTORIOS_INSERCION = 2000;
+const int CAMBIOS_VIGILANCIA = 10000; // Por debajo de max_queued_events (16384)
+const size_t MUESTRA_RUTAS = 1 << 20;  // Rutas de las que se eligen las pruebas
+const uint64_t SEMILLA_EXPERIMENTOS = 42; // Misma secuencia de rutas en cada corrida
+
+// Contadores de una fase medida, en total (se reportan por operación)
+struct MetricasFase {
+    string nombre;
+    double operaciones;
+    LecturaHardware hardware;
+    ContadoresArbol arbol; // En cero si no se compilaron (make CONTADORES=1)
+};
 
 // Estructuras para almacenar resultados
 struct ResultadoExperimento {
     int tamaño;
+    AgregadosSubarbol forma; // Archivos, directorios y altura del árbol cargado
+    InformeMemoria memoria;  // Del árbol recién cargado
     double tiempoCreacion;
+    double tiempoAperturaImagen;
     double tiempoPromedioBusqueda;
+    double tiempoPromedioBusquedaIndice;
+    double tiempoPromedioBusquedaLote;
     double tiempoPromedioEliminacion;
     double tiempoPromedioInsercion;
+    double tiempoPromedioMovimiento; // De un directorio completo a otro padre
+    double tiempoPromedioInsercionLote;
+    double tiempoPromedioInsercionDiferida;
+    double tiempoPromedioSincronizacion; // Por evento externo aplicado con inotify
+    vector<pair<int, double>> escalabilidadCreacion; // (hilos, segundos) de la carga paralela
+    vector<pair<int, double>> lecturasConcurrentes;  // (hilos lectores, millones de búsquedas/s)
+    vector<MetricasFase> fases;
 };
 
 // Clase para manejar los experimentos
 class ExperimentacionArbol {
 private:
     ArbolSistemaArchivos* arbol;
-    vector<string> rutasDisponibles;
+    vector<string> rutasDisponibles; // Muestra de las rutas del árbol
+    mt19937_64 generador;
+    ContadoresHardware hardware;
+    vector<MetricasFase> fases; // Las del experimento en curso
+    
+    // Contar solo la región que se cronometra: empezarFase justo antes de tomar
+    // el tiempo y terminarFase justo después
+    void empezarFase();
+    void terminarFase(const char* nombre, double operaciones);
     
     // Funciones auxiliares
+    void muestrearRutas();
     vector<string> seleccionarRutasAleatorios(int cantidad);
     vector<string> seleccionarDirectoriosAleatorios(int cantidad);
     void generarDatos(int numDirectorios, int numArchivos, const string& directorio);
@@ -42,9 +77,17 @@ public:
     
     // Experimentos individuales
     double medirTiempoCreacion(const string& directorio);
-    double medirTiempoBusqueda(int repeticiones);
+    vector<pair<int, double>> medirEscalabilidadCreacion(const string& directorio);
+    double medirTiempoAperturaImagen(const string& directorio);
+    double medirTiempoBusqueda(int repeticiones, const char* fase = "busqueda");
+    double medirTiempoBusquedaLote(int repeticiones);
     double medirTiempoEliminacion(int repeticiones);
-    double medirTiempoInsercion(int repeticiones);
+    double medirTiempoInsercion(int repeticiones, const char* fase = "insercion");
+    double medirTiempoMovimiento(int repeticiones);
+    double medirTiempoInsercionLote(int repeticiones);
+    double medirTiempoInsercionDiferida(int repeticiones, const string& directorio);
+    double medirTiempoSincronizacion(int cambios);
+    vector<pair<int, double>> medirLecturasConcurrentes(int repeticiones);
     
     // Generar reportes
     void generarReporte(const vector<ResultadoExperimento>& resultados);
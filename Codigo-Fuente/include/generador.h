@@ -0,0 +1,63 @@
+#ifndef GENERADOR_H
+#define GENERADOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Extensiones de los archivos generados (las de create_files.bash)
+const char* const EXTENSIONES_GENERADAS[] = {".txt", ".csv", ".cpp", ".c", ".json", ".xml",
+                                             ".md", ".rs", ".py", ".js", ".lua"};
+
+// Forma del conjunto de datos: como create_files.bash, se recorre por niveles
+// y cada directorio recibe de 0 a maxSubdirectorios subdirectorios y unos
+// archivos/directorios archivos (entre -variacion y +2*variacion de diferencia)
+struct ParametrosDatos {
+    int directorios = 20000;      // Incluye el directorio raíz
+    int archivos = 200000;
+    uint64_t semilla = 42;
+    int maxSubdirectorios = 10;
+    int variacionArchivos = 1;
+};
+
+// Plan determinista del árbol: depende solo de los parámetros, no del orden
+// en que los hilos lo creen. Solo guarda los directorios; los archivos de
+// cada uno son un rango de números consecutivos ("file_<n><ext>") y la
+// extensión sale de un hash de la semilla y el número
+class PlanDatos {
+public:
+    struct Directorio {
+        uint32_t numero;        // "dir_<numero>"; la raíz es el 1
+        uint32_t primerHijo;    // Los subdirectorios son consecutivos en el plan
+        uint32_t numHijos;
+        uint32_t numArchivos;
+        uint64_t primerArchivo;
+    };
+
+private:
+    vector<Directorio> directorios; // En orden por niveles; [0] es la raíz
+    uint64_t semilla;
+    uint64_t totalArchivos;
+
+public:
+    // Constructor: planifica con un mt19937_64 sembrado con parametros.semilla
+    explicit PlanDatos(const ParametrosDatos& parametros);
+    
+    const vector<Directorio>& obtenerDirectorios() const { return directorios; }
+    uint64_t obtenerTotalArchivos() const { return totalArchivos; }
+    
+    // Escribir el nombre en 'nombre' (se reutiliza el buffer)
+    void nombreArchivo(uint64_t numero, string& nombre) const;
+    static void nombreDirectorio(uint32_t numero, string& nombre);
+};
+
+// Crear el plan bajo 'directorio' (que se borra antes) con 'numHilos' hilos.
+// En Linux cada directorio se abre con openat relativo a la raíz (su ruta
+// completa desde ella) y sus archivos y subdirectorios se crean con
+// openat/mkdirat relativos a ese descriptor.
+// Retorna false si algo no se pudo crear
+bool generarEnDisco(const PlanDatos& plan, const string& directorio, int numHilos);
+
+#endif // GENERADOR_H
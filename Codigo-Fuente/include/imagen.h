@@ -0,0 +1,88 @@
+#ifndef IMAGEN_H
+#define IMAGEN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Formato binario de la imagen persistida del árbol (versión IMAGEN_VERSION):
+//   CabeceraImagen | NodoImagen[numNodos] | nombres[bytesNombres] | directorioBase
+// Los nodos están en orden por niveles (BFS): el nodo 0 es la raíz y los hijos
+// de cada nodo son contiguos y ya están ordenados, así que la tabla se usa tal
+// cual desde el mmap, sin interpretar nodo por nodo.
+const char IMAGEN_MAGIA[8] = {'K', 'A', 'R', 'Y', 'I', 'M', 'G', '\0'};
+const uint32_t IMAGEN_VERSION = 2;
+
+struct CabeceraImagen {
+    char magia[8];
+    uint32_t version;
+    uint32_t tamNodo;        // sizeof(NodoImagen), detecta cambios de layout
+    uint64_t numNodos;
+    uint64_t bytesNombres;
+    uint64_t bytesBase;      // Longitud de la ruta absoluta del directorio base
+    // Identidad del directorio base al guardar (para detectar imágenes viejas)
+    uint64_t dispositivo;
+    uint64_t inodo;
+    int64_t mtimeSeg;
+    int64_t mtimeNs;
+};
+
+// Banderas de NodoImagen
+const uint16_t NODO_IMAGEN_DIRECTORIO = 1; // Directorio (aunque no tenga hijos)
+
+struct NodoImagen {
+    uint64_t nombre;      // Desplazamiento en el bloque de nombres
+    uint16_t longitud;    // Longitud del nombre (NAME_MAX cabe de sobra)
+    uint16_t banderas;
+    uint32_t numHijos;
+    uint64_t primerHijo;  // Índice del primer hijo en la tabla de nodos
+};
+
+// Vista de solo lectura sobre una imagen mapeada en memoria
+class ImagenArbol {
+private:
+    void* mapa;
+    size_t tamMapa;
+    const CabeceraImagen* cabecera;
+    const NodoImagen* nodos;
+    const char* nombres;
+    
+    void cerrar();
+    int64_t buscarHijo(const NodoImagen& padre, string_view nombre) const;
+    
+public:
+    // Constructor
+    ImagenArbol();
+    
+    // Destructor: libera el mapeo
+    ~ImagenArbol();
+    
+    ImagenArbol(const ImagenArbol&) = delete;
+    ImagenArbol& operator=(const ImagenArbol&) = delete;
+    
+    // Mapear el archivo y validar su estructura. Retorna false si no es una imagen válida
+    bool abrir(const string& archivo);
+    
+    // Verificar que la imagen corresponde al directorio y que este no cambió
+    // (misma ruta, dispositivo, inodo y mtime). Solo detecta cambios directos del
+    // directorio base: los cambios en niveles más profundos no alteran su mtime
+    bool esVigente(const string& directorioAbsoluto) const;
+    
+    // Índice del nodo de la ruta relativa, o -1 si no existe
+    int64_t buscarNodo(string_view ruta) const;
+    
+    // Acceso a la tabla
+    size_t obtenerNumeroNodos() const { return static_cast<size_t>(cabecera->numNodos); }
+    const NodoImagen& nodo(size_t indice) const { return nodos[indice]; }
+    string_view nombre(const NodoImagen& n) const { return string_view(nombres + n.nombre, n.longitud); }
+    string_view directorioBase() const;
+    size_t obtenerBytes() const { return tamMapa; }
+    
+    // Llenar la identidad (dispositivo, inodo, mtime) de un directorio en la cabecera
+    static bool leerIdentidad(const string& directorio, CabeceraImagen& cab);
+};
+
+#endif // IMAGEN_H
@@ -0,0 +1,77 @@
+#ifndef INDICE_H
+#define INDICE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+struct NodoArbol;
+
+// Huella de 128 bits de una ruta normalizada ("a/b/c", sin barras repetidas).
+// Se calcula incrementalmente, componente a componente, para poder extender la
+// huella del padre al recorrer un subárbol sin construir cadenas.
+struct HashRuta {
+    uint64_t a;
+    uint64_t b;
+    
+    bool operator==(const HashRuta& otro) const { return a == otro.a && b == otro.b; }
+};
+
+// Huella de la ruta vacía (la raíz)
+const HashRuta HASH_RAIZ = {0xcbf29ce484222325ULL, 0x9e3779b97f4a7c15ULL};
+
+// Agregar un componente a la huella de su directorio padre
+HashRuta extenderHash(HashRuta padre, string_view nombre, bool esRaiz);
+
+// Huella de una ruta completa. Deja en 'ultimo' su último componente
+HashRuta hashRuta(string_view ruta, string_view& ultimo);
+
+// Índice secundario de rutas completas: tabla hash de direccionamiento abierto
+// (sondeo lineal, borrado por desplazamiento hacia atrás) de huella a nodo.
+// La huella de 128 bits hace despreciable la probabilidad de colisión; además
+// quien consulta verifica el último componente contra el nombre del nodo.
+class IndiceRutas {
+private:
+    struct Entrada {
+        HashRuta huella;
+        NodoArbol* nodo; // nullptr = casilla vacía
+    };
+    
+    vector<Entrada> tabla;
+    size_t ocupadas;
+    
+    size_t casilla(const HashRuta& huella) const { return static_cast<size_t>(huella.a) & (tabla.size() - 1); }
+    void crecer();
+    
+public:
+    // Constructor
+    IndiceRutas();
+    
+    // Reservar espacio para al menos 'cantidad' rutas
+    void reservar(size_t cantidad);
+    
+    // Asociar la huella al nodo (reemplaza si ya existía)
+    void insertar(const HashRuta& huella, NodoArbol* nodo);
+    
+    // Nodo asociado a la huella, o nullptr
+    NodoArbol* buscar(const HashRuta& huella) const;
+    
+    // Pedir de antemano la casilla de la huella (para buscarla poco después)
+    void precargar(const HashRuta& huella) const {
+        if (!tabla.empty()) __builtin_prefetch(&tabla[casilla(huella)]);
+    }
+    
+    // Quitar la huella si existe
+    void eliminar(const HashRuta& huella);
+    
+    // Vaciar y liberar la tabla
+    void limpiar();
+    
+    size_t obtenerTamaño() const { return ocupadas; }
+    size_t obtenerBytes() const { return tabla.capacity() * sizeof(Entrada); }
+};
+
+#endif // INDICE_H
@@ -0,0 +1,52 @@
+#ifndef INSTANTANEA_H
+#define INSTANTANEA_H
+
+#include <cstdint>
+#include <string_view>
+#include "tree.h"
+
+using namespace std;
+
+// Vista de solo lectura del árbol tal como estaba al tomarla. Tomarla es O(1):
+// no copia nada, y desde entonces el árbol copia cada nodo compartido antes de
+// modificarlo (copia de caminos), así que un cambio cuesta O(profundidad)
+// bloques nuevos la primera vez que toca un camino. Puede leerse desde otro
+// hilo mientras el árbol se modifica, pero debe liberarse (o destruirse) en el
+// hilo que escribe y antes que el árbol
+class Instantanea {
+private:
+    ArbolSistemaArchivos* arbol = nullptr;
+    NodoArbol* raiz = nullptr;
+    uint64_t generacion = 0;
+    
+    Instantanea(ArbolSistemaArchivos* a, NodoArbol* r, uint64_t g) : arbol(a), raiz(r), generacion(g) {}
+    
+    friend class ArbolSistemaArchivos;
+
+public:
+    Instantanea() = default;
+    
+    // Destructor: libera la instantánea si sigue viva
+    ~Instantanea();
+    
+    Instantanea(const Instantanea&) = delete;
+    Instantanea& operator=(const Instantanea&) = delete;
+    Instantanea(Instantanea&& otra) noexcept;
+    Instantanea& operator=(Instantanea&& otra) noexcept;
+    
+    bool valida() const { return arbol != nullptr; }
+    uint64_t obtenerGeneracion() const { return generacion; }
+    
+    // Soltar la vista: el árbol libera lo que ya no ve ninguna instantánea
+    void liberar();
+    
+    // Las mismas consultas que el árbol, sobre el estado de la instantánea
+    // Retorna: 0 si existe el archivo, 1 si no existe, 2 si es un directorio
+    int buscar(string_view ruta) const;
+    RangoHijos listarDirectorio(string_view ruta) const;
+    Recorrido recorrerSubarbol(string_view ruta) const;
+    bool obtenerAgregados(string_view ruta, AgregadosSubarbol& agregados) const;
+    int obtenerNumeroNodos() const;
+};
+
+#endif // INSTANTANEA_H
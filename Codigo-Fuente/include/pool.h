@@ -0,0 +1,48 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// Pool de hilos con robo de trabajo. Cada hilo tiene su propia cola: toma
+// tareas del final de la suya y, si está vacía, roba del frente de las demás.
+// Las tareas reciben el índice del hilo que las ejecuta y pueden agregar más.
+class PoolTrabajo {
+public:
+    using Tarea = function<void(int)>;
+
+private:
+    struct Cola {
+        mutex cerrojo;
+        deque<Tarea> tareas;
+    };
+
+    vector<unique_ptr<Cola>> colas;
+    atomic<size_t> pendientes; // Tareas agregadas y aún no terminadas
+
+    bool tomarTarea(int idHilo, Tarea& tarea);
+    void trabajar(int idHilo);
+
+public:
+    // Constructor (al menos un hilo)
+    explicit PoolTrabajo(int numHilos);
+
+    PoolTrabajo(const PoolTrabajo&) = delete;
+    PoolTrabajo& operator=(const PoolTrabajo&) = delete;
+
+    // Agregar una tarea a la cola del hilo indicado
+    void agregar(int idHilo, Tarea tarea);
+
+    // Ejecutar hasta que no queden tareas pendientes (el hilo llamador es el hilo 0)
+    void ejecutar();
+
+    int obtenerNumHilos() const { return static_cast<int>(colas.size()); }
+};
+
+#endif // POOL_H
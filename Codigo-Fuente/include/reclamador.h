@@ -0,0 +1,71 @@
+#ifndef RECLAMADOR_H
+#define RECLAMADOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "arena.h"
+
+using namespace std;
+
+// Reclamación en segundo plano de subárboles ya desenlazados. Un hilo recorre
+// cada subárbol sin recursión y encadena sus nodos y bloques en un LoteLibre,
+// y borra del disco lo que el árbol apartó a la papelera. El dueño del almacén
+// recoge los lotes terminados cuando le conviene (el almacén no es compartido)
+class Reclamador {
+public:
+    using Eliminador = function<bool(const string&)>;
+
+private:
+    struct Tarea {
+        NodoArbol* subarbol; // Subárbol desenlazado (o nullptr)
+        string apartado;     // Ruta en la papelera para borrar (o vacía)
+    };
+
+    Eliminador eliminar;
+    thread trabajador;
+    mutex cerrojo;
+    condition_variable hayTrabajo;
+    condition_variable terminadas;
+    vector<Tarea> pendientes;
+    LoteLibre listos;             // Lo desarmado que falta recoger
+    atomic<bool> hayListos;
+    uint64_t totalEncoladas;
+    uint64_t totalTerminadas;
+    size_t fallidas;              // Borrados fallidos desde el último drenar()
+    bool detener;
+
+    void trabajar();
+
+public:
+    // Constructor: lanza el hilo. 'eliminar' borra una ruta apartada
+    explicit Reclamador(Eliminador eliminar);
+
+    // Destructor: termina lo encolado y detiene el hilo. Lo que no se haya
+    // recogido se descarta (el almacén debe liberarse entero después)
+    ~Reclamador();
+
+    Reclamador(const Reclamador&) = delete;
+    Reclamador& operator=(const Reclamador&) = delete;
+
+    // Encolar un subárbol, una ruta apartada o ambos (no bloquea)
+    void encolar(NodoArbol* subarbol, string apartado);
+
+    // Devolver al almacén lo ya desarmado; O(clases) si hay algo, O(1) si no.
+    // Solo desde el hilo dueño del almacén
+    void recoger(AlmacenNodos& almacen);
+
+    // Esperar a que termine todo lo encolado. Retorna false si algún borrado
+    // falló desde el último drenar()
+    bool drenar();
+
+    // Tareas encoladas que aún no terminan
+    size_t obtenerPendientes();
+};
+
+#endif // RECLAMADOR_H
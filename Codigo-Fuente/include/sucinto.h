@@ -0,0 +1,99 @@
+#ifndef SUCINTO_H
+#define SUCINTO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Vector de bits de solo agregar, con select de ceros: un conteo acumulado de
+// ceros por superbloque de 512 bits y, cada MUESTRA_CEROS ceros, el
+// superbloque donde cae, para acotar la búsqueda binaria a unos pocos
+class VectorBits {
+private:
+    static const size_t PALABRAS_SUPERBLOQUE = 8;
+    static const size_t MUESTRA_CEROS = 4096;
+    
+    vector<uint64_t> palabras;
+    vector<uint64_t> cerosAntes;   // Ceros antes de cada superbloque (y el total al final)
+    vector<uint32_t> muestras;     // Superbloque del cero número j * MUESTRA_CEROS
+    size_t tam = 0;
+
+public:
+    void agregar(bool bit);
+    
+    // Construir el directorio de select. Después no se puede agregar
+    void terminar();
+    
+    bool leer(size_t i) const { return (palabras[i / 64] >> (i % 64)) & 1; }
+    size_t size() const { return tam; }
+    
+    // Posición del k-ésimo cero (desde 0); k debe ser menor que la cantidad de ceros
+    size_t seleccionarCero(size_t k) const;
+    
+    // Posición del primer cero desde 'desde', sabiendo que es el k-ésimo: casi
+    // siempre está en la misma palabra y no hace falta el select
+    size_t siguienteCero(size_t desde, size_t k) const;
+    
+    size_t obtenerBytes() const;
+};
+
+// Nodos por bloque de nombres: una búsqueda decodifica a lo sumo uno
+const size_t TAM_BLOQUE_SUCINTO = 16;
+
+// Representación congelada del árbol para réplicas que solo buscan. Los nodos
+// se numeran en orden por niveles (BFS), como en la imagen:
+//   - Topología LOUDS: por cada nodo, un 1 por hijo y un 0. Los hijos del
+//     nodo v son contiguos y empiezan en el id p - v + 1, con p la posición
+//     que sigue al cero v - 1, así que basta con select de ceros (sin punteros)
+//   - Un bit por nodo que distingue los directorios (vacíos o no) de los archivos
+//   - Nombres con codificación frontal en bloques de TAM_BLOQUE_SUCINTO nodos
+//     consecutivos: cada nombre guarda el largo del prefijo común con el
+//     anterior y el resto. Los hermanos son contiguos y ya vienen ordenados,
+//     así que comparten prefijos largos; el primero de cada bloque y el primero
+//     de cada grupo de hermanos van completos, para poder buscar sin decodificar
+//     desde el inicio del directorio
+// Cuesta unos 3 bits por nodo más los nombres comprimidos. No se modifica:
+// puede consultarse desde muchos hilos a la vez
+class ArbolSucinto {
+private:
+    VectorBits topologia;
+    vector<uint64_t> esDirectorio; // Un bit por nodo
+    vector<char> nombres;          // Entradas: varint prefijo, varint largo, bytes
+    vector<uint64_t> bloques;      // Inicio en 'nombres' de cada bloque
+    size_t numNodos = 0;
+    string anterior;               // Último nombre agregado (solo al construir)
+    
+    // Construcción (desde ArbolSistemaArchivos::congelar), nodo por nodo en BFS
+    void agregar(string_view nombre, size_t numHijos, bool directorio, bool primeroDeHermanos);
+    void terminar();
+    
+    bool directorio(size_t v) const { return (esDirectorio[v / 64] >> (v % 64)) & 1; }
+    
+    // Nombre completo del primer nodo del bloque (siempre codificado entero)
+    string_view cabeza(size_t bloque) const;
+    
+    // Id del hijo de 'v' con ese nombre, o -1
+    int64_t buscarHijo(size_t v, string_view nombre) const;
+    
+    friend class ArbolSistemaArchivos;
+
+public:
+    ArbolSucinto() = default;
+    ArbolSucinto(ArbolSucinto&&) = default;
+    ArbolSucinto& operator=(ArbolSucinto&&) = default;
+    
+    // Retorna: 0 si existe el archivo, 1 si no existe, 2 si es un directorio
+    int buscar(string_view ruta) const;
+    
+    // Nodos sin contar la raíz, como ArbolSistemaArchivos::obtenerNumeroNodos
+    size_t obtenerNumeroNodos() const { return numNodos == 0 ? 0 : numNodos - 1; }
+    
+    // Memoria ocupada por todas las estructuras (bytes)
+    size_t obtenerBytes() const;
+};
+
+#endif // SUCINTO_H
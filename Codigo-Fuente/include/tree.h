@@ -1,77 +1,709 @@
 #ifndef TREE_H
 #define TREE_H
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstdint>
 #include <filesystem> 
+#include <memory>
+#include <unordered_set>
+#include "almacenamiento.h"
+#include "arena.h"
+#include "epocas.h"
+#include "indice.h"
 
 using namespace std;
 
+class PoolTrabajo;
+class ImagenArbol;
+struct CabeceraImagen;
+class Diario;
+class Vigilante;
+class Reclamador;
+class PlanDatos;
+class Instantanea;
+class DirectorioAbierto;
+class ArbolSucinto;
+struct OperacionDiario;
+struct CambioAgregados;
+
+// Extraer el siguiente componente no vacío de la ruta, sin copiar
+inline bool siguienteComponente(string_view& resto, string_view& componente) {
+    size_t inicio = resto.find_first_not_of('/');
+    if (inicio == string_view::npos) {
+        resto = string_view();
+        return false;
+    }
+    size_t fin = resto.find('/', inicio);
+    if (fin == string_view::npos) fin = resto.size();
+    componente = resto.substr(inicio, fin - inicio);
+    resto.remove_prefix(fin);
+    return true;
+}
+
+// Forma de leer los directorios durante la carga
+enum class BackendCarga {
+    Iterador, // filesystem::directory_iterator (portable)
+    Getdents  // openat + getdents64 con d_type (solo Linux; en otros sistemas usa Iterador)
+};
+
+// Tamaño del buffer reutilizable para getdents64 (por hilo)
+const size_t TAM_BUFFER_GETDENTS = 1 << 18;
+
+// Directorios anchos: por encima de 2^CLASE_MAXIMA_PLANA hijos el arreglo
+// ordenado pasa a ser segmentado, un árbol B de dos niveles cuyo índice apunta
+// a segmentos de 2^CLASE_SEGMENTO hijos. Insertar o quitar mueve un segmento y
+// el índice, no los k hijos. Vuelve a ser plano al bajar de la mitad
+const int CLASE_MAXIMA_PLANA = 10;
+const int CLASE_SEGMENTO = 10;
+const size_t MAX_SEGMENTOS = UINT16_MAX; // Después los segmentos crecen en vez de dividirse
+
+// Búsquedas por lotes: cuántas avanzan intercaladas en cada hilo, y cuántas
+// rutas resuelve cada tarea del pool (y cada sección de lectura)
+const size_t BUSQUEDAS_EN_VUELO = 16;
+const size_t FRAGMENTO_BUSQUEDA_LOTE = 4096;
+
+// Descendientes desde los que un subárbol eliminado se le pasa al reclamador
+const uint64_t UMBRAL_RECLAMACION = 1024;
+
+// Descriptores de directorio que los manejadores de un árbol tienen abiertos a
+// la vez; los que se resuelven con el tope alcanzado usan rutas completas
+const int MAXIMO_DESCRIPTORES_MANEJADORES = 256;
+
+struct EntradaSegmento;
+
+// Bloque de hijos reservado en el AlmacenNodos: esta cabecera seguida de
+// 2^clase punteros (plano) o de 2^clase / 2 entradas de segmento (segmentado),
+// y luego de 2^clase prefijos: los primeros 8 bytes de cada nombre (o del
+// primer nombre de cada segmento) empaquetados big-endian, para buscar sin
+// desreferenciar a los hijos. Se comparte entre lectores concurrentes, así que
+// en modo concurrente un bloque publicado no vuelve a modificarse
+struct BloqueHijos {
+    uint32_t tam;        // Hijos en total
+    int16_t clase;
+    uint16_t segmentos;  // 0 si es plano
+    uint64_t generacion; // Generación del árbol en que se reservó (instantáneas)
+    
+    NodoArbol** datos() { return reinterpret_cast<NodoArbol**>(this + 1); }
+    NodoArbol* const* datos() const { return reinterpret_cast<NodoArbol* const*>(this + 1); }
+    EntradaSegmento* entradas() { return reinterpret_cast<EntradaSegmento*>(this + 1); }
+    const EntradaSegmento* entradas() const { return reinterpret_cast<const EntradaSegmento*>(this + 1); }
+    uint64_t* prefijos() { return reinterpret_cast<uint64_t*>(datos() + capacidadBloque()); }
+    const uint64_t* prefijos() const { return reinterpret_cast<const uint64_t*>(datos() + capacidadBloque()); }
+    size_t capacidadBloque() const { return clase < 0 ? 0 : size_t(1) << clase; }
+    bool esSegmentado() const { return segmentos != 0; }
+    
+    // Hijo en la posición i del orden lexicográfico
+    NodoArbol* hijo(size_t i) const;
+};
+
+// Segmento de un bloque segmentado y la posición de su primer hijo
+struct EntradaSegmento {
+    BloqueHijos* segmento;
+    size_t inicio;
+};
+
+inline NodoArbol* BloqueHijos::hijo(size_t i) const {
+    if (segmentos == 0) return datos()[i];
+    const EntradaSegmento* e = entradas();
+    const EntradaSegmento* s = upper_bound(e, e + segmentos, i,
+        [](size_t valor, const EntradaSegmento& entrada) { return valor < entrada.inicio; }) - 1;
+    return s->segmento->datos()[i - s->inicio];
+}
+
+// Bloque compartido sin hijos que marca un directorio vacío (un archivo tiene
+// nullptr). Nunca se escribe ni se devuelve al almacén
+inline BloqueHijos BLOQUE_DIRECTORIO_VACIO{0, -1, 0, 0};
+
+// Recorrido en orden de los hijos, plano o segmento por segmento
+struct IteradorHijos {
+    using iterator_category = forward_iterator_tag;
+    using value_type = NodoArbol*;
+    using difference_type = ptrdiff_t;
+    using pointer = NodoArbol* const*;
+    using reference = NodoArbol* const&;
+    
+    NodoArbol* const* actual = nullptr;
+    NodoArbol* const* fin = nullptr;           // Fin del segmento actual
+    const EntradaSegmento* siguiente = nullptr; // Segmentos que faltan
+    const EntradaSegmento* ultimo = nullptr;
+    
+    reference operator*() const { return *actual; }
+    IteradorHijos& operator++() {
+        if (++actual == fin && siguiente != ultimo) {
+            actual = siguiente->segmento->datos();
+            fin = actual + siguiente->segmento->tam;
+            ++siguiente;
+        }
+        return *this;
+    }
+    IteradorHijos operator++(int) { IteradorHijos previo = *this; ++*this; return previo; }
+    bool operator==(const IteradorHijos& otro) const { return actual == otro.actual; }
+};
+
+// Extremos del recorrido de un bloque (nullptr = archivo, sin hijos)
+inline IteradorHijos inicioHijos(const BloqueHijos* bloque) {
+    if (bloque == nullptr) return {};
+    if (!bloque->esSegmentado()) return {bloque->datos(), bloque->datos() + bloque->tam, nullptr, nullptr};
+    const EntradaSegmento* e = bloque->entradas();
+    return {e->segmento->datos(), e->segmento->datos() + e->segmento->tam, e + 1, e + bloque->segmentos};
+}
+
+inline IteradorHijos finHijos(const BloqueHijos* bloque) {
+    if (bloque == nullptr) return {};
+    if (!bloque->esSegmentado()) return {bloque->datos() + bloque->tam, nullptr, nullptr, nullptr};
+    const BloqueHijos* ultimo = bloque->entradas()[bloque->segmentos - 1].segmento;
+    return {ultimo->datos() + ultimo->tam, nullptr, nullptr, nullptr};
+}
+
+// Primer hijo cuyo nombre no es menor que 'nombre' (finHijos si no hay)
+IteradorHijos cotaInferiorHijos(const BloqueHijos* bloque, string_view nombre);
+
+// Hijos de un nodo: un único puntero al bloque (nullptr = archivo), para que
+// el cambio de bloque sea una sola escritura atómica
+struct ListaHijos {
+    BloqueHijos* bloque = nullptr;
+    
+    size_t size() const { return bloque == nullptr ? 0 : bloque->tam; }
+    bool empty() const { return size() == 0; }
+    bool esSegmentado() const { return bloque != nullptr && bloque->esSegmentado(); }
+    uint32_t capacidad() const { return bloque == nullptr || bloque->clase < 0 ? 0 : 1u << bloque->clase; } // Solo planos
+    NodoArbol* operator[](size_t i) const { return bloque->hijo(i); }
+    
+    IteradorHijos begin() const { return inicioHijos(bloque); }
+    IteradorHijos end() const { return finHijos(bloque); }
+    
+    // Lectura y publicación seguras frente a lectores de otros hilos
+    const BloqueHijos* leer() const {
+        return atomic_ref<BloqueHijos*>(const_cast<BloqueHijos*&>(bloque)).load(memory_order_acquire);
+    }
+    void publicar(BloqueHijos* nuevo) {
+        atomic_ref<BloqueHijos*>(bloque).store(nuevo, memory_order_release);
+    }
+};
+
+// Totales del subárbol de un nodo, sin contarlo a él. Se calculan al cargar y
+// el escritor los corrige a lo largo del camino desde la raíz en cada cambio
+struct AgregadosSubarbol {
+    uint32_t archivos = 0;
+    uint32_t directorios = 0;
+    uint64_t bytes : 48 = 0;  // Tamaño de los archivos (en un archivo, el suyo); 0 si no se capturó
+    uint64_t altura : 16 = 0; // Niveles por debajo del nodo (0 si no tiene hijos)
+};
+
+const uint64_t MAXIMO_BYTES_AGREGADOS = (uint64_t(1) << 48) - 1;
+
 // Estructura del nodo del árbol k-ario
 struct NodoArbol {
-    string nombre;
-    vector<NodoArbol*> hijos; // Vector siempre ordenado lexicográficamente
+    string_view nombre;  // Apunta a la arena de nombres del AlmacenNodos
+    ListaHijos hijos;    // Arreglo siempre ordenado lexicográficamente
+    AgregadosSubarbol agregados;
     
     // Constructor
-    NodoArbol(const string& n) : nombre(n) {}
+    NodoArbol(string_view n) : nombre(n) {}
+    
+    // Verificar si es un archivo (los directorios, aun vacíos, tienen bloque)
+    bool esArchivo() const { return hijos.leer() == nullptr; }
+    
+    // Marcar un nodo recién creado como directorio vacío
+    void marcarDirectorio() { hijos.bloque = &BLOQUE_DIRECTORIO_VACIO; }
+    
+    // Generación en que nació: la de su bloque. Los archivos y los directorios
+    // con el bloque vacío compartido no la registran y cuentan como nacidos en 0
+    uint64_t nacimiento() const { return hijos.bloque == nullptr ? 0 : hijos.bloque->generacion; }
+};
+
+// Resultados perezosos de los listados y recorridos. Mientras existen, en modo
+// concurrente mantienen abierta una sección de lectura, así que los bloques que
+// recorren no se liberan aunque otro hilo modifique el árbol; deben usarse y
+// destruirse en el hilo que los creó. Fuera del modo concurrente, modificar un
+// directorio invalida los recorridos que estén dentro de él
+
+// Hijos consecutivos de un directorio (todos, o los de un prefijo)
+class RangoHijos {
+private:
+    IteradorHijos inicio, fin;
+    unique_ptr<GuardiaLectura> guardia;
+
+public:
+    RangoHijos() = default;
+    RangoHijos(IteradorHijos i, IteradorHijos f, unique_ptr<GuardiaLectura> g)
+        : inicio(i), fin(f), guardia(std::move(g)) {}
+    
+    IteradorHijos begin() const { return inicio; }
+    IteradorHijos end() const { return fin; }
+    bool empty() const { return inicio == fin; }
+};
+
+// Elemento de un recorrido: el nodo y su ruta relativa, que vive en un buffer
+// reutilizado y solo es válida hasta avanzar al siguiente
+struct EntradaRecorrido {
+    const NodoArbol* nodo;
+    string_view ruta;
+};
+
+// Recorrido en profundidad y en orden lexicográfico de un subárbol, o de las
+// rutas que coinciden con un patrón glob componente a componente. Usa memoria
+// proporcional a la profundidad, no a la cantidad de resultados
+class Recorrido {
+private:
+    struct Marco {
+        IteradorHijos actual, fin;
+        size_t longitudRuta; // Largo del buffer hasta el padre
+    };
+    
+    vector<Marco> pila;
+    vector<string> componentes; // Vacío: todo el subárbol
+    string ruta;
+    const NodoArbol* actual = nullptr; // nullptr al terminar
+    unique_ptr<GuardiaLectura> guardia;
+    
+    void apilar(const BloqueHijos* bloque);
+    bool avanzar();
+    
+    friend class ArbolSistemaArchivos;
+
+public:
+    // Iterador de entrada: cada incremento avanza el recorrido compartido
+    class Iterador {
+    private:
+        Recorrido* recorrido = nullptr;
     
-    // Destructor
-    ~NodoArbol();
+    public:
+        using iterator_category = input_iterator_tag;
+        using value_type = EntradaRecorrido;
+        using difference_type = ptrdiff_t;
+        
+        Iterador() = default;
+        explicit Iterador(Recorrido* r) : recorrido(r) {}
+        
+        EntradaRecorrido operator*() const { return {recorrido->actual, recorrido->ruta}; }
+        Iterador& operator++() { recorrido->avanzar(); return *this; }
+        void operator++(int) { ++*this; }
+        bool operator==(default_sentinel_t) const { return recorrido->actual == nullptr; }
+    };
     
-    // Verificar si es un archivo (nodo hoja)
-    bool esArchivo() const { return hijos.empty(); }
+    Recorrido() = default;
+    Recorrido(Recorrido&&) = default;
+    Recorrido& operator=(Recorrido&&) = default;
+    
+    // Se recorre una sola vez: begin() no reinicia
+    Iterador begin() { return Iterador(this); }
+    default_sentinel_t end() const { return default_sentinel; }
+};
+
+// Comparar un nombre con un patrón glob: '*' (cualquier secuencia), '?' (un
+// carácter), '[abc]', '[a-z]', '[!a-z]' y '\' para escapar el siguiente
+bool coincidePatron(string_view patron, string_view nombre);
+
+// Desglose de la memoria del árbol (bytes). Los nombres viven en la arena de
+// cadenas, así que no hay SSO: cada nombre ocupa exactamente su largo
+struct InformeMemoria {
+    size_t nodos = 0;        // Nodos enlazados
+    size_t nombres = 0;      // Nombres de esos nodos
+    size_t hijos = 0;        // Bloques de hijos: cabeceras y posiciones ocupadas (punteros y prefijos)
+    size_t holguraHijos = 0; // Posiciones libres de esos bloques (capacidades en potencias de dos)
+    size_t liberada = 0;     // Nodos, nombres y bloques desenlazados que siguen en las arenas
+    size_t colaArenas = 0;   // Final sin usar de los bloques de las arenas
+    size_t indice = 0;       // Índice hash de rutas
+    size_t imagen = 0;       // Imagen mapeada (páginas del archivo, no del heap)
+    size_t total = 0;        // Arenas más índice, sin la imagen
+    size_t picoCarga = 0;    // Máximo de las arenas durante la última carga
 };
 
 // Clase para el árbol del sistema de archivos
 class ArbolSistemaArchivos {
 private:
+    AlmacenNodos almacen; // Dueño de toda la memoria de nodos, nombres e hijos
     NodoArbol* raiz;
     string directorioBase; // Directorio base para operaciones del sistema de archivos
+    unique_ptr<Almacenamiento> almacenamiento; // Dónde se reflejan insertar y eliminar
+    unique_ptr<ImagenArbol> imagen; // Imagen mapeada de solo lectura (si se abrió una)
+    IndiceRutas indiceRutas; // Índice opcional de rutas completas
+    bool indiceActivo;
+    
+    // Modo concurrente: lectores sin cerrojos y un escritor a la vez
+    struct Retirado {
+        uint64_t epoca;       // Etiqueta de Epocas::avanzar() al desenlazar
+        BloqueHijos* bloque;  // Bloque de hijos reemplazado, o
+        NodoArbol* subarbol;  // subárbol eliminado, o
+        NodoArbol* nodo;      // nodo suelto (sus hijos siguen enlazados en otro)
+    };
+    bool modoConcurrente;
+    mutex cerrojoEscritura;
+    vector<Retirado> retirados;
+    
+    // Instantáneas: un bloque que nació en o antes de la generación de alguna
+    // instantánea viva está compartido con ella y no se modifica; el escritor
+    // copia el camino desde la raíz hasta lo que cambia. Lo que se desenlaza y
+    // alguna instantánea todavía ve queda retenido hasta que ninguna lo alcance
+    struct Retenido {
+        uint64_t desde, hasta; // Estuvo enlazado (a lo sumo) en [desde, hasta)
+        NodoArbol* nodo;       // Nodo, o
+        BloqueHijos* bloque;   // bloque de hijos
+    };
+    uint64_t generacion;
+    set<uint64_t> instantaneas; // Generaciones de las instantáneas vivas
+    vector<Retenido> retenidos;
+    
+    unique_ptr<Diario> diario; // Escritura diferida (si está activa)
+    unique_ptr<Vigilante> vigilante; // Sincronización con inotify (si está activa)
+    unique_ptr<Reclamador> reclamador; // Reclamación en segundo plano (si está activa)
+    uint64_t apartados; // Contador para nombrar lo que se aparta a la papelera
     
-    // Funciones auxiliares privadas
-    NodoArbol* buscarNodo(const string& ruta);
-    vector<string> dividirRuta(const string& ruta);
-    int busquedaBinaria(const vector<NodoArbol*>& hijos, const string& nombre);
-    void insertarOrdenado(vector<NodoArbol*>& hijos, NodoArbol* nodo);
+    // Manejadores de directorio: cambia cada vez que un nodo de directorio
+    // puede dejar de estar enlazado (eliminado, movido, copiado o revertido), y entonces
+    // los manejadores vuelven a buscar sus nodos por su ruta antes de usarse
+    atomic<uint64_t> versionDirectorios;
+    atomic<int> descriptoresManejadores; // Abiertos por los manejadores vivos
+    
+    // Manejadores vivos. Quien desenlaza o mueve un directorio marca los que
+    // caen en su subárbol antes de cambiar la versión
+    mutex cerrojoManejadores;
+    vector<DirectorioAbierto*> manejadores;
+    
+    bool capturarTamanos;
+    vector<NodoArbol*> camino; // Ancestros del último cambio (solo lo usa el escritor)
+    vector<NodoArbol*> caminoDestino; // Los del destino al mover
+    
+    // Presupuesto de la carga (0 = sin límite). Los hilos de la carga paralela
+    // lo comparan con el contador de arenas del proceso
+    size_t presupuestoMemoria;
+    size_t inicioCargaProceso; // obtenerBytesArenas() al empezar la carga
+    size_t inicioCargaArbol;   // Bytes del almacén al empezar la carga
+    atomic<bool> cargaExcedida;
+    size_t picoCarga;
+    bool compactarTrasCarga;
+    
+    // Funciones auxiliares privadas. Con 'ancestros' se anotan los nodos desde
+    // la raíz hasta el resultado (buscarNodo) o hasta el padre (buscarPadre)
+    NodoArbol* buscarNodo(string_view ruta, vector<NodoArbol*>* ancestros = nullptr);
+    NodoArbol* buscarPadre(string_view ruta, string_view& nombre, vector<NodoArbol*>* ancestros = nullptr);
+    static int busquedaBinaria(const BloqueHijos* bloque, string_view nombre);
+    void buscarIntercalado(const vector<string>& rutas, size_t desde, size_t hasta, vector<int>& codigos);
+    void buscarIndiceIntercalado(const vector<string>& rutas, size_t desde, size_t hasta, vector<int>& codigos);
+    void insertarOrdenado(ListaHijos& hijos, NodoArbol* nodo);
+    void quitarHijo(ListaHijos& hijos, int indice);
+    void mezclarHijos(ListaHijos& hijos, const vector<NodoArbol*>& nuevos);
+    void quitarHijos(ListaHijos& hijos, const vector<int>& posiciones);
+    void insertarSegmentado(ListaHijos& hijos, NodoArbol* nodo);
+    void quitarSegmentado(ListaHijos& hijos, size_t indice);
+    void quitarHijosSegmentado(ListaHijos& hijos, const vector<int>& posiciones);
+    void reemplazarLista(ListaHijos& hijos, const vector<NodoArbol*>& ordenados);
+    void retirarLista(BloqueHijos* bloque);
+    static BloqueHijos* construirLista(AlmacenNodos& destino, NodoArbol* const* ordenados, size_t cantidad);
+    static void liberarLista(AlmacenNodos& destino, BloqueHijos* bloque);
     void eliminarSubarbol(NodoArbol* nodo);
+    void retirarBloque(BloqueHijos* bloque);
+    void retirarSubarbol(NodoArbol* nodo);
+    void retirarNodo(NodoArbol* nodo);
+    void desecharSubarbol(NodoArbol* nodo);
+    bool reclamable(const NodoArbol* nodo) const;
+    void reclamar(bool todo);
+    
+    // Copia de caminos para las instantáneas. copiarCamino deja propios los
+    // nodos de 'ancestros' (y sus bloques) y retorna el último
+    bool compartido(const BloqueHijos* bloque) const;
+    bool visible(uint64_t desde, uint64_t hasta) const;
+    NodoArbol* copiarCamino(vector<NodoArbol*>& ancestros);
+    BloqueHijos* copiarBloque(const BloqueHijos* bloque);
+    void reemplazarHijo(ListaHijos& hijos, NodoArbol* copia);
+    void retener(NodoArbol* nodo, BloqueHijos* bloque, uint64_t desde);
+    void retenerSubarbol(NodoArbol* nodo);
+    void barrerRetenidos();
+    void liberarInstantanea(uint64_t tomada);
+    
+    // Memoria: la carga en curso pasó el presupuesto; dejar el árbol sin
+    // nodos; copiar los hijos de 'origen' (y sus subárboles) a 'copia' en otro almacén
+    bool excedePresupuesto();
+    void vaciar();
+    void copiarHijos(AlmacenNodos& destino, const NodoArbol* origen, NodoArbol* copia);
+    bool revertirNodo(NodoArbol* actual, NodoArbol* destino, string& ruta, unordered_set<const void*>& revividos);
+    bool revivirSubarbol(NodoArbol* nodo, string& ruta, unordered_set<const void*>& revividos);
+    static NodoArbol* buscarDesde(NodoArbol* inicio, string_view ruta);
+    static void iniciarRecorrido(Recorrido& recorrido, const NodoArbol* nodo, string_view ruta);
     void cargarDirectorioRecursivo(const filesystem::path& ruta, NodoArbol* nodo);
+    void cargarDirectorioGetdents(int fd, NodoArbol* nodo);
+    void cargarDirectorioParalelo(PoolTrabajo& pool, vector<unique_ptr<AlmacenNodos>>& almacenes,
+                                  const filesystem::path& ruta, NodoArbol* nodo,
+                                  BackendCarga backend, int idHilo);
+    void materializarImagen();
+    bool guardarImagen(const string& archivo, const CabeceraImagen& identidad);
+    void indexarSubarbol(NodoArbol* nodo, HashRuta huella, bool agregar);
+    void obtenerRutasImagen(size_t indice, const string& rutaActual, vector<string>& rutas);
+    static void asignarHijosOrdenados(AlmacenNodos& destino, ListaHijos& hijos, vector<NodoArbol*>& nuevos);
+    
+    // Agregados: sumar los de los hijos (ya calculados), calcularlos para todo
+    // un subárbol, o aplicar un cambio en los hijos del último nodo de 'ancestros'
+    static void sumarAgregados(NodoArbol* nodo);
+    static void calcularAgregados(NodoArbol* nodo);
+    static void propagarAgregados(const vector<NodoArbol*>& ancestros, const CambioAgregados& cambio);
     
-    // Nuevas funciones para mantener consistencia
-    string construirRutaCompleta(const string& rutaRelativa);
-    bool crearArchivoSistema(const string& rutaCompleta);
-    bool crearDirectorioSistema(const string& rutaCompleta);
-    bool eliminarDelSistema(const string& rutaCompleta);
+    // Ruta en el directorio cargado (para leerlo, no para escribir)
+    string construirRutaCompleta(string_view rutaRelativa);
+    bool aplicarOperacion(const OperacionDiario& op);
+    
+    // Crear o eliminar en el almacenamiento: de inmediato, o encolado en el
+    // diario si la escritura diferida está activa (en ese caso siempre tiene éxito)
+    bool crearEnSistema(string_view ruta, bool esDirectorio);
+    bool eliminarEnSistema(string_view ruta);
+    bool moverEnSistema(string_view origen, string_view destino);
+    
+    // Lo mismo dentro del directorio de un manejador (eliminar: solo archivos)
+    bool crearEnSistema(const DirectorioAbierto& dir, string_view nombre, bool esDirectorio);
+    bool eliminarEnSistema(const DirectorioAbierto& dir, string_view nombre);
+    
+    // Apartar un directorio a la papelera para que lo borre el reclamador.
+    // Retorna false si no se pudo: hay que eliminarlo con eliminarEnSistema
+    bool apartarEnSistema(string_view ruta);
+    
+    // Volver a buscar los nodos del manejador si el árbol cambió desde la última
+    // vez. Retorna false si su directorio no está; solo lo invalida si lo marcó
+    // desenlazarManejadores (si no, es un escritor concurrente a medio camino)
+    bool validarDirectorio(DirectorioAbierto& dir);
+    bool resolverDirectorio(DirectorioAbierto& dir);
+    
+    // Marcar los manejadores de 'ruta' y de lo que cuelga de ella ("" es todo
+    // el árbol): su directorio dejó el árbol, o ahora está bajo 'destino'
+    void desenlazarManejadores(string_view ruta);
+    void moverManejadores(string_view origen, string_view destino);
+    
+    // Aplicar al árbol (sin tocar el sistema de archivos) lo que informó inotify
+    void vigilarSubarbol(NodoArbol* nodo, const string& ruta);
+    void escanearDirectorio(const string& ruta, NodoArbol* nodo);
+    void agregarDesdeSistema(const string& ruta);
+    void quitarDesdeSistema(const string& ruta);
+    void reconciliarDirectorio(const string& ruta, NodoArbol* nodo);
+    
+    friend class Instantanea;
+    friend class DirectorioAbierto;
     
 public:
-    // Constructor
-    ArbolSistemaArchivos();
+    // Constructor: sin almacenamiento, insertar y eliminar escriben en el
+    // directorio cargado (AlmacenamientoSistema)
+    explicit ArbolSistemaArchivos(unique_ptr<Almacenamiento> almacenamiento = nullptr);
     
-    // Destructor
+    // Destructor: libera todos los nodos de una vez a través del almacén
     ~ArbolSistemaArchivos();
     
-    // Cargar datos desde el sistema de archivos
-    void cargarDesdeDirectorio(const string& rutaDirectorio);
+    ArbolSistemaArchivos(const ArbolSistemaArchivos&) = delete;
+    ArbolSistemaArchivos& operator=(const ArbolSistemaArchivos&) = delete;
+    
+    // Cargar datos desde el sistema de archivos.
+    // Con numHilos > 1 los subdirectorios se reparten en un pool con robo de trabajo.
+    // Cada directorio se lee completo y sus hijos se ordenan una sola vez.
+    // Retorna false si no se cargó: el directorio no existe, el árbol es
+    // concurrente o tiene instantáneas, o se pasó el presupuesto de memoria
+    bool cargarDesdeDirectorio(const string& rutaDirectorio, int numHilos = 1,
+                               BackendCarga backend = BackendCarga::Getdents);
+    
+    // Construir en memoria el árbol de un plan del generador, sin tocar el
+    // disco. Solo sobre un árbol vacío con almacenamiento en memoria (las
+    // escrituras no tendrían un directorio donde reflejarse); si no, retorna false
+    bool cargarSintetico(const PlanDatos& plan);
+    
+    // Guardar una imagen binaria compacta del árbol (escritura atómica vía rename)
+    bool guardarImagen(const string& archivo);
+    
+    // Abrir una imagen con mmap sobre un árbol vacío, sin recorrer sus nodos.
+    // Retorna false (sin cambiar el árbol) si la imagen no es válida o si el
+    // directorio cambió desde que se guardó. Las búsquedas se responden desde la
+    // imagen; la primera modificación la convierte en nodos del almacén
+    bool abrirImagen(const string& archivo, const string& rutaDirectorio);
+    
+    // Abrir la imagen si está vigente; si no, recorrer el directorio y guardarla
+    // Retorna true si se usó la imagen
+    bool cargarConImagen(const string& rutaDirectorio, const string& archivoImagen, int numHilos = 1);
     
-    // Búsqueda por ruta relativa
+    // Activar o desactivar el índice hash de rutas completas. Al activarlo se
+    // construye recorriendo el árbol; luego insertar y eliminar lo mantienen
+    void activarIndice(bool activo);
+    bool obtenerIndiceActivo() const { return indiceActivo; }
+    
+    TipoAlmacenamiento obtenerTipoAlmacenamiento() const { return almacenamiento->tipo(); }
+    
+    // Escritura diferida: insertar y eliminar modifican el árbol y encolan la
+    // operación del sistema de archivos en un diario de rehacer, que un hilo aplica
+    // en lotes. sincronizar() es el único punto de durabilidad: lo modificado
+    // después de la última sincronización puede perderse si el proceso cae (ver diario.h).
+    // Al activarla se reaplica lo que haya quedado en el diario de una
+    // ejecución anterior, así que conviene hacerlo antes de cargar el directorio.
+    // El archivo del diario no debe estar dentro del directorio cargado.
+    // Retorna false con el almacenamiento en memoria: no hay nada que diferir
+    bool activarEscrituraDiferida(const string& archivoDiario);
+    void desactivarEscrituraDiferida();
+    
+    // Barrera de durabilidad: espera a que el sistema de archivos refleje todas
+    // las modificaciones hechas. Retorna false si alguna falló al aplicarse
+    bool sincronizar();
+    
+    // Sincronización incremental (solo Linux): vigila con inotify cada directorio
+    // del árbol y procesarCambios aplica las creaciones, eliminaciones y
+    // movimientos externos, con un costo proporcional a los cambios. Si la cola
+    // de eventos se desborda, se releen solo los directorios cuyo mtime cambió.
+    // Lo que cambie entre la carga y la activación no se detecta. activarVigilancia
+    // retorna false (y no deja nada activo) si algún directorio no se pudo
+    // vigilar, por ejemplo al llegar a fs.inotify.max_user_watches.
+    // procesarCambios debe llamarse desde un solo hilo; en modo concurrente puede
+    // convivir con lectores y escritores. Retorna los eventos aplicados, o -1 si
+    // falló la lectura. El descriptor sirve para esperar con poll/epoll
+    bool activarVigilancia();
+    void desactivarVigilancia();
+    int procesarCambios(int esperaMs = 0);
+    int obtenerDescriptorVigilancia() const;
+    
+    // Reclamación en segundo plano: eliminar un subárbol de UMBRAL_RECLAMACION
+    // descendientes o más lo desenlaza y retorna; un hilo devuelve sus nodos al
+    // almacén y borra del disco el directorio, que antes se aparta con un rename
+    // a la papelera (sin diario ni vigilancia; si no, se borra en el momento).
+    // Al activarla se borra lo que haya quedado en la papelera. drenarReclamacion
+    // espera a que termine lo encolado y retorna false si algún borrado falló;
+    // en modo concurrente no espera a los subárboles que aún pueden ver lectores
+    void activarReclamacion(bool activo);
+    bool drenarReclamacion();
+    size_t obtenerReclamacionPendiente();
+    
+    // Activar el modo concurrente: buscar puede llamarse desde muchos hilos sin
+    // cerrojos mientras insertar y eliminar se serializan entre sí y publican
+    // bloques de hijos nuevos. Lo desenlazado se libera por épocas cuando ya
+    // ningún lector puede verlo. Cargar, abrir imágenes y el índice hash no
+    // son concurrentes: al activarlo se desactiva el índice
+    void activarConcurrencia(bool activo);
+    bool obtenerConcurrencia() const { return modoConcurrente; }
+    
+    // Instantánea O(1) del estado actual (ver instantanea.h). No se toma en modo
+    // concurrente ni con la vigilancia activa: retorna una inválida. Al tomarla
+    // se desactiva el índice hash; mientras haya instantáneas vivas no pueden
+    // activarse el índice, la concurrencia ni la vigilancia, ni cargarse datos
+    Instantanea tomarInstantanea();
+    
+    // Volver al estado de una instantánea de este árbol, que sigue viva. Se
+    // recorren solo los subárboles que difieren y el almacenamiento recibe esas
+    // diferencias. Retorna false si alguna falló (el árbol se revierte igual)
+    bool revertir(const Instantanea& instantanea);
+    size_t obtenerNumeroInstantaneas() const { return instantaneas.size(); }
+    
+    // Búsqueda por ruta relativa (sin reservas de memoria).
+    // Con el índice activo es un sondeo hash más la verificación del nombre
     // Retorna: 0 si existe el archivo, 1 si no existe, 2 si es un directorio
-    int buscar(const string& ruta);
+    int buscar(string_view ruta);
+    
+    // Búsqueda por lotes: avanza BUSQUEDAS_EN_VUELO rutas a la vez, un nivel
+    // por turno, y antes de pasar a la siguiente pide a la caché el bloque o el
+    // nodo que la ruta necesitará en su próximo turno, para que los fallos de
+    // caché de búsquedas independientes se solapen. Con numHilos > 1 los lotes
+    // grandes se reparten en un pool. Las mismas reglas que buscar para los
+    // hilos y un código por ruta, con el mismo significado
+    vector<int> buscarLote(const vector<string>& rutas, int numHilos = 1);
     
     // Inserción con consistencia
     // Retorna: 0 en éxito, 1 si el archivo ya existe, 2 si no existe ruta padre, 3 si error del sistema
-    int insertar(const string& ruta, bool esDirectorio = false);
+    int insertar(string_view ruta, bool esDirectorio = false);
     
     // Eliminación con consistencia
     // Retorna: 0 en éxito, 1 si no existe, 2 si error del sistema
-    int eliminar(const string& ruta);
+    int eliminar(string_view ruta);
+    
+    // Mover o renombrar un archivo o un subárbol completo: un solo rename en el
+    // sistema de archivos y, en el árbol, el mismo nodo (o una copia con el
+    // nombre nuevo) pasa de la lista de su padre a la del destino, sin tocar
+    // los descendientes. El costo es el de las dos búsquedas y las dos listas,
+    // salvo con el índice hash o la vigilancia activos, que reescriben las
+    // rutas de todo el subárbol. Con la escritura diferida el rename se encola.
+    // Retorna: 0 en éxito, 1 si no existe el origen, 2 si el destino ya existe,
+    // 3 si no existe el padre del destino o está dentro del origen, 4 si error del sistema
+    int mover(string_view origen, string_view destino);
+    
+    // Inserción por lotes: agrupa las rutas por directorio padre, resuelve cada
+    // padre una sola vez y mezcla sus hijos nuevos en una pasada.
+    // Retorna un código por ruta, con el mismo significado que en insertar
+    vector<int> insertarLote(const vector<string>& rutas, bool esDirectorio = false);
+    
+    // Eliminación por lotes, agrupada igual que insertarLote.
+    // Retorna un código por ruta, con el mismo significado que en eliminar
+    vector<int> eliminarLote(const vector<string>& rutas);
+    
+    // Manejador de un directorio (ver directorio.h); inválido si la ruta no
+    // existe o es un archivo. Con una imagen abierta se materializa. Con un
+    // almacenamiento persistente cada manejador ocupa un descriptor mientras
+    // vive, hasta MAXIMO_DESCRIPTORES_MANEJADORES por árbol; los siguientes
+    // funcionan igual pero con rutas completas. Conviene abrir pocos y reusarlos
+    DirectorioAbierto abrirDirectorio(string_view ruta);
+    
+    // Las mismas operaciones con un nombre (un solo componente) dentro del
+    // directorio del manejador, y los mismos códigos de retorno: un manejador
+    // inválido cuenta como ruta inexistente (1 en buscarEn y eliminarEn, 2 en
+    // insertarEn). En modo concurrente buscarEn no toma cerrojos
+    int buscarEn(DirectorioAbierto& dir, string_view nombre);
+    int insertarEn(DirectorioAbierto& dir, string_view nombre, bool esDirectorio = false);
+    int eliminarEn(DirectorioAbierto& dir, string_view nombre);
+    
+    // Listado perezoso de un directorio, en orden lexicográfico. Vacío si la
+    // ruta no existe o es un archivo. Con una imagen abierta se materializa
+    RangoHijos listarDirectorio(string_view ruta);
+    
+    // Hijos del directorio cuyo nombre empieza con 'prefijo': dos búsquedas
+    // binarias delimitan el rango, sin filtrar los demás hijos
+    RangoHijos listarConPrefijo(string_view ruta, string_view prefijo);
+    
+    // Todos los descendientes de la ruta (sin incluirla), en preorden
+    Recorrido recorrerSubarbol(string_view ruta);
+    
+    // Rutas que coinciden con el patrón, p. ej. "src/*/prueba_??.txt". Cada
+    // componente se compara con coincidePatron; su parte literal inicial se
+    // busca como prefijo, así que los componentes sin comodines son búsquedas
+    Recorrido buscarPatron(string_view patron);
+    
+    // Construir la representación sucinta de solo lectura del estado actual
+    // (ver sucinto.h), que responde buscar con los mismos códigos en una
+    // fracción de la memoria. No queda enlazada al árbol: después puede
+    // destruirse el árbol y quedarse solo con ella
+    ArbolSucinto congelar();
+    
+    // Capturar el tamaño de cada archivo en las cargas siguientes (un fstatat
+    // por archivo); sin esto los agregados cuentan 0 bytes
+    void activarTamanos(bool activo) { capturarTamanos = activo; }
+    
+    // Presupuesto de memoria para cargarDesdeDirectorio (bytes de las arenas,
+    // contando lo que el árbol ya tenía; 0 = sin límite). Al pasarlo se deja de
+    // leer el disco, se descarta todo el árbol (queda vacío) y la carga retorna
+    // false. Se mide con el contador de todo el proceso: si otro árbol reserva
+    // a la vez, cuenta contra este
+    void fijarPresupuestoMemoria(size_t bytes) { presupuestoMemoria = bytes; }
+    
+    // Copiar el árbol a arenas nuevas, sin lo desenlazado, sin listas libres y
+    // con cada bloque de hijos en la clase justa (los que quedaron grandes
+    // después de eliminar se achican); los hermanos quedan contiguos. Invalida
+    // los recorridos abiertos; los manejadores de directorio se vuelven a
+    // resolver. Retorna false en modo concurrente o con instantáneas vivas.
+    // Con activarCompactacionTrasCarga se hace al final de cada carga
+    bool compactarMemoria();
+    void activarCompactacionTrasCarga(bool activo) { compactarTrasCarga = activo; }
+    
+    // Desglose de la memoria (ver InformeMemoria); recorre todo el árbol
+    InformeMemoria obtenerInformeMemoria();
+    
+    // Totales del subárbol de la ruta en O(profundidad), sin recorrerlo.
+    // Retorna false si no existe. En modo concurrente espera al escritor
+    bool obtenerAgregados(string_view ruta, AgregadosSubarbol& agregados);
     
     // Obtener todas las rutas del árbol (para experimentación)
     vector<string> obtenerTodasLasRutas();
     void obtenerRutasRecursivo(NodoArbol* nodo, const string& rutaActual, vector<string>& rutas);
     
-    // Obtener número total de nodos
+    // Obtener número total de nodos (sin la raíz), desde los agregados
     int obtenerNumeroNodos();
     int contarNodosRecursivo(NodoArbol* nodo);
     
+    // Memoria reservada por el almacén de nodos (bytes)
+    size_t obtenerMemoriaReservada() const { return almacen.obtenerBytesReservados(); }
+    
     // Obtener directorio base
     string obtenerDirectorioBase() const { return directorioBase; }
 };
@@ -0,0 +1,89 @@
+#ifndef VIGILANTE_H
+#define VIGILANTE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Cambio del sistema de archivos traducido a una ruta relativa al directorio base
+enum class TipoCambio : uint8_t {
+    Creado,    // Creado o movido hacia adentro
+    Eliminado, // Eliminado o movido hacia afuera
+    Desborde   // La cola de inotify se desbordó: hubo cambios que no se reportaron
+};
+
+struct CambioVigilancia {
+    TipoCambio tipo;
+    bool esDirectorio;
+    string ruta;
+};
+
+// Vigilancia con inotify de los directorios bajo un directorio base (solo Linux).
+// Cada directorio vigilado guarda su ruta relativa y el mtime que tenía al
+// registrarlo o al reconciliarlo por última vez; tras un desborde solo hace
+// falta releer los directorios cuyo mtime cambió
+class Vigilante {
+private:
+    struct DirectorioVigilado {
+        string ruta;
+        int64_t mtimeSeg;
+        int64_t mtimeNs;
+    };
+    
+    int fd;
+    size_t fallidas; // Directorios que no se pudieron vigilar
+    string directorioBase;
+    unordered_map<int, DirectorioVigilado> porDescriptor;
+    map<string, int, less<>> porRuta; // Ordenado para quitar subárboles por prefijo
+    vector<char> buffer;
+    
+    string rutaCompleta(string_view rutaRelativa) const;
+    void olvidar(int descriptor);
+
+public:
+    // Constructor
+    Vigilante();
+    
+    // Destructor: cierra el descriptor de inotify
+    ~Vigilante();
+    
+    Vigilante(const Vigilante&) = delete;
+    Vigilante& operator=(const Vigilante&) = delete;
+    
+    // Crear la instancia de inotify para el directorio base (ruta absoluta)
+    bool abrir(const string& base);
+    void cerrar();
+    
+    // Descriptor para integrarlo en poll/epoll (-1 si está cerrado)
+    int obtenerDescriptor() const { return fd; }
+    size_t obtenerNumeroVigilados() const { return porDescriptor.size(); }
+    size_t obtenerFallidas() const { return fallidas; }
+    
+    // Vigilar un directorio (ruta relativa, "" es la base) y anotar su mtime.
+    // Hay que llamarlo antes de listar el directorio para no perder cambios
+    bool vigilar(const string& rutaRelativa);
+    bool estaVigilado(string_view rutaRelativa) const;
+    
+    // Dejar de vigilar un directorio y todos los que cuelgan de él
+    void dejarDeVigilar(string_view rutaRelativa);
+    
+    // Un directorio vigilado se renombró (lo hizo este proceso): inotify vigila
+    // inodos, así que sus descriptores y los de los que cuelgan de él siguen
+    // valiendo y solo cambian las rutas anotadas
+    void renombrar(string_view origen, string_view destino);
+    
+    // Esperar hasta 'esperaMs' (0 = no esperar, -1 = sin límite) y traducir los
+    // eventos disponibles. Retorna false si falló la lectura
+    bool leer(vector<CambioVigilancia>& cambios, int esperaMs);
+    
+    // Tras un desborde: directorios vigilados cuyo mtime cambió (y anota el nuevo).
+    // Los que ya no existen dejan de vigilarse
+    vector<string> directoriosModificados();
+};
+
+#endif // VIGILANTE_H
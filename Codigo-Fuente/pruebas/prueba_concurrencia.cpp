@@ -0,0 +1,116 @@
+#include "almacenamiento.h"
+#include "tree.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Prueba de la reclamación por épocas (se compila con -fsanitize=thread, ver
+// el Makefile): varios lectores buscan sin cerrojos un conjunto estable de
+// rutas mientras un escritor inserta, elimina y mueve otras en los mismos
+// directorios, así que los bloques que los lectores recorren se reemplazan y
+// se retiran todo el tiempo. Las rutas estables deben encontrarse siempre
+
+const int DIRECTORIOS_ESTABLES = 16;
+const int ARCHIVOS_ESTABLES = 40;     // Por directorio
+const int OPERACIONES_ESCRITOR = 20000;
+const int HILOS_LECTORES = 3;
+
+static string rutaEstable(int d, int a) {
+    string ruta = "estable/d" + to_string(d);
+    if (a >= 0) ruta += "/f" + to_string(a);
+    return ruta;
+}
+
+int main() {
+    ArbolSistemaArchivos arbol(crearAlmacenamiento(TipoAlmacenamiento::Memoria));
+    vector<string> estables{"estable"};
+    for (int d = 0; d < DIRECTORIOS_ESTABLES; d++) estables.push_back(rutaEstable(d, -1));
+    for (int d = 0; d < DIRECTORIOS_ESTABLES; d++) {
+        for (int a = 0; a < ARCHIVOS_ESTABLES; a++) estables.push_back(rutaEstable(d, a));
+    }
+    for (const string& ruta : estables) {
+        bool directorio = ruta.find("/f") == string::npos;
+        if (arbol.insertar(ruta, directorio) != 0) {
+            fprintf(stderr, "no se pudo insertar '%s'\n", ruta.c_str());
+            return 1;
+        }
+    }
+    arbol.activarConcurrencia(true);
+    
+    atomic<bool> terminar{false};
+    atomic<long> fallas{0};
+    atomic<long> busquedas{0};
+    vector<thread> lectores;
+    for (int h = 0; h < HILOS_LECTORES; h++) {
+        lectores.emplace_back([&, h] {
+            mt19937 generador(static_cast<unsigned>(h));
+            uniform_int_distribution<size_t> dis(0, estables.size() - 1);
+            long hechas = 0;
+            while (!terminar.load(memory_order_relaxed)) {
+                const string& ruta = estables[dis(generador)];
+                int esperado = ruta.find("/f") == string::npos ? 2 : 0;
+                int obtenido = arbol.buscar(ruta);
+                if (obtenido != esperado) {
+                    if (fallas.fetch_add(1) < 10) {
+                        fprintf(stderr, "buscar('%s'): %d, se esperaba %d\n", ruta.c_str(), obtenido, esperado);
+                    }
+                }
+                // Las rutas del escritor pueden estar o no, pero con un código válido
+                string volatil = rutaEstable(static_cast<int>(hechas % DIRECTORIOS_ESTABLES), -1) + "/v" + to_string(hechas % 97);
+                int codigo = arbol.buscar(volatil);
+                if (codigo < 0 || codigo > 2) fallas.fetch_add(1);
+                hechas++;
+            }
+            busquedas.fetch_add(hechas);
+        });
+    }
+    
+    // Escritor: archivos y directorios volátiles junto a los estables; los
+    // directorios se llenan, se mueven (con y sin cambio de nombre) y se
+    // eliminan enteros
+    mt19937 generador(7);
+    uniform_int_distribution<int> disDirectorio(0, DIRECTORIOS_ESTABLES - 1);
+    uniform_int_distribution<int> disNombre(0, 96);
+    uniform_int_distribution<int> disOperacion(0, 5);
+    for (int i = 0; i < OPERACIONES_ESCRITOR; i++) {
+        string padre = rutaEstable(disDirectorio(generador), -1);
+        string ruta = padre + "/v" + to_string(disNombre(generador));
+        switch (disOperacion(generador)) {
+            case 0:
+            case 1:
+                arbol.insertar(ruta, false);
+                break;
+            case 2:
+                if (arbol.insertar(ruta, true) == 0) {
+                    for (int j = 0; j < 8; j++) arbol.insertar(ruta + "/x" + to_string(j), false);
+                }
+                break;
+            case 3:
+                arbol.mover(ruta, rutaEstable(disDirectorio(generador), -1) + "/v" + to_string(disNombre(generador)));
+                break;
+            default:
+                arbol.eliminar(ruta);
+                break;
+        }
+    }
+    terminar.store(true);
+    for (thread& lector : lectores) lector.join();
+    arbol.activarConcurrencia(false);
+    
+    // Al terminar, el árbol sigue teniendo todas las rutas estables
+    for (const string& ruta : estables) {
+        if (arbol.buscar(ruta) != (ruta.find("/f") == string::npos ? 2 : 0)) fallas.fetch_add(1);
+    }
+    if (fallas.load() > 0) {
+        fprintf(stderr, "prueba_concurrencia: %ld fallas\n", fallas.load());
+        return 1;
+    }
+    printf("prueba_concurrencia: ok (%ld busquedas)\n", busquedas.load());
+    return 0;
+}
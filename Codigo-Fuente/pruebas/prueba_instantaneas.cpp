@@ -0,0 +1,271 @@
+#include "instantanea.h"
+#include "tree.h"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Prueba de las instantáneas: el árbol, las vistas y el almacenamiento se
+// comparan con un modelo (ruta -> es directorio) después de cada tanda de
+// operaciones y de cada revertir
+
+#define COMPROBAR(condicion, ...)                                          \
+    do {                                                                   \
+        if (!(condicion)) {                                                \
+            fprintf(stderr, "%s:%d: falla '%s': ", __FILE__, __LINE__, #condicion); \
+            fprintf(stderr, __VA_ARGS__);                                  \
+            fprintf(stderr, "\n");                                         \
+            exit(1);                                                       \
+        }                                                                  \
+    } while (0)
+
+using Modelo = map<string, bool>; // Ruta relativa -> es directorio
+
+static string padreDe(const string& ruta) {
+    size_t barra = ruta.rfind('/');
+    return barra == string::npos ? string() : ruta.substr(0, barra);
+}
+
+static bool esDirectorio(const Modelo& modelo, const string& ruta) {
+    if (ruta.empty()) return true;
+    auto it = modelo.find(ruta);
+    return it != modelo.end() && it->second;
+}
+
+// Quitar una ruta y todo lo que cuelga de ella
+static void quitarSubarbol(Modelo& modelo, const string& ruta) {
+    modelo.erase(ruta);
+    string prefijo = ruta + "/";
+    auto it = modelo.lower_bound(prefijo);
+    while (it != modelo.end() && it->first.starts_with(prefijo)) it = modelo.erase(it);
+}
+
+// Almacenamiento que refleja las operaciones en un modelo en memoria: sirve
+// para comprobar qué recibió el backend, incluido lo que revertir rehace
+class AlmacenamientoModelo : public Almacenamiento {
+public:
+    Modelo entradas;
+    
+    string rutaDestino(const string& directorioBase, string_view rutaRelativa) const override {
+        return string(rutaRelativa);
+    }
+    bool crearArchivo(const string& ruta) override { return crear(ruta, false); }
+    bool crearDirectorio(const string& ruta) override { return crear(ruta, true); }
+    bool eliminar(const string& ruta) override {
+        if (!entradas.contains(ruta)) return false;
+        quitarSubarbol(entradas, ruta);
+        return true;
+    }
+    bool renombrar(const string& origen, const string& destino) override {
+        if (!entradas.contains(origen) || entradas.contains(destino) || !esDirectorio(entradas, padreDe(destino))) {
+            return false;
+        }
+        Modelo movidas;
+        string prefijo = origen + "/";
+        for (auto it = entradas.lower_bound(prefijo); it != entradas.end() && it->first.starts_with(prefijo); ++it) {
+            movidas[destino + it->first.substr(origen.size())] = it->second;
+        }
+        movidas[destino] = entradas[origen];
+        quitarSubarbol(entradas, origen);
+        entradas.insert(movidas.begin(), movidas.end());
+        return true;
+    }
+    TipoAlmacenamiento tipo() const override { return TipoAlmacenamiento::Memoria; }
+
+private:
+    bool crear(const string& ruta, bool directorio) {
+        if (entradas.contains(ruta) || !esDirectorio(entradas, padreDe(ruta))) return false;
+        entradas[ruta] = directorio;
+        return true;
+    }
+};
+
+// Las mismas operaciones sobre el modelo, con los códigos del árbol
+static int insertarModelo(Modelo& modelo, const string& ruta, bool directorio) {
+    if (modelo.contains(ruta)) return 1;
+    if (!esDirectorio(modelo, padreDe(ruta))) return 2;
+    modelo[ruta] = directorio;
+    return 0;
+}
+
+static int eliminarModelo(Modelo& modelo, const string& ruta) {
+    if (!modelo.contains(ruta)) return 1;
+    quitarSubarbol(modelo, ruta);
+    return 0;
+}
+
+static int moverModelo(Modelo& modelo, const string& origen, const string& destino) {
+    if (!modelo.contains(origen)) return 1;
+    if (!esDirectorio(modelo, padreDe(destino))) return 3;
+    if (modelo.contains(destino)) return 2;
+    if (destino.starts_with(origen + "/")) return 3;
+    AlmacenamientoModelo mover;
+    mover.entradas = std::move(modelo);
+    mover.renombrar(origen, destino);
+    modelo = std::move(mover.entradas);
+    return 0;
+}
+
+static Modelo leerRecorrido(Recorrido recorrido) {
+    Modelo leido;
+    for (EntradaRecorrido entrada : recorrido) {
+        leido[string(entrada.ruta)] = !entrada.nodo->esArchivo();
+    }
+    return leido;
+}
+
+static void comprobarAgregados(const AgregadosSubarbol& agregados, const Modelo& modelo, const char* que) {
+    uint32_t archivos = 0, directorios = 0;
+    for (const auto& [ruta, directorio] : modelo) (directorio ? directorios : archivos)++;
+    COMPROBAR(agregados.archivos == archivos && agregados.directorios == directorios,
+              "%s: agregados %u/%u, modelo %u/%u", que, agregados.archivos, agregados.directorios, archivos, directorios);
+}
+
+// El árbol y el backend contra el modelo
+static void comprobarArbol(ArbolSistemaArchivos& arbol, const AlmacenamientoModelo& backend, const Modelo& modelo,
+                           const char* que) {
+    Modelo leido = leerRecorrido(arbol.recorrerSubarbol(""));
+    COMPROBAR(leido == modelo, "%s: el árbol tiene %zu rutas, el modelo %zu", que, leido.size(), modelo.size());
+    COMPROBAR(backend.entradas == modelo, "%s: el backend tiene %zu rutas, el modelo %zu", que,
+              backend.entradas.size(), modelo.size());
+    for (const auto& [ruta, directorio] : modelo) {
+        COMPROBAR(arbol.buscar(ruta) == (directorio ? 2 : 0), "%s: buscar('%s')", que, ruta.c_str());
+    }
+    AgregadosSubarbol agregados;
+    arbol.obtenerAgregados("", agregados);
+    comprobarAgregados(agregados, modelo, que);
+}
+
+static void comprobarVista(const Instantanea& vista, const Modelo& modelo, const char* que) {
+    Modelo leido = leerRecorrido(vista.recorrerSubarbol(""));
+    COMPROBAR(leido == modelo, "%s: la instantánea tiene %zu rutas, el modelo %zu", que, leido.size(), modelo.size());
+    for (const auto& [ruta, directorio] : modelo) {
+        COMPROBAR(vista.buscar(ruta) == (directorio ? 2 : 0), "%s: buscar('%s') en la instantánea", que, ruta.c_str());
+    }
+    AgregadosSubarbol agregados;
+    vista.obtenerAgregados("", agregados);
+    comprobarAgregados(agregados, modelo, que);
+}
+
+// Tanda de operaciones al azar sobre el árbol y el modelo: inserciones,
+// eliminaciones, movimientos y lotes, comparando cada código de retorno
+static void operar(ArbolSistemaArchivos& arbol, Modelo& modelo, mt19937_64& generador, int cantidad, int& contador) {
+    auto rutaAlAzar = [&](bool soloDirectorios) {
+        vector<string> candidatas{""};
+        for (const auto& [ruta, directorio] : modelo) {
+            if (directorio || !soloDirectorios) candidatas.push_back(ruta);
+        }
+        return candidatas[uniform_int_distribution<size_t>(0, candidatas.size() - 1)(generador)];
+    };
+    auto nombreNuevo = [&](const string& padre) {
+        string nombre = "n";
+        nombre += to_string(contador++);
+        return padre.empty() ? nombre : padre + "/" + nombre;
+    };
+    
+    for (int i = 0; i < cantidad; i++) {
+        int operacion = uniform_int_distribution<int>(0, 9)(generador);
+        if (operacion < 4) {
+            bool directorio = operacion == 0;
+            string ruta = operacion == 3 ? rutaAlAzar(false) : nombreNuevo(rutaAlAzar(true));
+            if (ruta.empty()) continue;
+            int esperado = insertarModelo(modelo, ruta, directorio);
+            int obtenido = arbol.insertar(ruta, directorio);
+            COMPROBAR(obtenido == esperado, "insertar('%s'): %d, se esperaba %d", ruta.c_str(), obtenido, esperado);
+        } else if (operacion < 6) {
+            string ruta = rutaAlAzar(false);
+            if (ruta.empty()) continue;
+            int esperado = eliminarModelo(modelo, ruta);
+            int obtenido = arbol.eliminar(ruta);
+            COMPROBAR(obtenido == esperado, "eliminar('%s'): %d, se esperaba %d", ruta.c_str(), obtenido, esperado);
+        } else if (operacion < 8) {
+            string origen = rutaAlAzar(false);
+            if (origen.empty()) continue;
+            // A veces a una ruta que ya existe o dentro de sí mismo
+            string destino = operacion == 7 ? rutaAlAzar(false) : nombreNuevo(rutaAlAzar(true));
+            if (destino.empty()) continue;
+            int esperado = moverModelo(modelo, origen, destino);
+            int obtenido = arbol.mover(origen, destino);
+            COMPROBAR(obtenido == esperado, "mover('%s', '%s'): %d, se esperaba %d", origen.c_str(), destino.c_str(),
+                      obtenido, esperado);
+        } else if (operacion == 8) {
+            vector<string> lote;
+            for (int j = 0; j < 20; j++) lote.push_back(nombreNuevo(rutaAlAzar(true)));
+            lote.push_back(lote.front()); // Repetida en el lote
+            vector<int> obtenidos = arbol.insertarLote(lote, false);
+            for (size_t j = 0; j < lote.size(); j++) {
+                int esperado = insertarModelo(modelo, lote[j], false);
+                COMPROBAR(obtenidos[j] == esperado, "insertarLote('%s'): %d, se esperaba %d", lote[j].c_str(),
+                          obtenidos[j], esperado);
+            }
+        } else {
+            // Solo archivos distintos: el orden dentro del lote no importa
+            set<string> elegidos;
+            for (int j = 0; j < 20; j++) {
+                string ruta = rutaAlAzar(false);
+                if (!ruta.empty() && !modelo[ruta]) elegidos.insert(ruta);
+            }
+            vector<string> lote(elegidos.begin(), elegidos.end());
+            lote.push_back("no/existe");
+            vector<int> obtenidos = arbol.eliminarLote(lote);
+            for (size_t j = 0; j < lote.size(); j++) {
+                int esperado = eliminarModelo(modelo, lote[j]);
+                COMPROBAR(obtenidos[j] == esperado, "eliminarLote('%s'): %d, se esperaba %d", lote[j].c_str(),
+                          obtenidos[j], esperado);
+            }
+        }
+    }
+}
+
+int main() {
+    mt19937_64 generador(12345);
+    int contador = 0;
+    
+    for (int ronda = 0; ronda < 5; ronda++) {
+        auto propio = make_unique<AlmacenamientoModelo>();
+        AlmacenamientoModelo& backend = *propio;
+        ArbolSistemaArchivos arbol(std::move(propio));
+        Modelo modelo;
+        operar(arbol, modelo, generador, 3000, contador);
+        comprobarArbol(arbol, backend, modelo, "carga");
+        
+        // Dos instantáneas anidadas, con cambios antes y después de la segunda
+        Modelo m0 = modelo;
+        Instantanea s0 = arbol.tomarInstantanea();
+        COMPROBAR(s0.valida(), "ronda %d: instantánea inválida", ronda);
+        operar(arbol, modelo, generador, 1500, contador);
+        Modelo m1 = modelo;
+        Instantanea s1 = arbol.tomarInstantanea();
+        operar(arbol, modelo, generador, 1500, contador);
+        
+        comprobarVista(s0, m0, "s0");
+        comprobarVista(s1, m1, "s1");
+        comprobarArbol(arbol, backend, modelo, "después de operar");
+        
+        COMPROBAR(arbol.revertir(s1), "ronda %d: revertir(s1)", ronda);
+        comprobarArbol(arbol, backend, m1, "revertido a s1");
+        comprobarVista(s0, m0, "s0 tras revertir a s1");
+        
+        modelo = m1;
+        operar(arbol, modelo, generador, 1000, contador);
+        comprobarArbol(arbol, backend, modelo, "después de revertir a s1");
+        COMPROBAR(arbol.revertir(s0), "ronda %d: revertir(s0)", ronda);
+        comprobarArbol(arbol, backend, m0, "revertido a s0");
+        
+        // Liberadas las vistas, el árbol sigue igual y admite más cambios
+        s1.liberar();
+        s0.liberar();
+        COMPROBAR(arbol.obtenerNumeroInstantaneas() == 0, "ronda %d: quedan instantáneas", ronda);
+        modelo = m0;
+        operar(arbol, modelo, generador, 500, contador);
+        comprobarArbol(arbol, backend, modelo, "después de liberar");
+    }
+    
+    printf("prueba_instantaneas: ok\n");
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "almacenamiento.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#ifdef __linux__
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#endif
+
+// Unir la raíz con la ruta relativa; la raíz sola si la ruta está vacía
+static string unirRuta(const string& raiz, string_view rutaRelativa) {
+    if (raiz.empty()) return string(rutaRelativa);
+    if (rutaRelativa.empty() || rutaRelativa == "/") return raiz;
+    
+    string rutaCompleta;
+    rutaCompleta.reserve(raiz.size() + 1 + rutaRelativa.size());
+    rutaCompleta += raiz;
+    rutaCompleta += '/';
+    rutaCompleta += rutaRelativa;
+    return rutaCompleta;
+}
+
+string AlmacenamientoSistema::rutaDestino(const string& directorioBase, string_view rutaRelativa) const {
+    return unirRuta(directorioBase, rutaRelativa);
+}
+
+// Crear archivo en el sistema de archivos
+bool AlmacenamientoSistema::crearArchivo(const string& ruta) {
+    try {
+        // Crear directorios padre si no existen
+        filesystem::create_directories(filesystem::path(ruta).parent_path());
+        
+        // Crear archivo vacío
+        ofstream archivo(ruta);
+        if (archivo.is_open()) {
+            archivo.close();
+            return true;
+        }
+        return false;
+    } catch (const filesystem::filesystem_error& e) {
+        cerr << "Error al crear archivo: " << e.what() << endl;
+        return false;
+    }
+}
+
+// Crear directorio en el sistema de archivos
+bool AlmacenamientoSistema::crearDirectorio(const string& ruta) {
+    try {
+        return filesystem::create_directories(ruta);
+    } catch (const filesystem::filesystem_error& e) {
+        cerr << "Error al crear directorio: " << e.what() << endl;
+        return false;
+    }
+}
+
+// Eliminar del sistema de archivos
+bool AlmacenamientoSistema::eliminar(const string& ruta) {
+    try {
+        if (filesystem::exists(ruta)) {
+            if (filesystem::is_directory(ruta)) {
+                // Eliminar directorio y todo su contenido
+                return filesystem::remove_all(ruta) > 0;
+            } else {
+                // Eliminar archivo
+                return filesystem::remove(ruta);
+            }
+        }
+        return false;
+    } catch (const filesystem::filesystem_error& e) {
+        cerr << "Error al eliminar: " << e.what() << endl;
+        return false;
+    }
+}
+
+// La papelera es hermana del directorio cargado: "<base>.papelera"
+string AlmacenamientoSistema::rutaPapelera(const string& directorioBase) const {
+    return directorioBase.empty() ? string() : directorioBase + SUFIJO_PAPELERA;
+}
+
+// Apartar con un rename (atómico y O(1) dentro de un sistema de archivos)
+bool AlmacenamientoSistema::mover(const string& origen, const string& destino) {
+    error_code ec;
+    filesystem::create_directories(filesystem::path(destino).parent_path(), ec);
+    filesystem::rename(origen, destino, ec);
+    return !ec;
+}
+
+#ifdef __linux__
+// renameat2 con RENAME_NOREPLACE: la comprobación de que el destino no existe
+// y el rename son una sola operación. Los sistemas de archivos que no tienen
+// la bandera responden EINVAL y se usa rename
+bool AlmacenamientoSistema::renombrar(const string& origen, const string& destino) {
+    if (renameat2(AT_FDCWD, origen.c_str(), AT_FDCWD, destino.c_str(), RENAME_NOREPLACE) == 0) return true;
+    return errno == EINVAL && rename(origen.c_str(), destino.c_str()) == 0;
+}
+
+int AlmacenamientoSistema::abrirDirectorio(const string& ruta) {
+    return open(ruta.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+// Las mismas operaciones que crearArchivo, crearDirectorio y eliminar, pero
+// sin crear padres: el directorio ya está abierto. Permisos como los de
+// ofstream y create_directories (los recorta la umask)
+bool AlmacenamientoSistema::crearArchivoEn(int directorio, const string& nombre) {
+    int fd = openat(directorio, nombre.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) return false;
+    close(fd);
+    return true;
+}
+
+bool AlmacenamientoSistema::crearDirectorioEn(int directorio, const string& nombre) {
+    return mkdirat(directorio, nombre.c_str(), 0777) == 0;
+}
+
+bool AlmacenamientoSistema::eliminarArchivoEn(int directorio, const string& nombre) {
+    return unlinkat(directorio, nombre.c_str(), 0) == 0;
+}
+#else
+bool AlmacenamientoSistema::renombrar(const string& origen, const string& destino) {
+    error_code ec;
+    filesystem::rename(origen, destino, ec);
+    return !ec;
+}
+
+int AlmacenamientoSistema::abrirDirectorio(const string& ruta) { return -1; }
+bool AlmacenamientoSistema::crearArchivoEn(int directorio, const string& nombre) { return false; }
+bool AlmacenamientoSistema::crearDirectorioEn(int directorio, const string& nombre) { return false; }
+bool AlmacenamientoSistema::eliminarArchivoEn(int directorio, const string& nombre) { return false; }
+#endif
+
+// Constructor
+AlmacenamientoEspejo::AlmacenamientoEspejo(const string& raizEspejo) : raiz(raizEspejo) {
+    while (raiz.size() > 1 && raiz.back() == '/') raiz.pop_back();
+}
+
+bool AlmacenamientoEspejo::abrir() {
+    error_code ec;
+    filesystem::create_directories(raiz, ec);
+    if (!filesystem::is_directory(raiz, ec)) {
+        cerr << "No se pudo crear el espejo en " << raiz << endl;
+        return false;
+    }
+    raiz = filesystem::absolute(raiz, ec).string();
+#ifdef __linux__
+    const long TMPFS_MAGIC_ESPEJO = 0x01021994; // TMPFS_MAGIC de <linux/magic.h>
+    struct statfs info;
+    if (statfs(raiz.c_str(), &info) == 0 && static_cast<long>(info.f_type) != TMPFS_MAGIC_ESPEJO) {
+        cerr << "Aviso: el espejo " << raiz << " no está en tmpfs" << endl;
+    }
+#endif
+    return true;
+}
+
+// La ruta de destino ignora el directorio cargado
+string AlmacenamientoEspejo::rutaDestino(const string& directorioBase, string_view rutaRelativa) const {
+    return unirRuta(raiz, rutaRelativa);
+}
+
+bool AlmacenamientoEspejo::crearDirectorio(const string& ruta) {
+    error_code ec;
+    return AlmacenamientoSistema::crearDirectorio(ruta) || filesystem::is_directory(ruta, ec);
+}
+
+bool AlmacenamientoEspejo::eliminar(const string& ruta) {
+    error_code ec;
+    return AlmacenamientoSistema::eliminar(ruta) || !filesystem::exists(ruta, ec);
+}
+
+string AlmacenamientoEspejo::rutaPapelera(const string& directorioBase) const {
+    return raiz + SUFIJO_PAPELERA;
+}
+
+// El padre del destino puede no estar en el espejo todavía
+bool AlmacenamientoEspejo::renombrar(const string& origen, const string& destino) {
+    error_code ec;
+    filesystem::create_directories(filesystem::path(destino).parent_path(), ec);
+    return AlmacenamientoSistema::renombrar(origen, destino) || !filesystem::exists(origen, ec);
+}
+
+bool AlmacenamientoEspejo::crearDirectorioEn(int directorio, const string& nombre) {
+#ifdef __linux__
+    return AlmacenamientoSistema::crearDirectorioEn(directorio, nombre) || errno == EEXIST;
+#else
+    return false;
+#endif
+}
+
+bool AlmacenamientoEspejo::eliminarArchivoEn(int directorio, const string& nombre) {
+#ifdef __linux__
+    return AlmacenamientoSistema::eliminarArchivoEn(directorio, nombre) || errno == ENOENT;
+#else
+    return false;
+#endif
+}
+
+unique_ptr<Almacenamiento> crearAlmacenamiento(TipoAlmacenamiento tipo, const string& raizEspejo) {
+    switch (tipo) {
+        case TipoAlmacenamiento::Memoria:
+            return make_unique<AlmacenamientoMemoria>();
+        case TipoAlmacenamiento::Sistema:
+            return make_unique<AlmacenamientoSistema>();
+        case TipoAlmacenamiento::Espejo: {
+            auto espejo = make_unique<AlmacenamientoEspejo>(raizEspejo);
+            if (!espejo->abrir()) return nullptr;
+            return espejo;
+        }
+    }
+    return nullptr;
+}
+
+const char* nombreAlmacenamiento(TipoAlmacenamiento tipo) {
+    switch (tipo) {
+        case TipoAlmacenamiento::Memoria: return "memoria";
+        case TipoAlmacenamiento::Sistema: return "sistema";
+        case TipoAlmacenamiento::Espejo: return "espejo";
+    }
+    return "?";
+}
+
+bool tipoAlmacenamientoDesdeNombre(string_view nombre, TipoAlmacenamiento& tipo) {
+    for (TipoAlmacenamiento t : {TipoAlmacenamiento::Memoria, TipoAlmacenamiento::Sistema, TipoAlmacenamiento::Espejo}) {
+        if (nombre == nombreAlmacenamiento(t)) {
+            tipo = t;
+            return true;
+        }
+    }
+    return false;
+}
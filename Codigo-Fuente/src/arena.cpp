@@ -0,0 +1,253 @@
+#include "arena.h"
+#include "tree.h"
+#include "contadores.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+
+static atomic<size_t> bytesArenas{0};
+static atomic<size_t> picoArenas{0};
+
+size_t obtenerBytesArenas() {
+    return bytesArenas.load(memory_order_relaxed);
+}
+
+size_t obtenerPicoArenas() {
+    return picoArenas.load(memory_order_relaxed);
+}
+
+void reiniciarPicoArenas() {
+    picoArenas.store(bytesArenas.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+// Constructor de la arena
+Arena::Arena(size_t tam)
+    : actual(nullptr), restante(0), tamBloque(tam), bytesReservados(0), bytesUsados(0) {}
+
+// Destructor: libera todos los bloques
+Arena::~Arena() {
+    liberarTodo();
+}
+
+// Pedir un bloque nuevo al sistema (al menos 'minimo' bytes)
+void Arena::nuevoBloque(size_t minimo) {
+    size_t tam = minimo > tamBloque ? minimo : tamBloque;
+    char* bloque = static_cast<char*>(::operator new(tam, align_val_t(alignof(max_align_t))));
+    bloques.push_back(bloque);
+    actual = bloque;
+    restante = tam;
+    bytesReservados += tam;
+    
+    size_t total = bytesArenas.fetch_add(tam, memory_order_relaxed) + tam;
+    size_t pico = picoArenas.load(memory_order_relaxed);
+    while (total > pico && !picoArenas.compare_exchange_weak(pico, total, memory_order_relaxed)) {}
+}
+
+// Reservar memoria alineada dentro del bloque actual
+void* Arena::reservar(size_t bytes, size_t alineacion) {
+    size_t relleno = (alineacion - reinterpret_cast<uintptr_t>(actual) % alineacion) % alineacion;
+    if (actual == nullptr || relleno + bytes > restante) {
+        nuevoBloque(bytes + alineacion);
+        relleno = (alineacion - reinterpret_cast<uintptr_t>(actual) % alineacion) % alineacion;
+    }
+    char* ptr = actual + relleno;
+    actual += relleno + bytes;
+    restante -= relleno + bytes;
+    bytesUsados += relleno + bytes;
+    return ptr;
+}
+
+// Copiar una cadena a la arena
+string_view Arena::copiarCadena(string_view cadena) {
+    if (cadena.empty()) return string_view();
+    char* destino = static_cast<char*>(reservar(cadena.size(), 1));
+    memcpy(destino, cadena.data(), cadena.size());
+    return string_view(destino, cadena.size());
+}
+
+// Liberar todos los bloques
+void Arena::liberarTodo() {
+    for (char* bloque : bloques) {
+        ::operator delete(bloque, align_val_t(alignof(max_align_t)));
+    }
+    bloques.clear();
+    actual = nullptr;
+    restante = 0;
+    bytesArenas.fetch_sub(bytesReservados, memory_order_relaxed);
+    bytesReservados = 0;
+    bytesUsados = 0;
+}
+
+// Adoptar los bloques de otra arena sin copiarlos
+void Arena::absorber(Arena& otra) {
+    bloques.insert(bloques.end(), otra.bloques.begin(), otra.bloques.end());
+    bytesReservados += otra.bytesReservados;
+    bytesUsados += otra.bytesUsados;
+    otra.bloques.clear();
+    otra.actual = nullptr;
+    otra.restante = 0;
+    otra.bytesReservados = 0;
+    otra.bytesUsados = 0;
+}
+
+// Constructor del lote
+LoteLibre::LoteLibre() : primerNodo(nullptr), ultimoNodo(nullptr), nodos(0) {
+    for (int clase = 0; clase < CLASES_HIJOS; clase++) {
+        primerBloque[clase] = nullptr;
+        ultimoBloque[clase] = nullptr;
+    }
+}
+
+// Encadenar un nodo por el mismo campo que usa la lista libre del almacén
+void LoteLibre::agregarNodo(NodoArbol* nodo) {
+    nodo->hijos.bloque = reinterpret_cast<BloqueHijos*>(primerNodo);
+    if (primerNodo == nullptr) ultimoNodo = nodo;
+    primerNodo = nodo;
+    nodos++;
+}
+
+// La clase se lee antes de pisar la cabecera con el enlace
+void LoteLibre::agregarBloque(BloqueHijos* bloque) {
+    if (bloque->clase < 0) return;
+    int clase = bloque->clase;
+    *reinterpret_cast<void**>(bloque) = primerBloque[clase];
+    if (primerBloque[clase] == nullptr) ultimoBloque[clase] = bloque;
+    primerBloque[clase] = bloque;
+}
+
+void LoteLibre::unir(LoteLibre& otro) {
+    if (otro.primerNodo != nullptr) {
+        otro.ultimoNodo->hijos.bloque = reinterpret_cast<BloqueHijos*>(primerNodo);
+        if (primerNodo == nullptr) ultimoNodo = otro.ultimoNodo;
+        primerNodo = otro.primerNodo;
+        nodos += otro.nodos;
+    }
+    for (int clase = 0; clase < CLASES_HIJOS; clase++) {
+        if (otro.primerBloque[clase] == nullptr) continue;
+        *static_cast<void**>(otro.ultimoBloque[clase]) = primerBloque[clase];
+        if (primerBloque[clase] == nullptr) ultimoBloque[clase] = otro.ultimoBloque[clase];
+        primerBloque[clase] = otro.primerBloque[clase];
+    }
+    otro = LoteLibre();
+}
+
+// Constructor del almacén
+AlmacenNodos::AlmacenNodos()
+    : arenaNodos(1 << 20), arenaNombres(1 << 20), arenaHijos(1 << 20),
+      nodosLibres(nullptr), nodosVivos(0), generacion(0) {
+    for (void*& lista : hijosLibres) lista = nullptr;
+}
+
+// Crear un nodo reutilizando uno libre si existe
+NodoArbol* AlmacenNodos::crearNodo(string_view nombre) {
+    void* memoria;
+    if (nodosLibres != nullptr) {
+        memoria = nodosLibres;
+        nodosLibres = reinterpret_cast<NodoArbol*>(nodosLibres->hijos.bloque);
+    } else {
+        memoria = arenaNodos.reservar(sizeof(NodoArbol), alignof(NodoArbol));
+    }
+    nodosVivos++;
+    CONTAR(reservas);
+    return new (memoria) NodoArbol(arenaNombres.copiarCadena(nombre));
+}
+
+// Devolver un nodo a la lista libre (el nombre queda en la arena hasta liberarTodo)
+void AlmacenNodos::liberarNodo(NodoArbol* nodo) {
+    nodo->hijos.bloque = reinterpret_cast<BloqueHijos*>(nodosLibres);
+    nodosLibres = nodo;
+    nodosVivos--;
+}
+
+// Reservar un bloque de hijos de capacidad 2^clase
+BloqueHijos* AlmacenNodos::reservarHijos(int clase) {
+    void*& lista = hijosLibres[clase];
+    void* memoria;
+    if (lista != nullptr) {
+        memoria = lista;
+        lista = *static_cast<void**>(memoria);
+    } else {
+        memoria = arenaHijos.reservar(sizeof(BloqueHijos) + ((sizeof(NodoArbol*) + sizeof(uint64_t)) << clase),
+                                      alignof(NodoArbol*));
+    }
+    CONTAR(reservas);
+    BloqueHijos* bloque = static_cast<BloqueHijos*>(memoria);
+    bloque->tam = 0;
+    bloque->clase = static_cast<int16_t>(clase);
+    bloque->segmentos = 0;
+    bloque->generacion = generacion;
+    return bloque;
+}
+
+// Devolver un bloque de hijos a la lista de su clase
+void AlmacenNodos::liberarHijos(BloqueHijos* bloque) {
+    if (bloque->clase < 0) return; // BLOQUE_DIRECTORIO_VACIO no pertenece al almacén
+    int clase = bloque->clase;
+    *reinterpret_cast<void**>(bloque) = hijosLibres[clase];
+    hijosLibres[clase] = bloque;
+}
+
+// Devolver un lote armado en otro hilo: se empalma cada cadena al frente de
+// la lista libre correspondiente
+void AlmacenNodos::devolver(LoteLibre& lote) {
+    if (lote.primerNodo != nullptr) {
+        lote.ultimoNodo->hijos.bloque = reinterpret_cast<BloqueHijos*>(nodosLibres);
+        nodosLibres = lote.primerNodo;
+        nodosVivos -= lote.nodos;
+    }
+    for (int clase = 0; clase < CLASES_HIJOS; clase++) {
+        if (lote.primerBloque[clase] == nullptr) continue;
+        *static_cast<void**>(lote.ultimoBloque[clase]) = hijosLibres[clase];
+        hijosLibres[clase] = lote.primerBloque[clase];
+    }
+    lote = LoteLibre();
+}
+
+// Liberar toda la memoria del almacén
+void AlmacenNodos::liberarTodo() {
+    arenaNodos.liberarTodo();
+    arenaNombres.liberarTodo();
+    arenaHijos.liberarTodo();
+    nodosLibres = nullptr;
+    for (void*& lista : hijosLibres) lista = nullptr;
+    nodosVivos = 0;
+}
+
+// Adoptar la memoria de otro almacén, encadenando sus listas libres a las propias
+void AlmacenNodos::absorber(AlmacenNodos& otro) {
+    arenaNodos.absorber(otro.arenaNodos);
+    arenaNombres.absorber(otro.arenaNombres);
+    arenaHijos.absorber(otro.arenaHijos);
+    
+    while (otro.nodosLibres != nullptr) {
+        NodoArbol* nodo = otro.nodosLibres;
+        otro.nodosLibres = reinterpret_cast<NodoArbol*>(nodo->hijos.bloque);
+        nodo->hijos.bloque = reinterpret_cast<BloqueHijos*>(nodosLibres);
+        nodosLibres = nodo;
+    }
+    for (int clase = 0; clase < CLASES_HIJOS; clase++) {
+        while (otro.hijosLibres[clase] != nullptr) {
+            void* arreglo = otro.hijosLibres[clase];
+            otro.hijosLibres[clase] = *static_cast<void**>(arreglo);
+            *static_cast<void**>(arreglo) = hijosLibres[clase];
+            hijosLibres[clase] = arreglo;
+        }
+    }
+    
+    nodosVivos += otro.nodosVivos;
+    otro.nodosVivos = 0;
+}
+
+// Bytes reservados entre las tres arenas
+size_t AlmacenNodos::obtenerBytesReservados() const {
+    return arenaNodos.obtenerBytesReservados()
+         + arenaNombres.obtenerBytesReservados()
+         + arenaHijos.obtenerBytesReservados();
+}
+
+// Bytes entregados por las tres arenas (con lo que está en las listas libres)
+size_t AlmacenNodos::obtenerBytesUsados() const {
+    return arenaNodos.obtenerBytesUsados()
+         + arenaNombres.obtenerBytesUsados()
+         + arenaHijos.obtenerBytesUsados();
+}
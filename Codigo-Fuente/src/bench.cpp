@@ -0,0 +1,69 @@
+#include "benchmark.h"
+#include "generador.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+static void mostrarUso(const char* programa) {
+    printf("Uso: %s [--directorio D] [--semilla N] [--ensayos N] [--calentamiento N]\n"
+           "          [--operaciones N] [--escrituras N] [--hilos N] [--salida PREFIJO]\n"
+           "          [--almacenamiento memoria|sistema|espejo] [--espejo DIRECTORIO]\n"
+           "          [--generar DIRECTORIOS,ARCHIVOS]\n"
+           "Con --generar se recrea el directorio con la semilla antes de medir\n", programa);
+}
+
+int main(int argc, char** argv) {
+    ConfiguracionBenchmark config;
+    ParametrosDatos datos;
+    bool generar = false;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            mostrarUso(argv[0]);
+            return 1;
+        }
+        const char* opcion = argv[i];
+        const char* valor = argv[++i];
+        if (strcmp(opcion, "--directorio") == 0) config.directorio = valor;
+        else if (strcmp(opcion, "--salida") == 0) config.salida = valor;
+        else if (strcmp(opcion, "--semilla") == 0) config.semilla = strtoull(valor, nullptr, 10);
+        else if (strcmp(opcion, "--ensayos") == 0) config.ensayos = max(1, atoi(valor));
+        else if (strcmp(opcion, "--calentamiento") == 0) config.calentamiento = max(0, atoi(valor));
+        else if (strcmp(opcion, "--operaciones") == 0) config.operaciones = max(1, atoi(valor));
+        else if (strcmp(opcion, "--escrituras") == 0) config.operacionesEscritura = max(1, atoi(valor));
+        else if (strcmp(opcion, "--hilos") == 0) config.hilos = max(1, atoi(valor));
+        else if (strcmp(opcion, "--espejo") == 0) config.raizEspejo = valor;
+        else if (strcmp(opcion, "--generar") == 0 &&
+                 sscanf(valor, "%d,%d", &datos.directorios, &datos.archivos) == 2) generar = true;
+        else if (strcmp(opcion, "--almacenamiento") != 0 ||
+                 !tipoAlmacenamientoDesdeNombre(valor, config.almacenamiento)) {
+            mostrarUso(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (generar) {
+        datos.semilla = config.semilla;
+        PlanDatos plan(datos);
+        printf("Generando %zu directorios y %llu archivos en '%s'\n", plan.obtenerDirectorios().size(),
+               static_cast<unsigned long long>(plan.obtenerTotalArchivos()), config.directorio.c_str());
+        if (!generarEnDisco(plan, config.directorio, max(1, static_cast<int>(thread::hardware_concurrency())))) {
+            return 1;
+        }
+    }
+    
+    BancoPruebas banco(config);
+    if (!banco.ejecutar()) return 1;
+    banco.imprimirResumen();
+    
+    string json = config.salida + ".json";
+    string csv = config.salida + ".csv";
+    if (!banco.escribirJson(json) || !banco.escribirCsv(csv)) {
+        fprintf(stderr, "No se pudieron escribir los resultados\n");
+        return 1;
+    }
+    printf("Resultados: %s, %s\n", json.c_str(), csv.c_str());
+    return 0;
+}
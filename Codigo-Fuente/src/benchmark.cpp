@@ -0,0 +1,419 @@
+#include "benchmark.h"
+#include "directorio.h"
+#include "sucinto.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+// Cubetas: las primeras SUBCUBETAS son exactas; después, SUBCUBETAS por potencia de dos
+HistogramaLatencias::HistogramaLatencias()
+    : cubetas((64 - BITS_SUBCUBETA + 1) * SUBCUBETAS, 0), conteo(0), suma(0), minimo(UINT64_MAX), maximo(0) {}
+
+size_t HistogramaLatencias::cubeta(uint64_t valor) {
+    if (valor < SUBCUBETAS) return static_cast<size_t>(valor);
+    int exponente = static_cast<int>(bit_width(valor)) - 1;
+    int desplazamiento = exponente - BITS_SUBCUBETA;
+    size_t sub = static_cast<size_t>(valor >> desplazamiento) & (SUBCUBETAS - 1);
+    return static_cast<size_t>(desplazamiento + 1) * SUBCUBETAS + sub;
+}
+
+// Mayor valor que cae en la cubeta
+uint64_t HistogramaLatencias::limiteSuperior(size_t indice) {
+    if (indice < SUBCUBETAS) return indice;
+    int desplazamiento = static_cast<int>(indice / SUBCUBETAS) - 1;
+    uint64_t sub = indice % SUBCUBETAS;
+    uint64_t inferior = (SUBCUBETAS + sub) << desplazamiento;
+    return inferior + (uint64_t(1) << desplazamiento) - 1;
+}
+
+void HistogramaLatencias::registrar(uint64_t nanosegundos) {
+    cubetas[cubeta(nanosegundos)]++;
+    conteo++;
+    suma += nanosegundos;
+    minimo = min(minimo, nanosegundos);
+    maximo = max(maximo, nanosegundos);
+}
+
+void HistogramaLatencias::fusionar(const HistogramaLatencias& otro) {
+    for (size_t i = 0; i < cubetas.size(); i++) {
+        cubetas[i] += otro.cubetas[i];
+    }
+    conteo += otro.conteo;
+    suma += otro.suma;
+    minimo = min(minimo, otro.minimo);
+    maximo = max(maximo, otro.maximo);
+}
+
+uint64_t HistogramaLatencias::percentil(double p) const {
+    if (conteo == 0) return 0;
+    uint64_t rango = max<uint64_t>(1, static_cast<uint64_t>(p * static_cast<double>(conteo) + 0.999999));
+    uint64_t acumulado = 0;
+    for (size_t i = 0; i < cubetas.size(); i++) {
+        acumulado += cubetas[i];
+        if (acumulado >= rango) return min(limiteSuperior(i), maximo);
+    }
+    return maximo;
+}
+
+// Constructor
+BancoPruebas::BancoPruebas(const ConfiguracionBenchmark& config)
+    : configuracion(config), arbol(crearAlmacenamiento(config.almacenamiento, config.raizEspejo)),
+      generador(config.semilla), sobrecargaReloj(0.0) {}
+
+uint64_t BancoPruebas::ahora() {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Costo promedio de leer el reloj, para interpretar las latencias más cortas
+double BancoPruebas::medirSobrecargaReloj() {
+    const int MUESTRAS = 1000000;
+    uint64_t inicio = ahora();
+    uint64_t ultima = inicio;
+    for (int i = 0; i < MUESTRAS; i++) {
+        ultima = ahora();
+    }
+    return static_cast<double>(ultima - inicio) / MUESTRAS;
+}
+
+// Cada escenario reinicia el generador con una semilla derivada de su nombre:
+// agregar o quitar escenarios no cambia las operaciones de los demás
+template <typename Ensayo>
+void BancoPruebas::ejecutarEscenario(const string& nombre, const string& unidad, Ensayo ensayo) {
+    uint64_t semilla = configuracion.semilla;
+    for (char c : nombre) {
+        semilla = (semilla ^ static_cast<unsigned char>(c)) * 1099511628211ull; // FNV-1a
+    }
+    generador.seed(semilla);
+    
+    printf("=== %s (%d de calentamiento + %d ensayos) ===\n", nombre.c_str(),
+           configuracion.calentamiento, configuracion.ensayos);
+    ResultadoEscenario resultado{nombre, unidad, {}, {}};
+    for (int i = 0; i < configuracion.calentamiento + configuracion.ensayos; i++) {
+        HistogramaLatencias latencias;
+        double segundos = ensayo(i, latencias);
+        if (i < configuracion.calentamiento) continue;
+        resultado.latencias.fusionar(latencias);
+        resultado.segundosPorEnsayo.push_back(segundos);
+    }
+    resultados.push_back(std::move(resultado));
+}
+
+// Rutas que no existen en el árbol, repartidas en directorios al azar
+vector<string> BancoPruebas::rutasNuevas(int cantidad, int ensayo) {
+    uniform_int_distribution<size_t> dis(0, directorios.size() - 1);
+    vector<string> nuevas;
+    nuevas.reserve(static_cast<size_t>(cantidad));
+    for (int i = 0; i < cantidad; i++) {
+        const string& base = directorios[dis(generador)];
+        string nombre = "bench_" + to_string(ensayo) + "_" + to_string(i) + ".txt";
+        nuevas.push_back(base.empty() ? nombre : base + "/" + nombre);
+    }
+    return nuevas;
+}
+
+// Carga completa en un árbol nuevo: una muestra por ensayo
+void BancoPruebas::escenarioCarga() {
+    ejecutarEscenario("carga", "ns por carga", [&](int, HistogramaLatencias& latencias) {
+        ArbolSistemaArchivos nuevo;
+        uint64_t inicio = ahora();
+        nuevo.cargarDesdeDirectorio(configuracion.directorio, configuracion.hilos);
+        uint64_t fin = ahora();
+        latencias.registrar(fin - inicio);
+        return static_cast<double>(fin - inicio) / 1e9;
+    });
+}
+
+void BancoPruebas::escenarioBusqueda(const string& nombre, bool conIndice) {
+    arbol.activarIndice(conIndice);
+    ejecutarEscenario(nombre, "ns por busqueda", [&](int, HistogramaLatencias& latencias) {
+        uniform_int_distribution<size_t> dis(0, rutas.size() - 1);
+        vector<size_t> elegidas(static_cast<size_t>(configuracion.operaciones));
+        for (size_t& i : elegidas) i = dis(generador);
+        
+        uint64_t total = 0;
+        for (size_t i : elegidas) {
+            uint64_t inicio = ahora();
+            arbol.buscar(rutas[i]);
+            uint64_t fin = ahora();
+            latencias.registrar(fin - inicio);
+            total += fin - inicio;
+        }
+        return static_cast<double>(total) / 1e9;
+    });
+    arbol.activarIndice(false);
+}
+
+// Búsquedas en la representación sucinta del árbol cargado, con su memoria
+// junto a la del almacén de nodos
+void BancoPruebas::escenarioSucinto() {
+    ArbolSucinto congelado = arbol.congelar();
+    size_t nodos = max<size_t>(1, congelado.obtenerNumeroNodos());
+    printf("Sucinto: %zu bytes (%.1f bytes/nodo), almacen de nodos: %zu bytes (%.1f bytes/nodo)\n",
+           congelado.obtenerBytes(), static_cast<double>(congelado.obtenerBytes()) / static_cast<double>(nodos),
+           arbol.obtenerMemoriaReservada(), static_cast<double>(arbol.obtenerMemoriaReservada()) / static_cast<double>(nodos));
+    ejecutarEscenario("busqueda_sucinta", "ns por busqueda", [&](int, HistogramaLatencias& latencias) {
+        uniform_int_distribution<size_t> dis(0, rutas.size() - 1);
+        vector<size_t> elegidas(static_cast<size_t>(configuracion.operaciones));
+        for (size_t& i : elegidas) i = dis(generador);
+        
+        uint64_t total = 0;
+        for (size_t i : elegidas) {
+            uint64_t inicio = ahora();
+            congelado.buscar(rutas[i]);
+            uint64_t fin = ahora();
+            latencias.registrar(fin - inicio);
+            total += fin - inicio;
+        }
+        return static_cast<double>(total) / 1e9;
+    });
+}
+
+// Inserción y eliminación de archivos nuevos; cada ensayo deja el árbol como estaba
+void BancoPruebas::escenarioInsercionEliminacion() {
+    int cantidad = configuracion.operacionesEscritura;
+    ejecutarEscenario("insercion", "ns por insercion", [&](int ensayo, HistogramaLatencias& latencias) {
+        vector<string> nuevas = rutasNuevas(cantidad, ensayo);
+        uint64_t total = 0;
+        for (const string& ruta : nuevas) {
+            uint64_t inicio = ahora();
+            arbol.insertar(ruta, false);
+            uint64_t fin = ahora();
+            latencias.registrar(fin - inicio);
+            total += fin - inicio;
+        }
+        arbol.eliminarLote(nuevas);
+        return static_cast<double>(total) / 1e9;
+    });
+    
+    ejecutarEscenario("eliminacion", "ns por eliminacion", [&](int ensayo, HistogramaLatencias& latencias) {
+        vector<string> nuevas = rutasNuevas(cantidad, ensayo);
+        arbol.insertarLote(nuevas, false);
+        uint64_t total = 0;
+        for (const string& ruta : nuevas) {
+            uint64_t inicio = ahora();
+            arbol.eliminar(ruta);
+            uint64_t fin = ahora();
+            latencias.registrar(fin - inicio);
+            total += fin - inicio;
+        }
+        return static_cast<double>(total) / 1e9;
+    });
+}
+
+// Inserción por lotes de TAM_LOTE_BENCHMARK rutas: una muestra por lote
+void BancoPruebas::escenarioInsercionLote() {
+    int cantidad = configuracion.operacionesEscritura;
+    string unidad = "ns por lote de " + to_string(TAM_LOTE_BENCHMARK) + " rutas";
+    ejecutarEscenario("insercion_lote", unidad, [&](int ensayo, HistogramaLatencias& latencias) {
+        vector<string> nuevas = rutasNuevas(cantidad, ensayo);
+        uint64_t total = 0;
+        for (size_t inicio = 0; inicio < nuevas.size(); inicio += TAM_LOTE_BENCHMARK) {
+            vector<string> lote(nuevas.begin() + static_cast<ptrdiff_t>(inicio),
+                                nuevas.begin() + static_cast<ptrdiff_t>(min(nuevas.size(), inicio + TAM_LOTE_BENCHMARK)));
+            uint64_t antes = ahora();
+            arbol.insertarLote(lote, false);
+            uint64_t despues = ahora();
+            latencias.registrar(despues - antes);
+            total += despues - antes;
+        }
+        arbol.eliminarLote(nuevas);
+        return static_cast<double>(total) / 1e9;
+    });
+}
+
+// Inserción con manejadores de directorio abiertos antes de medir, sin resolver
+// la ruta del padre en cada operación: la misma cantidad de archivos que
+// "insercion", repartidos en MANEJADORES_BENCHMARK directorios al azar
+void BancoPruebas::escenarioManejadores() {
+    int cantidad = configuracion.operacionesEscritura;
+    ejecutarEscenario("manejador", "ns por insercion", [&](int ensayo, HistogramaLatencias& latencias) {
+        // Pocos manejadores reusados: cada uno ocupa un descriptor
+        uniform_int_distribution<size_t> dis(0, directorios.size() - 1);
+        vector<DirectorioAbierto> manejadores;
+        for (size_t m = 0; m < MANEJADORES_BENCHMARK; m++) {
+            manejadores.push_back(arbol.abrirDirectorio(directorios[dis(generador)]));
+        }
+        uniform_int_distribution<size_t> disManejador(0, manejadores.size() - 1);
+        vector<pair<size_t, string>> nuevos;
+        nuevos.reserve(static_cast<size_t>(cantidad));
+        for (int i = 0; i < cantidad; i++) {
+            nuevos.emplace_back(disManejador(generador), "bench_" + to_string(ensayo) + "_" + to_string(i) + ".txt");
+        }
+        
+        uint64_t total = 0;
+        size_t fallidas = 0;
+        for (const auto& [d, nombre] : nuevos) {
+            uint64_t inicio = ahora();
+            int resultado = arbol.insertarEn(manejadores[d], nombre);
+            uint64_t fin = ahora();
+            if (resultado != 0) fallidas++;
+            latencias.registrar(fin - inicio);
+            total += fin - inicio;
+        }
+        for (const auto& [d, nombre] : nuevos) {
+            arbol.eliminarEn(manejadores[d], nombre);
+        }
+        if (fallidas > 0) printf("  (%zu inserciones con manejador fallaron)\n", fallidas);
+        return static_cast<double>(total) / 1e9;
+    });
+}
+
+// Listado de directorios al azar y recorrido completo del árbol
+void BancoPruebas::escenarioRecorrido() {
+    ejecutarEscenario("listado", "ns por directorio", [&](int, HistogramaLatencias& latencias) {
+        uniform_int_distribution<size_t> dis(0, directorios.size() - 1);
+        uint64_t total = 0;
+        size_t hijos = 0;
+        for (int i = 0; i < configuracion.operaciones; i++) {
+            const string& ruta = directorios[dis(generador)];
+            uint64_t inicio = ahora();
+            for (NodoArbol* hijo : arbol.listarDirectorio(ruta)) {
+                hijos += hijo->nombre.size();
+            }
+            uint64_t fin = ahora();
+            latencias.registrar(fin - inicio);
+            total += fin - inicio;
+        }
+        if (hijos == 0) printf("  (directorios vacios)\n");
+        return static_cast<double>(total) / 1e9;
+    });
+    
+    ejecutarEscenario("recorrido", "ns por recorrido completo", [&](int, HistogramaLatencias& latencias) {
+        uint64_t inicio = ahora();
+        size_t bytesRutas = 0;
+        for (EntradaRecorrido entrada : arbol.recorrerSubarbol("")) {
+            bytesRutas += entrada.ruta.size();
+        }
+        uint64_t fin = ahora();
+        latencias.registrar(fin - inicio);
+        if (bytesRutas == 0) printf("  (arbol vacio)\n");
+        return static_cast<double>(fin - inicio) / 1e9;
+    });
+}
+
+// Ejecutar todos los escenarios
+bool BancoPruebas::ejecutar() {
+    if (!filesystem::is_directory(configuracion.directorio)) {
+        fprintf(stderr, "No existe el directorio '%s'\n", configuracion.directorio.c_str());
+        return false;
+    }
+    // Sin el backend pedido el árbol habría caído en el sistema de archivos
+    if (arbol.obtenerTipoAlmacenamiento() != configuracion.almacenamiento) return false;
+    sobrecargaReloj = medirSobrecargaReloj();
+    printf("Semilla %llu, almacenamiento %s, sobrecarga del reloj %.1f ns\n",
+           static_cast<unsigned long long>(configuracion.semilla),
+           nombreAlmacenamiento(configuracion.almacenamiento), sobrecargaReloj);
+    
+    escenarioCarga();
+    
+    arbol.cargarDesdeDirectorio(configuracion.directorio, configuracion.hilos);
+    directorios.assign(1, string());
+    for (EntradaRecorrido entrada : arbol.recorrerSubarbol("")) {
+        rutas.emplace_back(entrada.ruta);
+        if (!entrada.nodo->esArchivo()) directorios.emplace_back(entrada.ruta);
+    }
+    if (rutas.empty()) {
+        fprintf(stderr, "El directorio '%s' esta vacio\n", configuracion.directorio.c_str());
+        return false;
+    }
+    
+    escenarioBusqueda("busqueda", false);
+    escenarioBusqueda("busqueda_indice", true);
+    escenarioSucinto();
+    escenarioRecorrido();
+    escenarioInsercionEliminacion();
+    escenarioInsercionLote();
+    escenarioManejadores();
+    return true;
+}
+
+// Escapar una cadena para JSON
+static string escaparJson(const string& texto) {
+    string escapado;
+    for (char c : texto) {
+        if (c == '"' || c == '\\') {
+            escapado += '\\';
+            escapado += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char codigo[8];
+            snprintf(codigo, sizeof(codigo), "\\u%04x", static_cast<unsigned>(c));
+            escapado += codigo;
+        } else {
+            escapado += c;
+        }
+    }
+    return escapado;
+}
+
+bool BancoPruebas::escribirJson(const string& archivo) const {
+    ofstream out(archivo);
+    if (!out) return false;
+    
+    out << "{\n"
+        << "  \"directorio\": \"" << escaparJson(configuracion.directorio) << "\",\n"
+        << "  \"semilla\": " << configuracion.semilla << ",\n"
+        << "  \"ensayos\": " << configuracion.ensayos << ",\n"
+        << "  \"calentamiento\": " << configuracion.calentamiento << ",\n"
+        << "  \"operaciones\": " << configuracion.operaciones << ",\n"
+        << "  \"operacionesEscritura\": " << configuracion.operacionesEscritura << ",\n"
+        << "  \"hilos\": " << configuracion.hilos << ",\n"
+        << "  \"almacenamiento\": \"" << nombreAlmacenamiento(configuracion.almacenamiento) << "\",\n"
+        << "  \"nodos\": " << rutas.size() << ",\n"
+        << "  \"compilador\": \"" << escaparJson(__VERSION__) << "\",\n"
+        << "  \"sobrecargaRelojNs\": " << sobrecargaReloj << ",\n"
+        << "  \"escenarios\": [";
+    for (size_t i = 0; i < resultados.size(); i++) {
+        const ResultadoEscenario& r = resultados[i];
+        const HistogramaLatencias& h = r.latencias;
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"nombre\": \"" << r.nombre << "\", \"unidad\": \"" << r.unidad << "\""
+            << ", \"muestras\": " << h.obtenerConteo()
+            << ", \"media\": " << h.obtenerMedia()
+            << ", \"min\": " << h.obtenerMinimo()
+            << ", \"p50\": " << h.percentil(0.50)
+            << ", \"p95\": " << h.percentil(0.95)
+            << ", \"p99\": " << h.percentil(0.99)
+            << ", \"max\": " << h.obtenerMaximo()
+            << ", \"segundosPorEnsayo\": [";
+        for (size_t j = 0; j < r.segundosPorEnsayo.size(); j++) {
+            out << (j == 0 ? "" : ", ") << r.segundosPorEnsayo[j];
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+bool BancoPruebas::escribirCsv(const string& archivo) const {
+    ofstream out(archivo);
+    if (!out) return false;
+    
+    out << "Escenario,Unidad,Muestras,Media(ns),Min(ns),P50(ns),P95(ns),P99(ns),Max(ns),SegundosMedianaEnsayo\n";
+    for (const ResultadoEscenario& r : resultados) {
+        const HistogramaLatencias& h = r.latencias;
+        vector<double> segundos = r.segundosPorEnsayo;
+        sort(segundos.begin(), segundos.end());
+        double mediana = segundos.empty() ? 0.0 : segundos[segundos.size() / 2];
+        out << r.nombre << "," << r.unidad << "," << h.obtenerConteo() << "," << h.obtenerMedia() << ","
+            << h.obtenerMinimo() << "," << h.percentil(0.50) << "," << h.percentil(0.95) << ","
+            << h.percentil(0.99) << "," << h.obtenerMaximo() << "," << mediana << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+void BancoPruebas::imprimirResumen() const {
+    printf("\n%-16s %10s %12s %12s %12s %12s %14s\n", "Escenario", "Muestras", "Media(ns)", "P50(ns)",
+           "P95(ns)", "P99(ns)", "Max(ns)");
+    for (const ResultadoEscenario& r : resultados) {
+        const HistogramaLatencias& h = r.latencias;
+        printf("%-16s %10llu %12.1f %12llu %12llu %12llu %14llu\n", r.nombre.c_str(),
+               static_cast<unsigned long long>(h.obtenerConteo()), h.obtenerMedia(),
+               static_cast<unsigned long long>(h.percentil(0.50)),
+               static_cast<unsigned long long>(h.percentil(0.95)),
+               static_cast<unsigned long long>(h.percentil(0.99)),
+               static_cast<unsigned long long>(h.obtenerMaximo()));
+    }
+}
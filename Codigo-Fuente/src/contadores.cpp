@@ -0,0 +1,98 @@
+#include "contadores.h"
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef CONTADORES_ARBOL
+thread_local ContadoresArbol contadoresHilo;
+
+ContadoresArbol leerContadores() {
+    return contadoresHilo;
+}
+
+void reiniciarContadores() {
+    contadoresHilo = ContadoresArbol();
+}
+#else
+ContadoresArbol leerContadores() {
+    return ContadoresArbol();
+}
+
+void reiniciarContadores() {}
+#endif
+
+#ifdef __linux__
+// Eventos independientes (no un grupo): con inherit el kernel no permite leer
+// un grupo con PERF_FORMAT_GROUP
+static int abrirEvento(uint64_t configuracion) {
+    perf_event_attr atributos;
+    memset(&atributos, 0, sizeof(atributos));
+    atributos.size = sizeof(atributos);
+    atributos.type = PERF_TYPE_HARDWARE;
+    atributos.config = configuracion;
+    atributos.disabled = 1;
+    atributos.inherit = 1;
+    atributos.exclude_kernel = 1;
+    atributos.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &atributos, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+ContadoresHardware::ContadoresHardware() {
+    const uint64_t eventos[NUM_EVENTOS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < NUM_EVENTOS; i++) {
+        descriptores[i] = abrirEvento(eventos[i]);
+    }
+    // Todos o ninguno: un evento que falta no debe leerse como cero
+    bool todos = true;
+    for (int fd : descriptores) todos = todos && fd >= 0;
+    if (!todos) {
+        for (int& fd : descriptores) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+    }
+}
+
+ContadoresHardware::~ContadoresHardware() {
+    for (int fd : descriptores) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+void ContadoresHardware::iniciar() {
+    if (!disponible()) return;
+    for (int fd : descriptores) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+LecturaHardware ContadoresHardware::detener() {
+    LecturaHardware lectura;
+    if (!disponible()) return lectura;
+    uint64_t valores[NUM_EVENTOS] = {};
+    for (int i = 0; i < NUM_EVENTOS; i++) {
+        ioctl(descriptores[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(descriptores[i], &valores[i], sizeof(uint64_t)) != sizeof(uint64_t)) valores[i] = 0;
+    }
+    lectura.disponible = true;
+    lectura.ciclos = valores[0];
+    lectura.instrucciones = valores[1];
+    lectura.fallosCache = valores[2];
+    lectura.fallosRama = valores[3];
+    return lectura;
+}
+#else
+ContadoresHardware::ContadoresHardware() {
+    for (int& fd : descriptores) fd = -1;
+}
+
+ContadoresHardware::~ContadoresHardware() {}
+void ContadoresHardware::iniciar() {}
+LecturaHardware ContadoresHardware::detener() { return LecturaHardware(); }
+#endif
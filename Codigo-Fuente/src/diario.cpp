@@ -0,0 +1,182 @@
+#include "diario.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+// Constructor
+Diario::Diario(Aplicador a)
+    : aplicar(std::move(a)), fd(-1), totalAgregadas(0), totalAplicadas(0), fallidas(0), detener(false) {}
+
+// Destructor
+Diario::~Diario() {
+    cerrar();
+}
+
+// Abrir el diario, reaplicar los registros que hayan quedado y lanzar el volcado
+bool Diario::abrir(const string& archivo) {
+    if (fd >= 0) return false;
+    
+    fd = open(archivo.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        cerr << "Error al abrir el diario '" << archivo << "': " << strerror(errno) << endl;
+        return false;
+    }
+    
+    size_t reaplicadas = reproducir();
+    if (reaplicadas > 0) {
+        cerr << "Diario: " << reaplicadas << " operaciones reaplicadas" << endl;
+    }
+    
+    detener = false;
+    volcador = thread(&Diario::volcar, this);
+    return true;
+}
+
+// Leer los registros completos del archivo, aplicarlos y vaciarlo.
+// Un registro cortado al final (caída durante la escritura) se descarta, y
+// un tipo desconocido detiene la reproducción: lo que sigue no es confiable
+size_t Diario::reproducir() {
+    vector<char> contenido;
+    char buffer[1 << 16];
+    ssize_t leidos;
+    lseek(fd, 0, SEEK_SET);
+    while ((leidos = read(fd, buffer, sizeof(buffer))) > 0) {
+        contenido.insert(contenido.end(), buffer, buffer + leidos);
+    }
+    
+    // Lee 'longitud | texto' desde 'desde'; false si el registro está cortado
+    auto leerTexto = [&](size_t desde, string& texto, size_t& fin) {
+        uint32_t longitud;
+        if (desde + sizeof(longitud) > contenido.size()) return false;
+        memcpy(&longitud, contenido.data() + desde, sizeof(longitud));
+        if (desde + sizeof(longitud) + longitud > contenido.size()) return false;
+        texto.assign(contenido.data() + desde + sizeof(longitud), longitud);
+        fin = desde + sizeof(longitud) + longitud;
+        return true;
+    };
+    
+    size_t reaplicadas = 0;
+    size_t pos = 0;
+    while (pos < contenido.size()) {
+        uint8_t tipo = static_cast<uint8_t>(contenido[pos]);
+        if (tipo < static_cast<uint8_t>(TipoOperacion::CrearArchivo) || tipo > static_cast<uint8_t>(TipoOperacion::Mover)) {
+            cerr << "Diario: registro de tipo desconocido (" << static_cast<int>(tipo) << "), se descarta el resto" << endl;
+            break;
+        }
+        OperacionDiario op{static_cast<TipoOperacion>(tipo), string(), string()};
+        size_t fin;
+        if (!leerTexto(pos + 1, op.ruta, fin)) break;
+        if (op.tipo == TipoOperacion::Mover && !leerTexto(fin, op.destino, fin)) break;
+        
+        aplicar(op);
+        reaplicadas++;
+        pos = fin;
+    }
+    
+    if (ftruncate(fd, 0) != 0) {
+        cerr << "Error al vaciar el diario: " << strerror(errno) << endl;
+    }
+    return reaplicadas;
+}
+
+// Escribir un lote de registros de una vez y forzarlo a disco
+bool Diario::escribirLote(const vector<OperacionDiario>& lote) {
+    string registros;
+    for (const OperacionDiario& op : lote) {
+        uint32_t longitud = static_cast<uint32_t>(op.ruta.size());
+        registros += static_cast<char>(op.tipo);
+        registros.append(reinterpret_cast<const char*>(&longitud), sizeof(longitud));
+        registros += op.ruta;
+        if (op.tipo == TipoOperacion::Mover) {
+            longitud = static_cast<uint32_t>(op.destino.size());
+            registros.append(reinterpret_cast<const char*>(&longitud), sizeof(longitud));
+            registros += op.destino;
+        }
+    }
+    
+    const char* datos = registros.data();
+    size_t restantes = registros.size();
+    while (restantes > 0) {
+        ssize_t escritos = write(fd, datos, restantes);
+        if (escritos < 0) {
+            if (errno == EINTR) continue;
+            cerr << "Error al escribir el diario: " << strerror(errno) << endl;
+            return false;
+        }
+        datos += escritos;
+        restantes -= static_cast<size_t>(escritos);
+    }
+    return fdatasync(fd) == 0;
+}
+
+// Hilo de volcado: toma todo lo pendiente, lo registra, lo aplica y vacía el diario
+void Diario::volcar() {
+    vector<OperacionDiario> lote;
+    while (true) {
+        {
+            unique_lock<mutex> guardia(cerrojo);
+            hayTrabajo.wait(guardia, [this] { return detener || !pendientes.empty(); });
+            if (pendientes.empty()) return; // detener y nada pendiente
+            lote.swap(pendientes);
+        }
+        
+        // Si no se pudo registrar, el lote se aplica igual (el árbol ya lo
+        // refleja) pero cuenta entero como fallido: no fue durable
+        bool registrado = escribirLote(lote);
+        size_t fallasLote = 0;
+        for (const OperacionDiario& op : lote) {
+            if (!aplicar(op)) fallasLote++;
+        }
+        if (!registrado) fallasLote = lote.size();
+        // Todo lo registrado ya está aplicado
+        if (ftruncate(fd, 0) != 0) {
+            cerr << "Error al vaciar el diario: " << strerror(errno) << endl;
+            fallasLote = max<size_t>(fallasLote, 1);
+        }
+        
+        {
+            lock_guard<mutex> guardia(cerrojo);
+            totalAplicadas += lote.size();
+            fallidas += fallasLote;
+        }
+        aplicadas.notify_all();
+        lote.clear();
+    }
+}
+
+// Encolar una operación y despertar al volcador si estaba ocioso
+void Diario::agregar(TipoOperacion tipo, string ruta, string destino) {
+    bool estabaVacio;
+    {
+        lock_guard<mutex> guardia(cerrojo);
+        estabaVacio = pendientes.empty();
+        pendientes.push_back({tipo, std::move(ruta), std::move(destino)});
+        totalAgregadas++;
+    }
+    if (estabaVacio) hayTrabajo.notify_one();
+}
+
+// Barrera: esperar a que se aplique todo lo encolado hasta ahora
+bool Diario::sincronizar() {
+    unique_lock<mutex> guardia(cerrojo);
+    uint64_t objetivo = totalAgregadas;
+    aplicadas.wait(guardia, [&] { return totalAplicadas >= objetivo; });
+    bool exito = fallidas == 0;
+    fallidas = 0;
+    return exito;
+}
+
+// Aplicar lo pendiente, detener el hilo y cerrar el archivo
+void Diario::cerrar() {
+    if (fd < 0) return;
+    {
+        lock_guard<mutex> guardia(cerrojo);
+        detener = true;
+    }
+    hayTrabajo.notify_one();
+    volcador.join();
+    close(fd);
+    fd = -1;
+}
@@ -0,0 +1,61 @@
+#include "directorio.h"
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Mover: el manejador de origen queda inválido y sin descriptor
+DirectorioAbierto::DirectorioAbierto(DirectorioAbierto&& otro) noexcept {
+    tomar(otro);
+}
+
+DirectorioAbierto& DirectorioAbierto::operator=(DirectorioAbierto&& otro) noexcept {
+    if (this != &otro) {
+        soltar();
+        tomar(otro);
+    }
+    return *this;
+}
+
+DirectorioAbierto::~DirectorioAbierto() {
+    soltar();
+}
+
+// Quedarse con el estado de 'otro' y con su lugar en el registro del árbol
+void DirectorioAbierto::tomar(DirectorioAbierto& otro) {
+    unique_lock<mutex> guardia;
+    if (otro.arbol != nullptr) guardia = unique_lock<mutex>(otro.arbol->cerrojoManejadores);
+    
+    arbol = exchange(otro.arbol, nullptr);
+    ruta = std::move(otro.ruta);
+    ancestros = std::move(otro.ancestros);
+    huella = otro.huella;
+    version = otro.version;
+    fd = exchange(otro.fd, -1);
+    rutaMovida = std::move(otro.rutaMovida);
+    movido = otro.movido;
+    desenlazado = otro.desenlazado;
+    if (arbol != nullptr) replace(arbol->manejadores.begin(), arbol->manejadores.end(), &otro, this);
+}
+
+// Cerrar el descriptor y devolverlo al tope del árbol
+void DirectorioAbierto::cerrar() {
+    if (fd < 0) return;
+#ifdef __linux__
+    close(fd);
+#endif
+    arbol->descriptoresManejadores--;
+    fd = -1;
+}
+
+// Invalidar: cerrar el descriptor y salir del registro del árbol
+void DirectorioAbierto::soltar() {
+    if (arbol == nullptr) return;
+    cerrar();
+    ancestros.clear();
+    lock_guard<mutex> guardia(arbol->cerrojoManejadores);
+    erase(arbol->manejadores, this);
+    arbol = nullptr;
+}
@@ -0,0 +1,69 @@
+#include "epocas.h"
+#include <atomic>
+#include <thread>
+
+// Ranura de un lector, en su propia línea de caché
+struct alignas(64) RanuraLector {
+    atomic<uint64_t> epoca{0}; // 0 = fuera de una sección de lectura
+    atomic<bool> ocupada{false};
+};
+
+static RanuraLector ranuras[Epocas::MAX_LECTORES];
+static atomic<uint64_t> epocaGlobal{1};
+
+// Ranura asignada a cada hilo; se devuelve cuando el hilo termina
+struct RegistroHilo {
+    int ranura = -1;
+    int profundidad = 0; // Secciones de lectura anidadas abiertas
+    
+    ~RegistroHilo() {
+        if (ranura >= 0) ranuras[ranura].ocupada.store(false, memory_order_release);
+    }
+};
+
+static thread_local RegistroHilo registro;
+
+// Obtener la ranura del hilo, reclamando una libre la primera vez
+static int obtenerRanura() {
+    while (registro.ranura < 0) {
+        for (int i = 0; i < Epocas::MAX_LECTORES; i++) {
+            bool libre = false;
+            if (ranuras[i].ocupada.compare_exchange_strong(libre, true, memory_order_acq_rel)) {
+                registro.ranura = i;
+                break;
+            }
+        }
+        if (registro.ranura < 0) this_thread::yield(); // Todas ocupadas: esperar
+    }
+    return registro.ranura;
+}
+
+// Entrar: anunciar la época antes de leer cualquier puntero compartido.
+// Una sección anidada ya está protegida por la exterior
+GuardiaLectura::GuardiaLectura() : ranura(obtenerRanura()) {
+    if (registro.profundidad++ > 0) return;
+    ranuras[ranura].epoca.store(epocaGlobal.load(memory_order_seq_cst), memory_order_seq_cst);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+// Salir de la sección de lectura (la más externa limpia la ranura)
+GuardiaLectura::~GuardiaLectura() {
+    if (--registro.profundidad > 0) return;
+    ranuras[ranura].epoca.store(0, memory_order_release);
+}
+
+// Avanzar la época global y devolver la anterior como etiqueta
+uint64_t Epocas::avanzar() {
+    return epocaGlobal.fetch_add(1, memory_order_seq_cst);
+}
+
+// Recorrer las ranuras buscando la menor época anunciada
+uint64_t Epocas::minimaActiva() {
+    atomic_thread_fence(memory_order_seq_cst);
+    uint64_t minima = UINT64_MAX;
+    for (const RanuraLector& r : ranuras) {
+        uint64_t epoca = r.epoca.load(memory_order_seq_cst);
+        if (epoca != 0 && epoca < minima) minima = epoca;
+    }
+    return minima;
+}
@@ -1,12 +1,16 @@
 #include "experimentacion.h"
+#include "generador.h"
+#include "instantanea.h"
 #include "tree.h" 
 #include <chrono>    
 #include <fstream>   
 #include <iostream>  
 #include <cstdio>    
 #include <random>    
+#include <atomic>
+#include <thread>
 // Constructor
-ExperimentacionArbol::ExperimentacionArbol() {
+ExperimentacionArbol::ExperimentacionArbol() : generador(SEMILLA_EXPERIMENTOS) {
     arbol = new ArbolSistemaArchivos();
 }
 
@@ -15,64 +19,166 @@ ExperimentacionArbol::~ExperimentacionArbol() {
     delete arbol;
 }
 
+// Los contadores del árbol son del hilo: las fases medidas corren en este
+void ExperimentacionArbol::empezarFase() {
+    reiniciarContadores();
+    hardware.iniciar();
+}
+
+void ExperimentacionArbol::terminarFase(const char* nombre, double operaciones) {
+    MetricasFase fase{nombre, operaciones, hardware.detener(), leerContadores()};
+    if (operaciones > 0 && fase.hardware.disponible) {
+        const LecturaHardware& h = fase.hardware;
+        printf("  [%s] ciclos/op %.1f, instrucciones/op %.1f, IPC %.2f, fallos LLC/op %.2f, fallos rama/op %.2f\n",
+               nombre, static_cast<double>(h.ciclos) / operaciones, static_cast<double>(h.instrucciones) / operaciones,
+               h.ciclos > 0 ? static_cast<double>(h.instrucciones) / static_cast<double>(h.ciclos) : 0.0,
+               static_cast<double>(h.fallosCache) / operaciones, static_cast<double>(h.fallosRama) / operaciones);
+    }
+    if (operaciones > 0 && contadoresCompilados()) {
+        const ContadoresArbol& c = fase.arbol;
+        printf("  [%s] nodos/op %.2f, comparaciones/op %.2f, reservas/op %.2f, llamadas al sistema/op %.2f\n",
+               nombre, static_cast<double>(c.nodosVisitados) / operaciones,
+               static_cast<double>(c.comparaciones) / operaciones, static_cast<double>(c.reservas) / operaciones,
+               static_cast<double>(c.llamadasSistema) / operaciones);
+    }
+    fases.push_back(fase);
+}
+
 // Seleccionar rutas Aleatorios
 vector<string> ExperimentacionArbol::seleccionarRutasAleatorios(int cantidad) {
     vector<string> seleccion;
     if (rutasDisponibles.empty()) return seleccion;
-    random_device rd; mt19937 gen(rd());
     uniform_int_distribution<> dis(0, static_cast<int>(rutasDisponibles.size()) - 1);
     for (int i = 0; i < cantidad && i < static_cast<int>(rutasDisponibles.size()); ++i) {
-        seleccion.push_back(rutasDisponibles[dis(gen)]);
+        seleccion.push_back(rutasDisponibles[dis(generador)]);
     }
     return seleccion;
 }
 
+// Muestra uniforme de hasta MUESTRA_RUTAS rutas (reservorio), recorriendo el
+// árbol sin copiar todas sus rutas
+void ExperimentacionArbol::muestrearRutas() {
+    rutasDisponibles.clear();
+    size_t vistas = 0;
+    for (EntradaRecorrido entrada : arbol->recorrerSubarbol("")) {
+        if (rutasDisponibles.size() < MUESTRA_RUTAS) {
+            rutasDisponibles.emplace_back(entrada.ruta);
+        } else {
+            uniform_int_distribution<size_t> dis(0, vistas);
+            size_t j = dis(generador);
+            if (j < MUESTRA_RUTAS) rutasDisponibles[j].assign(entrada.ruta);
+        }
+        vistas++;
+    }
+}
+
 // Seleccionar directorios aleatorios para inserción
 vector<string> ExperimentacionArbol::seleccionarDirectoriosAleatorios(int cantidad) {
     vector<string> dirs;
-    for (const auto &ruta : rutasDisponibles) {
-        if (arbol->buscar(ruta) == 2) // directorio
-            dirs.push_back(ruta);
+    for (EntradaRecorrido entrada : arbol->recorrerSubarbol("")) {
+        if (!entrada.nodo->esArchivo()) dirs.emplace_back(entrada.ruta);
     }
     if (dirs.empty()) return {""};
-    random_device rd; mt19937 gen(rd());
     uniform_int_distribution<> dis(0, static_cast<int>(dirs.size()) - 1);
     vector<string> seleccion;
     for (int i = 0; i < min(cantidad, static_cast<int>(dirs.size())); ++i) {
-        seleccion.push_back(dirs[dis(gen)]);
+        seleccion.push_back(dirs[dis(generador)]);
     }
     return seleccion;
 }
 
-// Generar datos con script externo
+// Generar el conjunto de datos con la semilla fija, en paralelo
 auto ExperimentacionArbol::generarDatos(int numDirs, int numFiles, const string& dir) -> void {
-     string cmd = "bash create_files.bash "
-                + to_string(numDirs) + " "
-                + to_string(numFiles) + " "
-                + dir;
-     system(cmd.c_str());
- }
+    ParametrosDatos parametros;
+    parametros.directorios = numDirs;
+    parametros.archivos = numFiles;
+    parametros.semilla = SEMILLA_EXPERIMENTOS;
+    int hilos = max(1, static_cast<int>(thread::hardware_concurrency()));
+    
+    printf("Generando '%s' con %d hilo(s)...\n", dir.c_str(), hilos);
+    auto start = chrono::steady_clock::now();
+    PlanDatos plan(parametros);
+    if (!generarEnDisco(plan, dir, hilos)) {
+        fprintf(stderr, "  No se pudo generar todo el conjunto de datos en '%s'\n", dir.c_str());
+    }
+    auto end = chrono::steady_clock::now();
+    printf("  %zu directorios y %llu archivos en %.2f s\n", plan.obtenerDirectorios().size(),
+           static_cast<unsigned long long>(plan.obtenerTotalArchivos()),
+           chrono::duration<double>(end - start).count());
+}
 // Medir tiempo de creación (segundos)
 auto ExperimentacionArbol::medirTiempoCreacion(const string& dir) -> double {
     printf("Cargando datos desde '%s'...\n", dir.c_str());
+    empezarFase();
     auto start = chrono::high_resolution_clock::now();
     arbol->cargarDesdeDirectorio(dir);
-    rutasDisponibles = arbol->obtenerTodasLasRutas();
+    muestrearRutas();
     auto end = chrono::high_resolution_clock::now();
-    auto secs = chrono::duration_cast<chrono::seconds>(end - start);
-    return static_cast<double>(secs.count());
+    int nodos = arbol->obtenerNumeroNodos();
+    terminarFase("creacion", nodos);
+    if (nodos > 0) {
+        printf("  Memoria del arbol: %zu bytes (%.1f bytes/nodo)\n", arbol->obtenerMemoriaReservada(),
+               static_cast<double>(arbol->obtenerMemoriaReservada()) / nodos);
+    }
+    return chrono::duration<double>(end - start).count();
+}
+
+// Medir la carga paralela con 1, 2, 4, ... hilos (segundos) sobre árboles nuevos
+auto ExperimentacionArbol::medirEscalabilidadCreacion(const string& dir) -> vector<pair<int, double>> {
+    vector<pair<int, double>> tiempos;
+    int maxHilos = max(1, static_cast<int>(thread::hardware_concurrency()));
+    for (int hilos = 1; ; hilos = min(hilos * 2, maxHilos)) {
+        ArbolSistemaArchivos arbolCarga;
+        auto start = chrono::high_resolution_clock::now();
+        arbolCarga.cargarDesdeDirectorio(dir, hilos);
+        auto end = chrono::high_resolution_clock::now();
+        double segundos = chrono::duration<double>(end - start).count();
+        printf("  Carga con %d hilo(s): %.4f s\n", hilos, segundos);
+        tiempos.push_back({hilos, segundos});
+        if (hilos == maxHilos) break;
+    }
+    return tiempos;
+}
+
+// Guardar la imagen del árbol cargado y medir su apertura con mmap (segundos)
+auto ExperimentacionArbol::medirTiempoAperturaImagen(const string& dir) -> double {
+    string archivo = dir + ".img";
+    if (!arbol->guardarImagen(archivo)) return -1.0;
+    
+    ArbolSistemaArchivos arbolImagen;
+    auto start = chrono::high_resolution_clock::now();
+    bool abierta = arbolImagen.abrirImagen(archivo, dir);
+    auto end = chrono::high_resolution_clock::now();
+    return abierta ? chrono::duration<double>(end - start).count() : -1.0;
 }
 
 // Medir tiempo de búsqueda (ns promedio)
-auto ExperimentacionArbol::medirTiempoBusqueda(int rep) -> double {
+auto ExperimentacionArbol::medirTiempoBusqueda(int rep, const char* fase) -> double {
     if (rutasDisponibles.empty()) return 0.0;
     printf("Buscando %d rutas...\n", rep);
     auto pruebas = seleccionarRutasAleatorios(rep);
+    empezarFase();
     auto start = chrono::high_resolution_clock::now();
     for (const auto &r : pruebas) {
         arbol->buscar(r);
     }
     auto end = chrono::high_resolution_clock::now();
+    terminarFase(fase, static_cast<double>(pruebas.size()));
+    auto ns = chrono::duration_cast<chrono::nanoseconds>(end - start);
+    return static_cast<double>(ns.count()) / rep;
+}
+
+// Medir tiempo de búsqueda con buscarLote (ns promedio por ruta), sobre las
+// mismas rutas aleatorias: las búsquedas avanzan intercaladas
+double ExperimentacionArbol::medirTiempoBusquedaLote(int rep) {
+    if (rutasDisponibles.empty()) return 0.0;
+    printf("Buscando %d rutas en lote...\n", rep);
+    auto pruebas = seleccionarRutasAleatorios(rep);
+    empezarFase();
+    auto start = chrono::high_resolution_clock::now();
+    vector<int> resultados = arbol->buscarLote(pruebas);
+    auto end = chrono::high_resolution_clock::now();
+    terminarFase("busqueda_lote", static_cast<double>(pruebas.size()));
     auto ns = chrono::duration_cast<chrono::nanoseconds>(end - start);
     return static_cast<double>(ns.count()) / rep;
 }
@@ -84,26 +190,23 @@ double ExperimentacionArbol::medirTiempoEliminacion(int rep) {
     printf("Eliminando %d rutas...\n", rep);
     auto pruebas = seleccionarRutasAleatorios(rep);
     
-    // Guardar información de los archivos que vamos a eliminar para recrearlos
-    vector<pair<string, bool>> archivosEliminados; // ruta, esDirectorio
-    
-    for (const auto& r : pruebas) {
-        int tipo = arbol->buscar(r);
-        if (tipo != 1) { // Si existe (archivo o directorio)
-            archivosEliminados.push_back({r, tipo == 2}); // tipo 2 = directorio
-        }
-    }
+    // Instantánea para restaurar exactamente el conjunto de datos, incluidos
+    // los subárboles de los directorios eliminados. El tiempo medido incluye la
+    // copia de caminos que hace el árbol mientras la instantánea está viva
+    Instantanea antes = arbol->tomarInstantanea();
     
     // Medir tiempo de eliminación
+    empezarFase();
     auto start = chrono::high_resolution_clock::now();
     for (const auto& r : pruebas) {
         arbol->eliminar(r);
     }
     auto end = chrono::high_resolution_clock::now();
+    terminarFase("eliminacion", static_cast<double>(pruebas.size()));
     
-    // Recrear los archivos eliminados para mantener el conjunto de datos
-    for (const auto& archivo : archivosEliminados) {
-        arbol->insertar(archivo.first, archivo.second);
+    // Revertir: el almacenamiento recibe solo lo que se eliminó
+    if (antes.valida() && !arbol->revertir(antes)) {
+        printf("  Advertencia: no se pudo restaurar todo lo eliminado\n");
     }
     
     auto ns = chrono::duration_cast<chrono::nanoseconds>(end - start);
@@ -111,21 +214,20 @@ double ExperimentacionArbol::medirTiempoEliminacion(int rep) {
 }
 
 // Medir tiempo de inserción 
-double ExperimentacionArbol::medirTiempoInsercion(int rep) {
+double ExperimentacionArbol::medirTiempoInsercion(int rep, const char* fase) {
     printf("Insertando %d archivos...\n", rep);
     auto dirsIns = seleccionarDirectoriosAleatorios(DIRECTORIOS_INSERCION);
     
-    random_device rd; 
-    mt19937 gen(rd());
     uniform_int_distribution<> disFile(1, 1000000);
     uniform_int_distribution<> disDir(0, static_cast<int>(dirsIns.size()) - 1);
     
     vector<string> archivosInsertados; // Para limpiar después
     
+    empezarFase();
     auto start = chrono::high_resolution_clock::now();
     for (int i = 0; i < rep; ++i) {
-        auto base = dirsIns[disDir(gen)];
-        string name = "nuevo_archivo_" + to_string(disFile(gen)) + ".txt";
+        auto base = dirsIns[disDir(generador)];
+        string name = "nuevo_archivo_" + to_string(disFile(generador)) + ".txt";
         string ruta = base.empty() ? name : base + "/" + name;
         
         int resultado = arbol->insertar(ruta, false);
@@ -134,6 +236,7 @@ double ExperimentacionArbol::medirTiempoInsercion(int rep) {
         }
     }
     auto end = chrono::high_resolution_clock::now();
+    terminarFase(fase, rep);
     
     // Limpiar archivos insertados para no afectar otros experimentos
     for (const auto& archivo : archivosInsertados) {
@@ -144,40 +247,316 @@ double ExperimentacionArbol::medirTiempoInsercion(int rep) {
     return static_cast<double>(ns.count()) / rep;
 }
 
+// Medir tiempo de movimiento (ns promedio): directorios al azar, cada uno con
+// todo su subárbol, pasan a otro directorio con otro nombre. Los que fallan
+// (el destino quedaría dentro del origen, o un movimiento anterior ya se llevó
+// la ruta) también cuentan. Después se deshacen en orden inverso
+double ExperimentacionArbol::medirTiempoMovimiento(int rep) {
+    printf("Moviendo %d directorios...\n", rep);
+    auto origenes = seleccionarDirectoriosAleatorios(rep);
+    auto destinos = seleccionarDirectoriosAleatorios(DIRECTORIOS_INSERCION);
+    uniform_int_distribution<> disDir(0, static_cast<int>(destinos.size()) - 1);
+    
+    vector<pair<string, string>> movidos; // Para deshacerlos después
+    
+    empezarFase();
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < origenes.size(); ++i) {
+        const string& base = destinos[disDir(generador)];
+        string name = "movido_" + to_string(i);
+        string destino = base.empty() ? name : base + "/" + name;
+        
+        if (arbol->mover(origenes[i], destino) == 0) {
+            movidos.emplace_back(origenes[i], std::move(destino));
+        }
+    }
+    auto end = chrono::high_resolution_clock::now();
+    terminarFase("movimiento", static_cast<double>(origenes.size()));
+    
+    for (auto it = movidos.rbegin(); it != movidos.rend(); ++it) {
+        arbol->mover(it->second, it->first);
+    }
+    
+    auto ns = chrono::duration_cast<chrono::nanoseconds>(end - start);
+    return static_cast<double>(ns.count()) / static_cast<double>(origenes.size());
+}
+
+// Medir tiempo de inserción por lotes (ns promedio por ruta), con la misma
+// forma que medirTiempoInsercion: muchas rutas repartidas en pocos directorios
+double ExperimentacionArbol::medirTiempoInsercionLote(int rep) {
+    printf("Insertando %d archivos en lote...\n", rep);
+    auto dirsIns = seleccionarDirectoriosAleatorios(DIRECTORIOS_INSERCION);
+    
+    uniform_int_distribution<> disFile(1, 1000000);
+    uniform_int_distribution<> disDir(0, static_cast<int>(dirsIns.size()) - 1);
+    
+    vector<string> rutas;
+    rutas.reserve(static_cast<size_t>(rep));
+    for (int i = 0; i < rep; ++i) {
+        auto base = dirsIns[disDir(generador)];
+        string name = "nuevo_archivo_" + to_string(disFile(generador)) + ".txt";
+        rutas.push_back(base.empty() ? name : base + "/" + name);
+    }
+    
+    empezarFase();
+    auto start = chrono::high_resolution_clock::now();
+    vector<int> resultados = arbol->insertarLote(rutas, false);
+    auto end = chrono::high_resolution_clock::now();
+    terminarFase("insercion_lote", rep);
+    
+    // Limpiar archivos insertados para no afectar otros experimentos
+    vector<string> archivosInsertados;
+    for (size_t i = 0; i < rutas.size(); i++) {
+        if (resultados[i] == 0) archivosInsertados.push_back(rutas[i]);
+    }
+    arbol->eliminarLote(archivosInsertados);
+    
+    auto ns = chrono::duration_cast<chrono::nanoseconds>(end - start);
+    return static_cast<double>(ns.count()) / rep;
+}
+
+// Medir la inserción con escritura diferida (ns promedio): el tiempo medido es
+// solo el de modificar el árbol y encolar; la sincronización queda fuera
+double ExperimentacionArbol::medirTiempoInsercionDiferida(int rep, const string& dir) {
+    if (!arbol->activarEscrituraDiferida(dir + ".diario")) return -1.0;
+    double promedio = medirTiempoInsercion(rep, "insercion_diferida");
+    if (!arbol->sincronizar()) {
+        printf("  Advertencia: hubo operaciones diferidas con error\n");
+    }
+    arbol->desactivarEscrituraDiferida();
+    return promedio;
+}
+
+// Medir la sincronización incremental (ns promedio por evento): se crean archivos
+// por fuera del árbol y se mide solo procesarCambios, sin la creación
+double ExperimentacionArbol::medirTiempoSincronizacion(int cambios) {
+    if (!arbol->activarVigilancia()) return -1.0;
+    printf("Creando %d archivos por fuera del arbol...\n", cambios);
+    auto dirsIns = seleccionarDirectoriosAleatorios(DIRECTORIOS_INSERCION);
+    string base = arbol->obtenerDirectorioBase();
+    
+    vector<string> creados;
+    for (int i = 0; i < cambios; ++i) {
+        const string& dir = dirsIns[static_cast<size_t>(i) % dirsIns.size()];
+        string ruta = base + "/" + (dir.empty() ? "" : dir + "/") + "externo_" + to_string(i) + ".txt";
+        ofstream archivo(ruta);
+        if (archivo.is_open()) creados.push_back(ruta);
+    }
+    
+    empezarFase();
+    auto start = chrono::high_resolution_clock::now();
+    int aplicados = arbol->procesarCambios(0);
+    auto end = chrono::high_resolution_clock::now();
+    terminarFase("sincronizacion", aplicados);
+    
+    // Limpiar por fuera y dejar que el árbol lo siga
+    for (const auto& ruta : creados) {
+        filesystem::remove(ruta);
+    }
+    arbol->procesarCambios(0);
+    arbol->desactivarVigilancia();
+    
+    if (aplicados <= 0) return -1.0;
+    auto ns = chrono::duration_cast<chrono::nanoseconds>(end - start);
+    return static_cast<double>(ns.count()) / aplicados;
+}
+
+// Medir el rendimiento de búsquedas desde 1, 2, 4, ... hilos mientras otro hilo
+// inserta y elimina archivos sin pausa (millones de búsquedas por segundo)
+auto ExperimentacionArbol::medirLecturasConcurrentes(int rep) -> vector<pair<int, double>> {
+    vector<pair<int, double>> rendimiento;
+    if (rutasDisponibles.empty()) return rendimiento;
+    
+    auto pruebas = seleccionarRutasAleatorios(rep);
+    auto dirsEscritura = seleccionarDirectoriosAleatorios(DIRECTORIOS_INSERCION);
+    arbol->activarConcurrencia(true);
+    
+    int maxHilos = max(1, static_cast<int>(thread::hardware_concurrency()));
+    for (int hilos = 1; ; hilos = min(hilos * 2, maxHilos)) {
+        atomic<bool> terminado{false};
+        thread escritor([&]() {
+            for (size_t i = 0; !terminado.load(memory_order_relaxed); i++) {
+                const string& base = dirsEscritura[i % dirsEscritura.size()];
+                string name = "concurrente_" + to_string(i) + ".txt";
+                string ruta = base.empty() ? name : base + "/" + name;
+                if (arbol->insertar(ruta, false) == 0) {
+                    arbol->eliminar(ruta);
+                }
+            }
+        });
+        
+        vector<thread> lectores;
+        auto start = chrono::high_resolution_clock::now();
+        for (int h = 0; h < hilos; h++) {
+            lectores.emplace_back([&, h]() {
+                size_t n = pruebas.size();
+                for (size_t i = 0; i < n; i++) {
+                    arbol->buscar(pruebas[(i + static_cast<size_t>(h) * 7919) % n]);
+                }
+            });
+        }
+        for (thread& lector : lectores) lector.join();
+        auto end = chrono::high_resolution_clock::now();
+        terminado.store(true);
+        escritor.join();
+        
+        double segundos = chrono::duration<double>(end - start).count();
+        double millones = static_cast<double>(pruebas.size()) * hilos / segundos / 1e6;
+        printf("  %d lector(es): %.3f M busquedas/s\n", hilos, millones);
+        rendimiento.push_back({hilos, millones});
+        if (hilos == maxHilos) break;
+    }
+    
+    arbol->activarConcurrencia(false);
+    return rendimiento;
+}
+
 // Ejecutar experimento completo
 auto ExperimentacionArbol::ejecutarExperimento(int numDirs, int numFiles, const string& dir) -> ResultadoExperimento {
     ResultadoExperimento res;
     res.tamaño = numDirs + numFiles;
+    fases.clear();
+    if (!hardware.disponible()) printf("Contadores de hardware no disponibles (perf_event_open)\n");
     printf("=== Generando datos: %d dirs, %d files ===\n", numDirs, numFiles);
     generarDatos(numDirs, numFiles, dir);
     printf("=== Midiendo creacion ===\n");
     res.tiempoCreacion = medirTiempoCreacion(dir);
     printf("  Creacion: %.4f s\n", res.tiempoCreacion);
+    arbol->obtenerAgregados("", res.forma);
+    printf("  Forma: %u archivos, %u directorios, altura %u\n", res.forma.archivos, res.forma.directorios,
+           static_cast<unsigned>(res.forma.altura));
+    res.memoria = arbol->obtenerInformeMemoria();
+    const InformeMemoria& m = res.memoria;
+    printf("  Memoria: nodos %zu, nombres %zu, hijos %zu (+%zu de holgura), liberada %zu, cola de arenas %zu, "
+           "indice %zu; total %zu, pico de la carga %zu\n", m.nodos, m.nombres, m.hijos, m.holguraHijos,
+           m.liberada, m.colaArenas, m.indice, m.total, m.picoCarga);
+    printf("=== Midiendo apertura de la imagen ===\n");
+    res.tiempoAperturaImagen = medirTiempoAperturaImagen(dir);
+    printf("  Apertura imagen: %.6f s\n", res.tiempoAperturaImagen);
+    printf("=== Midiendo escalabilidad de la carga ===\n");
+    res.escalabilidadCreacion = medirEscalabilidadCreacion(dir);
     printf("=== Midiendo busqueda ===\n");
     res.tiempoPromedioBusqueda = medirTiempoBusqueda(REP);
     printf("  Busqueda: %.4f ns\n", res.tiempoPromedioBusqueda);
+    printf("=== Midiendo busqueda con indice hash ===\n");
+    arbol->activarIndice(true);
+    res.tiempoPromedioBusquedaIndice = medirTiempoBusqueda(REP, "busqueda_indice");
+    arbol->activarIndice(false);
+    printf("  Busqueda con indice: %.4f ns\n", res.tiempoPromedioBusquedaIndice);
+    printf("=== Midiendo busqueda por lotes ===\n");
+    res.tiempoPromedioBusquedaLote = medirTiempoBusquedaLote(REP);
+    printf("  Busqueda por lotes: %.4f ns\n", res.tiempoPromedioBusquedaLote);
     printf("=== Midiendo eliminacion ===\n");
     res.tiempoPromedioEliminacion = medirTiempoEliminacion(REP);
     printf("  Eliminacion: %.4f ns\n", res.tiempoPromedioEliminacion);
     printf("=== Midiendo insercion ===\n");
     res.tiempoPromedioInsercion = medirTiempoInsercion(REP);
     printf("  Insercion: %.4f ns\n", res.tiempoPromedioInsercion);
+    printf("=== Midiendo movimiento de directorios ===\n");
+    res.tiempoPromedioMovimiento = medirTiempoMovimiento(REP);
+    printf("  Movimiento: %.4f ns\n", res.tiempoPromedioMovimiento);
+    printf("=== Midiendo insercion con escritura diferida ===\n");
+    res.tiempoPromedioInsercionDiferida = medirTiempoInsercionDiferida(REP, dir);
+    printf("  Insercion diferida: %.4f ns\n", res.tiempoPromedioInsercionDiferida);
+    printf("=== Midiendo sincronizacion con inotify ===\n");
+    res.tiempoPromedioSincronizacion = medirTiempoSincronizacion(CAMBIOS_VIGILANCIA);
+    printf("  Sincronizacion: %.4f ns por evento\n", res.tiempoPromedioSincronizacion);
+    printf("=== Midiendo insercion por lotes ===\n");
+    res.tiempoPromedioInsercionLote = medirTiempoInsercionLote(REP);
+    printf("  Insercion por lotes: %.4f ns\n", res.tiempoPromedioInsercionLote);
+    printf("=== Midiendo lecturas concurrentes con escrituras ===\n");
+    res.lecturasConcurrentes = medirLecturasConcurrentes(REP);
+    res.fases = std::move(fases);
     return res;
 }
 
 // Generar reporte CSV
 auto ExperimentacionArbol::generarReporte(const vector<ResultadoExperimento>& resultados) -> void {
     ofstream out("resultados_experimentos.csv");
-    out << "Tamaño,TiempoCreacion(s),TiempoBusqueda(ns),TiempoEliminacion(ns),TiempoInsercion(ns)\n";
+    out << "Tamaño,Archivos,Directorios,Altura,TiempoCreacion(s),TiempoAperturaImagen(s),TiempoBusqueda(ns),TiempoBusquedaIndice(ns),TiempoBusquedaLote(ns),TiempoEliminacion(ns),TiempoInsercion(ns),TiempoMovimiento(ns),TiempoInsercionLote(ns),TiempoInsercionDiferida(ns),TiempoSincronizacion(ns)\n";
     for (const auto &r : resultados) {
         out << r.tamaño << ","
+            << r.forma.archivos << ","
+            << r.forma.directorios << ","
+            << r.forma.altura << ","
             << r.tiempoCreacion << ","
+            << r.tiempoAperturaImagen << ","
             << r.tiempoPromedioBusqueda << ","
+            << r.tiempoPromedioBusquedaIndice << ","
+            << r.tiempoPromedioBusquedaLote << ","
             << r.tiempoPromedioEliminacion << ","
-            << r.tiempoPromedioInsercion << "\n";
+            << r.tiempoPromedioInsercion << ","
+            << r.tiempoPromedioMovimiento << ","
+            << r.tiempoPromedioInsercionLote << ","
+            << r.tiempoPromedioInsercionDiferida << ","
+            << r.tiempoPromedioSincronizacion << "\n";
     }
     out.close();
     printf("Reporte generado: resultados_experimentos.csv\n");
+    
+    ofstream esc("escalabilidad_creacion.csv");
+    esc << "Tamaño,Hilos,TiempoCreacion(s)\n";
+    for (const auto &r : resultados) {
+        for (const auto &[hilos, segundos] : r.escalabilidadCreacion) {
+            esc << r.tamaño << "," << hilos << "," << segundos << "\n";
+        }
+    }
+    esc.close();
+    printf("Reporte generado: escalabilidad_creacion.csv\n");
+    
+    ofstream conc("lecturas_concurrentes.csv");
+    conc << "Tamaño,HilosLectores,MBusquedasPorSegundo\n";
+    for (const auto &r : resultados) {
+        for (const auto &[hilos, millones] : r.lecturasConcurrentes) {
+            conc << r.tamaño << "," << hilos << "," << millones << "\n";
+        }
+    }
+    conc.close();
+    printf("Reporte generado: lecturas_concurrentes.csv\n");
+    
+    ofstream mem("memoria.csv");
+    mem << "Tamaño,Nodos(B),Nombres(B),Hijos(B),HolguraHijos(B),Liberada(B),ColaArenas(B),Indice(B),"
+           "Total(B),PicoCarga(B),BytesPorNodo\n";
+    for (const auto &r : resultados) {
+        const InformeMemoria& m = r.memoria;
+        uint64_t nodos = uint64_t(r.forma.archivos) + r.forma.directorios;
+        mem << r.tamaño << "," << m.nodos << "," << m.nombres << "," << m.hijos << "," << m.holguraHijos << ","
+            << m.liberada << "," << m.colaArenas << "," << m.indice << "," << m.total << "," << m.picoCarga << ","
+            << (nodos > 0 ? static_cast<double>(m.total) / static_cast<double>(nodos) : 0.0) << "\n";
+    }
+    mem.close();
+    printf("Reporte generado: memoria.csv\n");
+    
+    // Todo por operación; vacío lo que no se midió
+    ofstream met("metricas_fases.csv");
+    met << "Tamaño,Fase,Operaciones,CiclosPorOp,InstruccionesPorOp,IPC,FallosLLCPorOp,FallosRamaPorOp,"
+           "NodosPorOp,ComparacionesPorOp,ReservasPorOp,LlamadasSistemaPorOp\n";
+    for (const auto &r : resultados) {
+        for (const auto &f : r.fases) {
+            if (f.operaciones <= 0) continue;
+            met << r.tamaño << "," << f.nombre << "," << f.operaciones << ",";
+            const LecturaHardware& h = f.hardware;
+            if (h.disponible) {
+                met << static_cast<double>(h.ciclos) / f.operaciones << ","
+                    << static_cast<double>(h.instrucciones) / f.operaciones << ","
+                    << (h.ciclos > 0 ? static_cast<double>(h.instrucciones) / static_cast<double>(h.ciclos) : 0.0) << ","
+                    << static_cast<double>(h.fallosCache) / f.operaciones << ","
+                    << static_cast<double>(h.fallosRama) / f.operaciones << ",";
+            } else {
+                met << ",,,,,";
+            }
+            if (contadoresCompilados()) {
+                met << static_cast<double>(f.arbol.nodosVisitados) / f.operaciones << ","
+                    << static_cast<double>(f.arbol.comparaciones) / f.operaciones << ","
+                    << static_cast<double>(f.arbol.reservas) / f.operaciones << ","
+                    << static_cast<double>(f.arbol.llamadasSistema) / f.operaciones << "\n";
+            } else {
+                met << ",,,\n";
+            }
+        }
+    }
+    met.close();
+    printf("Reporte generado: metricas_fases.csv\n");
 }
 
 // Ejecutar todos los experimentos
@@ -0,0 +1,222 @@
+#include "generador.h"
+#include "pool.h"
+#include "tree.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const size_t NUM_EXTENSIONES = sizeof(EXTENSIONES_GENERADAS) / sizeof(EXTENSIONES_GENERADAS[0]);
+
+// Finalizador de splitmix64: mezcla bien números consecutivos
+static inline uint64_t mezclar(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Constructor: el mismo recorrido por niveles que create_files.bash
+PlanDatos::PlanDatos(const ParametrosDatos& parametros) : semilla(parametros.semilla), totalArchivos(0) {
+    mt19937_64 generador(parametros.semilla);
+    int maxDirectorios = max(1, parametros.directorios);
+    uint64_t maxArchivos = static_cast<uint64_t>(max(0, parametros.archivos));
+    int64_t archivosPorDirectorio = parametros.archivos / maxDirectorios;
+    int variacion = max(0, parametros.variacionArchivos);
+    
+    directorios.reserve(static_cast<size_t>(maxDirectorios));
+    directorios.push_back({1, 0, 0, 0, 0});
+    size_t inicioNivel = 0, finNivel = 1;
+    
+    while (inicioNivel < finNivel &&
+           (directorios.size() < static_cast<size_t>(maxDirectorios) || totalArchivos < maxArchivos)) {
+        for (size_t i = inicioNivel; i < finNivel; i++) {
+            int64_t restantesDirectorios = maxDirectorios - static_cast<int64_t>(directorios.size());
+            uint64_t restantesArchivos = maxArchivos - totalArchivos;
+            if (restantesDirectorios <= 0 && restantesArchivos == 0) continue;
+            
+            int64_t subdirectorios = 0;
+            if (restantesDirectorios > 0) {
+                int64_t tope = min<int64_t>(restantesDirectorios, parametros.maxSubdirectorios);
+                subdirectorios = uniform_int_distribution<int64_t>(0, max<int64_t>(0, tope))(generador);
+            }
+            if (restantesArchivos > 0) {
+                int64_t archivos = uniform_int_distribution<int64_t>(0, 3 * variacion)(generador) - variacion;
+                archivos = clamp<int64_t>(archivos + archivosPorDirectorio, 1, static_cast<int64_t>(restantesArchivos));
+                directorios[i].primerArchivo = totalArchivos + 1;
+                directorios[i].numArchivos = static_cast<uint32_t>(archivos);
+                totalArchivos += static_cast<uint64_t>(archivos);
+            }
+            
+            directorios[i].primerHijo = static_cast<uint32_t>(directorios.size());
+            directorios[i].numHijos = static_cast<uint32_t>(subdirectorios);
+            for (int64_t s = 0; s < subdirectorios; s++) {
+                uint32_t numero = static_cast<uint32_t>(directorios.size() + 1);
+                directorios.push_back({numero, 0, 0, 0, 0});
+            }
+        }
+        inicioNivel = finNivel;
+        finNivel = directorios.size();
+    }
+}
+
+void PlanDatos::nombreArchivo(uint64_t numero, string& nombre) const {
+    char buffer[24];
+    auto [fin, ec] = to_chars(buffer, buffer + sizeof(buffer), numero);
+    nombre.assign("file_");
+    nombre.append(buffer, fin);
+    nombre += EXTENSIONES_GENERADAS[mezclar(semilla ^ numero) % NUM_EXTENSIONES];
+}
+
+void PlanDatos::nombreDirectorio(uint32_t numero, string& nombre) {
+    char buffer[16];
+    auto [fin, ec] = to_chars(buffer, buffer + sizeof(buffer), numero);
+    nombre.assign("dir_");
+    nombre.append(buffer, fin);
+}
+
+#ifdef __linux__
+// Crear los archivos y subdirectorios de un directorio ya creado. Cada
+// subdirectorio es una tarea nueva, que se abre relativa a la raíz
+static void generarDirectorio(PoolTrabajo& pool, const PlanDatos& plan, int fdRaiz, size_t indice,
+                              const string& ruta, atomic<bool>& fallo, int idHilo) {
+    int fd = ruta.empty() ? fdRaiz : openat(fdRaiz, ruta.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        fallo.store(true, memory_order_relaxed);
+        return;
+    }
+    
+    const PlanDatos::Directorio& directorio = plan.obtenerDirectorios()[indice];
+    string nombre;
+    for (uint32_t a = 0; a < directorio.numArchivos; a++) {
+        plan.nombreArchivo(directorio.primerArchivo + a, nombre);
+        int fdArchivo = openat(fd, nombre.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fdArchivo < 0) {
+            fallo.store(true, memory_order_relaxed);
+            continue;
+        }
+        close(fdArchivo);
+    }
+    
+    for (uint32_t h = 0; h < directorio.numHijos; h++) {
+        size_t hijo = directorio.primerHijo + h;
+        PlanDatos::nombreDirectorio(plan.obtenerDirectorios()[hijo].numero, nombre);
+        if (mkdirat(fd, nombre.c_str(), 0755) != 0 && errno != EEXIST) {
+            fallo.store(true, memory_order_relaxed);
+            continue;
+        }
+        string rutaHijo = ruta.empty() ? nombre : ruta + "/" + nombre;
+        pool.agregar(idHilo, [&pool, &plan, fdRaiz, hijo, rutaHijo, &fallo](int id) {
+            generarDirectorio(pool, plan, fdRaiz, hijo, rutaHijo, fallo, id);
+        });
+    }
+    
+    if (fd != fdRaiz) close(fd);
+}
+#else
+// Sin openat/mkdirat: las mismas tareas con rutas completas
+static void generarDirectorio(PoolTrabajo& pool, const PlanDatos& plan, const filesystem::path& ruta,
+                              size_t indice, atomic<bool>& fallo, int idHilo) {
+    const PlanDatos::Directorio& directorio = plan.obtenerDirectorios()[indice];
+    string nombre;
+    for (uint32_t a = 0; a < directorio.numArchivos; a++) {
+        plan.nombreArchivo(directorio.primerArchivo + a, nombre);
+        ofstream archivo(ruta / nombre);
+        if (!archivo.is_open()) fallo.store(true, memory_order_relaxed);
+    }
+    
+    for (uint32_t h = 0; h < directorio.numHijos; h++) {
+        size_t hijo = directorio.primerHijo + h;
+        PlanDatos::nombreDirectorio(plan.obtenerDirectorios()[hijo].numero, nombre);
+        filesystem::path rutaHijo = ruta / nombre;
+        error_code ec;
+        filesystem::create_directory(rutaHijo, ec);
+        if (ec) {
+            fallo.store(true, memory_order_relaxed);
+            continue;
+        }
+        pool.agregar(idHilo, [&pool, &plan, rutaHijo, hijo, &fallo](int id) {
+            generarDirectorio(pool, plan, rutaHijo, hijo, fallo, id);
+        });
+    }
+}
+#endif
+
+bool generarEnDisco(const PlanDatos& plan, const string& directorio, int numHilos) {
+    error_code ec;
+    filesystem::remove_all(directorio, ec);
+    filesystem::create_directories(directorio, ec);
+    if (ec) {
+        cerr << "No se pudo crear '" << directorio << "': " << ec.message() << endl;
+        return false;
+    }
+    
+    PoolTrabajo pool(numHilos);
+    atomic<bool> fallo(false);
+#ifdef __linux__
+    int fdRaiz = open(directorio.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fdRaiz < 0) return false;
+    pool.agregar(0, [&pool, &plan, fdRaiz, &fallo](int id) {
+        generarDirectorio(pool, plan, fdRaiz, 0, string(), fallo, id);
+    });
+    pool.ejecutar();
+    close(fdRaiz);
+#else
+    filesystem::path raiz(directorio);
+    pool.agregar(0, [&pool, &plan, raiz, &fallo](int id) {
+        generarDirectorio(pool, plan, raiz, 0, fallo, id);
+    });
+    pool.ejecutar();
+#endif
+    return !fallo.load();
+}
+
+// Construir el plan directamente en nodos del almacén, sin tocar el disco
+bool ArbolSistemaArchivos::cargarSintetico(const PlanDatos& plan) {
+    const BloqueHijos* hijosRaiz = raiz->hijos.leer();
+    if (modoConcurrente || imagen || almacenamiento->persistente() || !instantaneas.empty() ||
+        (hijosRaiz != nullptr && hijosRaiz->tam > 0)) {
+        return false;
+    }
+    
+    const vector<PlanDatos::Directorio>& directorios = plan.obtenerDirectorios();
+    vector<NodoArbol*> nodos(directorios.size(), nullptr);
+    nodos[0] = raiz;
+    vector<NodoArbol*> nuevos;
+    string nombre;
+    for (size_t i = 0; i < directorios.size(); i++) {
+        const PlanDatos::Directorio& directorio = directorios[i];
+        nuevos.clear();
+        for (uint32_t a = 0; a < directorio.numArchivos; a++) {
+            plan.nombreArchivo(directorio.primerArchivo + a, nombre);
+            nuevos.push_back(almacen.crearNodo(nombre));
+        }
+        for (uint32_t h = 0; h < directorio.numHijos; h++) {
+            size_t hijo = directorio.primerHijo + h;
+            PlanDatos::nombreDirectorio(directorios[hijo].numero, nombre);
+            NodoArbol* nodo = almacen.crearNodo(nombre);
+            nodo->marcarDirectorio();
+            nodos[hijo] = nodo;
+            nuevos.push_back(nodo);
+        }
+        asignarHijosOrdenados(almacen, nodos[i]->hijos, nuevos);
+    }
+    calcularAgregados(raiz);
+    
+    if (indiceActivo) {
+        indiceRutas.limpiar();
+        indexarSubarbol(raiz, HASH_RAIZ, true);
+    }
+    return true;
+}
@@ -0,0 +1,155 @@
+#include "imagen.h"
+#include "tree.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Constructor
+ImagenArbol::ImagenArbol()
+    : mapa(nullptr), tamMapa(0), cabecera(nullptr), nodos(nullptr), nombres(nullptr) {}
+
+// Destructor
+ImagenArbol::~ImagenArbol() {
+    cerrar();
+}
+
+// Liberar el mapeo actual
+void ImagenArbol::cerrar() {
+    if (mapa != nullptr) {
+        munmap(mapa, tamMapa);
+    }
+    mapa = nullptr;
+    tamMapa = 0;
+    cabecera = nullptr;
+    nodos = nullptr;
+    nombres = nullptr;
+}
+
+// Mapear el archivo completo y validar cabecera y tamaños
+bool ImagenArbol::abrir(const string& archivo) {
+    cerrar();
+    
+    int fd = open(archivo.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CabeceraImagen)) {
+        close(fd);
+        return false;
+    }
+    
+    size_t tam = static_cast<size_t>(info.st_size);
+    void* ptr = mmap(nullptr, tam, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) return false;
+    
+    mapa = ptr;
+    tamMapa = tam;
+    cabecera = static_cast<const CabeceraImagen*>(mapa);
+    
+    // Las búsquedas tocan páginas dispersas; no sirve leer por adelantado
+    madvise(mapa, tamMapa, MADV_RANDOM);
+    
+    if (memcmp(cabecera->magia, IMAGEN_MAGIA, sizeof(IMAGEN_MAGIA)) != 0
+        || cabecera->version != IMAGEN_VERSION
+        || cabecera->tamNodo != sizeof(NodoImagen)
+        || cabecera->numNodos == 0) {
+        cerrar();
+        return false;
+    }
+    
+    // Cada tamaño se acota por el archivo antes de sumar, para que no desborde
+    uint64_t disponible = tamMapa - sizeof(CabeceraImagen);
+    if (cabecera->numNodos > disponible / sizeof(NodoImagen)
+        || cabecera->bytesNombres > disponible
+        || cabecera->bytesBase > disponible
+        || cabecera->numNodos * sizeof(NodoImagen) + cabecera->bytesNombres
+           + cabecera->bytesBase != disponible) {
+        cerrar();
+        return false;
+    }
+    
+    const char* base = static_cast<const char*>(mapa);
+    nodos = reinterpret_cast<const NodoImagen*>(base + sizeof(CabeceraImagen));
+    nombres = reinterpret_cast<const char*>(nodos + cabecera->numNodos);
+    
+    // Los rangos de hijos y nombres deben caer dentro de sus tablas. En orden por
+    // niveles los hijos siempre van después del padre, lo que además descarta ciclos
+    uint64_t numNodos = cabecera->numNodos, bytesNombres = cabecera->bytesNombres;
+    for (uint64_t i = 0; i < numNodos; i++) {
+        const NodoImagen& n = nodos[i];
+        bool hijosValidos = n.numHijos == 0
+            || (n.primerHijo > i && n.primerHijo <= numNodos && n.numHijos <= numNodos - n.primerHijo);
+        bool nombreValido = n.nombre <= bytesNombres && n.longitud <= bytesNombres - n.nombre;
+        if (!hijosValidos || !nombreValido) {
+            cerrar();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ruta absoluta del directorio base guardada al final de la imagen
+string_view ImagenArbol::directorioBase() const {
+    return string_view(nombres + cabecera->bytesNombres, static_cast<size_t>(cabecera->bytesBase));
+}
+
+// Leer dispositivo, inodo y mtime de un directorio
+bool ImagenArbol::leerIdentidad(const string& directorio, CabeceraImagen& cab) {
+    struct stat info;
+    if (stat(directorio.c_str(), &info) != 0) return false;
+    cab.dispositivo = static_cast<uint64_t>(info.st_dev);
+    cab.inodo = static_cast<uint64_t>(info.st_ino);
+    cab.mtimeSeg = static_cast<int64_t>(info.st_mtim.tv_sec);
+    cab.mtimeNs = static_cast<int64_t>(info.st_mtim.tv_nsec);
+    return true;
+}
+
+// Comparar la identidad guardada con la actual del directorio
+bool ImagenArbol::esVigente(const string& directorioAbsoluto) const {
+    if (mapa == nullptr || directorioBase() != directorioAbsoluto) return false;
+    
+    CabeceraImagen actual;
+    if (!leerIdentidad(directorioAbsoluto, actual)) return false;
+    return actual.dispositivo == cabecera->dispositivo
+        && actual.inodo == cabecera->inodo
+        && actual.mtimeSeg == cabecera->mtimeSeg
+        && actual.mtimeNs == cabecera->mtimeNs;
+}
+
+// Búsqueda binaria entre los hijos contiguos de un nodo
+int64_t ImagenArbol::buscarHijo(const NodoImagen& padre, string_view nombreBuscado) const {
+    uint64_t izq = padre.primerHijo, der = padre.primerHijo + padre.numHijos;
+    
+    while (izq < der) {
+        uint64_t medio = izq + (der - izq) / 2;
+        int cmp = nombre(nodos[medio]).compare(nombreBuscado);
+        
+        if (cmp == 0) {
+            return static_cast<int64_t>(medio);
+        } else if (cmp < 0) {
+            izq = medio + 1;
+        } else {
+            der = medio;
+        }
+    }
+    
+    return -1; // No encontrado
+}
+
+// Recorrer la ruta desde la raíz (nodo 0) sin reservar memoria
+int64_t ImagenArbol::buscarNodo(string_view ruta) const {
+    int64_t actual = 0;
+    string_view componente;
+    
+    while (siguienteComponente(ruta, componente)) {
+        actual = buscarHijo(nodos[actual], componente);
+        if (actual == -1) {
+            return -1;
+        }
+    }
+    
+    return actual;
+}
@@ -0,0 +1,115 @@
+#include "indice.h"
+#include "tree.h"
+#include <bit>
+
+// Mezclar un byte en ambas mitades de la huella (FNV-1a y una variante rotada)
+static inline void mezclarByte(HashRuta& h, unsigned char c) {
+    h.a = (h.a ^ c) * 0x100000001b3ULL;
+    h.b = (rotl(h.b, 5) ^ c) * 0x9e3779b97f4a7c15ULL;
+}
+
+// Extender la huella del padre con un componente ('/' como separador)
+HashRuta extenderHash(HashRuta padre, string_view nombre, bool esRaiz) {
+    if (!esRaiz) mezclarByte(padre, '/');
+    for (char c : nombre) {
+        mezclarByte(padre, static_cast<unsigned char>(c));
+    }
+    return padre;
+}
+
+// Huella de la ruta tokenizada, equivalente a extenderla componente a componente
+HashRuta hashRuta(string_view ruta, string_view& ultimo) {
+    HashRuta huella = HASH_RAIZ;
+    string_view componente;
+    ultimo = string_view();
+    
+    while (siguienteComponente(ruta, componente)) {
+        huella = extenderHash(huella, componente, ultimo.empty());
+        ultimo = componente;
+    }
+    
+    return huella;
+}
+
+// Constructor
+IndiceRutas::IndiceRutas() : ocupadas(0) {}
+
+// Reservar capacidad para 'cantidad' rutas con factor de carga <= 1/2
+void IndiceRutas::reservar(size_t cantidad) {
+    size_t capacidad = bit_ceil(cantidad * 2 < 16 ? size_t(16) : cantidad * 2);
+    if (capacidad <= tabla.size()) return;
+    
+    vector<Entrada> anterior(capacidad, Entrada{HashRuta{0, 0}, nullptr});
+    anterior.swap(tabla);
+    ocupadas = 0;
+    for (const Entrada& entrada : anterior) {
+        if (entrada.nodo != nullptr) insertar(entrada.huella, entrada.nodo);
+    }
+}
+
+// Duplicar la tabla
+void IndiceRutas::crecer() {
+    reservar(tabla.empty() ? 8 : tabla.size());
+}
+
+// Insertar con sondeo lineal
+void IndiceRutas::insertar(const HashRuta& huella, NodoArbol* nodo) {
+    if ((ocupadas + 1) * 2 > tabla.size()) crecer();
+    
+    size_t mascara = tabla.size() - 1;
+    for (size_t i = casilla(huella); ; i = (i + 1) & mascara) {
+        Entrada& entrada = tabla[i];
+        if (entrada.nodo == nullptr) {
+            entrada = Entrada{huella, nodo};
+            ocupadas++;
+            return;
+        }
+        if (entrada.huella == huella) {
+            entrada.nodo = nodo;
+            return;
+        }
+    }
+}
+
+// Buscar: un sondeo hasta la primera casilla vacía
+NodoArbol* IndiceRutas::buscar(const HashRuta& huella) const {
+    if (tabla.empty()) return nullptr;
+    
+    size_t mascara = tabla.size() - 1;
+    for (size_t i = casilla(huella); ; i = (i + 1) & mascara) {
+        const Entrada& entrada = tabla[i];
+        if (entrada.nodo == nullptr) return nullptr;
+        if (entrada.huella == huella) return entrada.nodo;
+    }
+}
+
+// Eliminar y desplazar hacia atrás las entradas siguientes del mismo grupo
+void IndiceRutas::eliminar(const HashRuta& huella) {
+    if (tabla.empty()) return;
+    
+    size_t mascara = tabla.size() - 1;
+    size_t i = casilla(huella);
+    while (true) {
+        if (tabla[i].nodo == nullptr) return;
+        if (tabla[i].huella == huella) break;
+        i = (i + 1) & mascara;
+    }
+    
+    size_t hueco = i;
+    for (size_t j = (i + 1) & mascara; tabla[j].nodo != nullptr; j = (j + 1) & mascara) {
+        // Mover la entrada j al hueco si su casilla ideal no está entre el hueco y j
+        size_t ideal = casilla(tabla[j].huella);
+        if (((j - ideal) & mascara) >= ((j - hueco) & mascara)) {
+            tabla[hueco] = tabla[j];
+            hueco = j;
+        }
+    }
+    tabla[hueco] = Entrada{HashRuta{0, 0}, nullptr};
+    ocupadas--;
+}
+
+// Vaciar el índice
+void IndiceRutas::limpiar() {
+    vector<Entrada>().swap(tabla);
+    ocupadas = 0;
+}
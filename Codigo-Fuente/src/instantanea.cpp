@@ -0,0 +1,187 @@
+#include "instantanea.h"
+#include <utility>
+
+// Mover: la instantánea de origen queda inválida
+Instantanea::Instantanea(Instantanea&& otra) noexcept
+    : arbol(exchange(otra.arbol, nullptr)), raiz(exchange(otra.raiz, nullptr)), generacion(otra.generacion) {}
+
+Instantanea& Instantanea::operator=(Instantanea&& otra) noexcept {
+    if (this != &otra) {
+        liberar();
+        arbol = exchange(otra.arbol, nullptr);
+        raiz = exchange(otra.raiz, nullptr);
+        generacion = otra.generacion;
+    }
+    return *this;
+}
+
+Instantanea::~Instantanea() {
+    liberar();
+}
+
+void Instantanea::liberar() {
+    if (arbol == nullptr) return;
+    arbol->liberarInstantanea(generacion);
+    arbol = nullptr;
+    raiz = nullptr;
+}
+
+int Instantanea::buscar(string_view ruta) const {
+    NodoArbol* nodo = ArbolSistemaArchivos::buscarDesde(raiz, ruta);
+    if (nodo == nullptr) return 1;
+    return nodo->esArchivo() ? 0 : 2;
+}
+
+RangoHijos Instantanea::listarDirectorio(string_view ruta) const {
+    NodoArbol* nodo = ArbolSistemaArchivos::buscarDesde(raiz, ruta);
+    if (nodo == nullptr) return {};
+    const BloqueHijos* bloque = nodo->hijos.leer();
+    return {inicioHijos(bloque), finHijos(bloque), nullptr};
+}
+
+Recorrido Instantanea::recorrerSubarbol(string_view ruta) const {
+    Recorrido recorrido;
+    ArbolSistemaArchivos::iniciarRecorrido(recorrido, ArbolSistemaArchivos::buscarDesde(raiz, ruta), ruta);
+    return recorrido;
+}
+
+bool Instantanea::obtenerAgregados(string_view ruta, AgregadosSubarbol& agregados) const {
+    NodoArbol* nodo = ArbolSistemaArchivos::buscarDesde(raiz, ruta);
+    if (nodo == nullptr) return false;
+    agregados = nodo->agregados;
+    return true;
+}
+
+int Instantanea::obtenerNumeroNodos() const {
+    if (raiz == nullptr) return 0;
+    return static_cast<int>(raiz->agregados.archivos + raiz->agregados.directorios);
+}
+
+// Buscar desde una raíz cualquiera (la del árbol o la de una instantánea)
+NodoArbol* ArbolSistemaArchivos::buscarDesde(NodoArbol* inicio, string_view ruta) {
+    NodoArbol* nodoActual = inicio;
+    string_view componente;
+    while (nodoActual != nullptr && siguienteComponente(ruta, componente)) {
+        const BloqueHijos* bloque = nodoActual->hijos.leer();
+        int indice = busquedaBinaria(bloque, componente);
+        nodoActual = indice == -1 ? nullptr : bloque->hijo(static_cast<size_t>(indice));
+    }
+    return nodoActual;
+}
+
+// Cerrar la generación actual: lo reservado hasta ahora queda compartido con
+// la instantánea y lo que se reserve después lleva la generación siguiente
+Instantanea ArbolSistemaArchivos::tomarInstantanea() {
+    if (modoConcurrente || vigilante) return Instantanea();
+    if (imagen) materializarImagen();
+    indiceRutas.limpiar();
+    indiceActivo = false;
+    
+    uint64_t tomada = generacion++;
+    almacen.fijarGeneracion(generacion);
+    instantaneas.insert(tomada);
+    return Instantanea(this, raiz, tomada);
+}
+
+void ArbolSistemaArchivos::liberarInstantanea(uint64_t tomada) {
+    instantaneas.erase(tomada);
+    barrerRetenidos();
+}
+
+// Revertir: comparar el árbol con la instantánea y adoptar su raíz. Lo que solo
+// está en el árbol actual se retiene o libera; lo que solo está en la
+// instantánea vuelve a estar enlazado y deja de figurar como retenido
+bool ArbolSistemaArchivos::revertir(const Instantanea& instantanea) {
+    if (instantanea.arbol != this) return false;
+    
+    unordered_set<const void*> revividos;
+    string ruta;
+    bool exito = revertirNodo(raiz, instantanea.raiz, ruta, revividos);
+    raiz = instantanea.raiz;
+    versionDirectorios++;
+    erase_if(retenidos, [&](const Retenido& r) {
+        return revividos.count(r.nodo != nullptr ? static_cast<const void*>(r.nodo) : r.bloque) > 0;
+    });
+    return exito;
+}
+
+// Llevar 'actual' al estado de 'destino' (mismo nombre y tipo). Solo se
+// desciende por los hijos que difieren: los subárboles compartidos se saltan
+bool ArbolSistemaArchivos::revertirNodo(NodoArbol* actual, NodoArbol* destino, string& ruta,
+                                        unordered_set<const void*>& revividos) {
+    if (actual == destino) return true;
+    
+    bool exito = true;
+    size_t largo = ruta.size();
+    IteradorHijos a = actual->hijos.begin(), finA = actual->hijos.end();
+    IteradorHijos d = destino->hijos.begin(), finD = destino->hijos.end();
+    while (a != finA || d != finD) {
+        int cmp = a == finA ? 1 : d == finD ? -1 : (*a)->nombre.compare((*d)->nombre);
+        NodoArbol* hijoActual = cmp <= 0 ? *a++ : nullptr;
+        NodoArbol* hijoDestino = cmp >= 0 ? *d++ : nullptr;
+        if (hijoActual == hijoDestino) continue;
+        
+        ruta.resize(largo);
+        if (!ruta.empty()) ruta += '/';
+        ruta += (hijoActual != nullptr ? hijoActual : hijoDestino)->nombre;
+        if (hijoActual != nullptr && hijoDestino != nullptr && hijoActual->esArchivo() == hijoDestino->esArchivo()) {
+            exito = revertirNodo(hijoActual, hijoDestino, ruta, revividos) && exito;
+            continue;
+        }
+        
+        // Sobra, falta o cambió de tipo: se elimina y se vuelve a crear
+        if (hijoActual != nullptr) {
+            if (!hijoActual->esArchivo()) desenlazarManejadores(ruta);
+            exito = eliminarEnSistema(ruta) && exito;
+            retenerSubarbol(hijoActual);
+        }
+        if (hijoDestino != nullptr) exito = revivirSubarbol(hijoDestino, ruta, revividos) && exito;
+    }
+    ruta.resize(largo);
+    
+    // Los segmentos que comparten ambas versiones siguen enlazados
+    uint64_t nacido = actual->nacimiento();
+    BloqueHijos* propio = actual->hijos.bloque;
+    BloqueHijos* anterior = destino->hijos.bloque;
+    revividos.insert(destino);
+    if (anterior != nullptr && anterior->clase >= 0) {
+        revividos.insert(anterior);
+        for (size_t s = 0; s < anterior->segmentos; s++) {
+            revividos.insert(anterior->entradas()[s].segmento);
+        }
+    }
+    if (propio != nullptr && propio->clase >= 0 && propio != anterior) {
+        for (size_t s = 0; s < propio->segmentos; s++) {
+            BloqueHijos* segmento = propio->entradas()[s].segmento;
+            if (!revividos.contains(segmento)) retener(nullptr, segmento, segmento->generacion);
+        }
+        retener(nullptr, propio, propio->generacion);
+    }
+    retener(actual, nullptr, nacido);
+    return exito;
+}
+
+// Volver a enlazar un subárbol que solo está en la instantánea y crearlo en el
+// almacenamiento, en preorden
+bool ArbolSistemaArchivos::revivirSubarbol(NodoArbol* nodo, string& ruta, unordered_set<const void*>& revividos) {
+    bool exito = crearEnSistema(ruta, !nodo->esArchivo());
+    revividos.insert(nodo);
+    const BloqueHijos* bloque = nodo->hijos.bloque;
+    if (bloque == nullptr) return exito;
+    if (bloque->clase >= 0) {
+        revividos.insert(bloque);
+        for (size_t s = 0; s < bloque->segmentos; s++) {
+            revividos.insert(bloque->entradas()[s].segmento);
+        }
+    }
+    
+    size_t largo = ruta.size();
+    for (NodoArbol* hijo : nodo->hijos) {
+        ruta.resize(largo);
+        ruta += '/';
+        ruta += hijo->nombre;
+        exito = revivirSubarbol(hijo, ruta, revividos) && exito;
+    }
+    ruta.resize(largo);
+    return exito;
+}
@@ -0,0 +1,69 @@
+#include "pool.h"
+#include <thread>
+
+// Constructor: una cola por hilo
+PoolTrabajo::PoolTrabajo(int numHilos) : pendientes(0) {
+    if (numHilos < 1) numHilos = 1;
+    for (int i = 0; i < numHilos; i++) {
+        colas.push_back(make_unique<Cola>());
+    }
+}
+
+// Agregar una tarea a la cola del hilo
+void PoolTrabajo::agregar(int idHilo, Tarea tarea) {
+    pendientes.fetch_add(1, memory_order_relaxed);
+    Cola& cola = *colas[static_cast<size_t>(idHilo)];
+    lock_guard<mutex> guardia(cola.cerrojo);
+    cola.tareas.push_back(std::move(tarea));
+}
+
+// Tomar de la cola propia (LIFO) o robar de otra (FIFO)
+bool PoolTrabajo::tomarTarea(int idHilo, Tarea& tarea) {
+    size_t numColas = colas.size();
+    size_t propio = static_cast<size_t>(idHilo);
+    {
+        Cola& cola = *colas[propio];
+        lock_guard<mutex> guardia(cola.cerrojo);
+        if (!cola.tareas.empty()) {
+            tarea = std::move(cola.tareas.back());
+            cola.tareas.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < numColas; i++) {
+        Cola& victima = *colas[(propio + i) % numColas];
+        lock_guard<mutex> guardia(victima.cerrojo);
+        if (!victima.tareas.empty()) {
+            tarea = std::move(victima.tareas.front());
+            victima.tareas.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Ciclo de un hilo: termina cuando no quedan tareas en ningún hilo
+void PoolTrabajo::trabajar(int idHilo) {
+    Tarea tarea;
+    while (pendientes.load(memory_order_acquire) > 0) {
+        if (tomarTarea(idHilo, tarea)) {
+            tarea(idHilo);
+            tarea = nullptr;
+            pendientes.fetch_sub(1, memory_order_acq_rel);
+        } else {
+            this_thread::yield();
+        }
+    }
+}
+
+// Lanzar los hilos auxiliares y trabajar también en el hilo llamador
+void PoolTrabajo::ejecutar() {
+    vector<thread> hilos;
+    for (int i = 1; i < obtenerNumHilos(); i++) {
+        hilos.emplace_back(&PoolTrabajo::trabajar, this, i);
+    }
+    trabajar(0);
+    for (thread& hilo : hilos) {
+        hilo.join();
+    }
+}
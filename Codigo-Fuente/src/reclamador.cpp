@@ -0,0 +1,107 @@
+#include "reclamador.h"
+#include "tree.h"
+
+// Constructor
+Reclamador::Reclamador(Eliminador e)
+    : eliminar(std::move(e)), hayListos(false), totalEncoladas(0), totalTerminadas(0), fallidas(0),
+      detener(false) {
+    trabajador = thread(&Reclamador::trabajar, this);
+}
+
+// Destructor
+Reclamador::~Reclamador() {
+    {
+        lock_guard<mutex> guardia(cerrojo);
+        detener = true;
+    }
+    hayTrabajo.notify_one();
+    if (trabajador.joinable()) trabajador.join();
+}
+
+void Reclamador::encolar(NodoArbol* subarbol, string apartado) {
+    {
+        lock_guard<mutex> guardia(cerrojo);
+        pendientes.push_back({subarbol, std::move(apartado)});
+        totalEncoladas++;
+    }
+    hayTrabajo.notify_one();
+}
+
+// Encadenar en el lote todos los nodos y bloques del subárbol con una pila
+// explícita: la profundidad del árbol no importa. Los hijos y los segmentos se
+// leen antes de que el enlace pise el nodo o la cabecera del bloque
+static void desarmar(NodoArbol* subarbol, LoteLibre& lote, vector<NodoArbol*>& pila) {
+    pila.push_back(subarbol);
+    while (!pila.empty()) {
+        NodoArbol* actual = pila.back();
+        pila.pop_back();
+        for (NodoArbol* hijo : actual->hijos) {
+            pila.push_back(hijo);
+        }
+        BloqueHijos* bloque = actual->hijos.bloque;
+        if (bloque != nullptr) {
+            for (size_t s = 0; s < bloque->segmentos; s++) {
+                lote.agregarBloque(bloque->entradas()[s].segmento);
+            }
+            lote.agregarBloque(bloque);
+        }
+        lote.agregarNodo(actual);
+    }
+}
+
+// Hilo de reclamación: toma todo lo encolado, lo desarma y borra fuera del
+// cerrojo, y publica el lote resultante
+void Reclamador::trabajar() {
+    vector<Tarea> lote;
+    vector<NodoArbol*> pila;
+    while (true) {
+        {
+            unique_lock<mutex> guardia(cerrojo);
+            hayTrabajo.wait(guardia, [this] { return detener || !pendientes.empty(); });
+            if (pendientes.empty()) return; // detener y nada pendiente
+            lote.swap(pendientes);
+        }
+        
+        LoteLibre libres;
+        size_t fallasLote = 0;
+        for (const Tarea& tarea : lote) {
+            if (tarea.subarbol != nullptr) desarmar(tarea.subarbol, libres, pila);
+            if (!tarea.apartado.empty() && !eliminar(tarea.apartado)) fallasLote++;
+        }
+        
+        {
+            lock_guard<mutex> guardia(cerrojo);
+            listos.unir(libres);
+            hayListos.store(listos.obtenerNodos() > 0, memory_order_release);
+            totalTerminadas += lote.size();
+            fallidas += fallasLote;
+        }
+        terminadas.notify_all();
+        lote.clear();
+    }
+}
+
+void Reclamador::recoger(AlmacenNodos& almacen) {
+    if (!hayListos.load(memory_order_acquire)) return;
+    LoteLibre recogido;
+    {
+        lock_guard<mutex> guardia(cerrojo);
+        recogido.unir(listos);
+        hayListos.store(false, memory_order_relaxed);
+    }
+    almacen.devolver(recogido);
+}
+
+bool Reclamador::drenar() {
+    unique_lock<mutex> guardia(cerrojo);
+    uint64_t objetivo = totalEncoladas;
+    terminadas.wait(guardia, [&] { return totalTerminadas >= objetivo; });
+    bool exito = fallidas == 0;
+    fallidas = 0;
+    return exito;
+}
+
+size_t Reclamador::obtenerPendientes() {
+    lock_guard<mutex> guardia(cerrojo);
+    return static_cast<size_t>(totalEncoladas - totalTerminadas);
+}
@@ -0,0 +1,209 @@
+#include "tree.h"
+
+// Parte literal inicial de un componente del patrón (hasta el primer comodín)
+static string_view parteLiteral(string_view patron) {
+    size_t fin = patron.find_first_of("*?[\\");
+    return fin == string_view::npos ? patron : patron.substr(0, fin);
+}
+
+// Menor cadena mayor que todas las que empiezan con 'prefijo'; vacía si no hay
+static string sucesorPrefijo(string_view prefijo) {
+    string sucesor(prefijo);
+    while (!sucesor.empty() && static_cast<unsigned char>(sucesor.back()) == 0xFF) {
+        sucesor.pop_back();
+    }
+    if (!sucesor.empty()) sucesor.back() = static_cast<char>(static_cast<unsigned char>(sucesor.back()) + 1);
+    return sucesor;
+}
+
+// Comparar un carácter con una clase "[...]" que empieza en patron[i];
+// deja 'i' después del ']' (o retorna false si la clase no cierra)
+static bool coincideClase(string_view patron, size_t& i, unsigned char c, bool& cerrada) {
+    size_t j = i + 1;
+    bool negada = j < patron.size() && (patron[j] == '!' || patron[j] == '^');
+    if (negada) j++;
+    
+    bool coincide = false;
+    bool primero = true;
+    while (j < patron.size() && (patron[j] != ']' || primero)) {
+        primero = false;
+        unsigned char desde = static_cast<unsigned char>(patron[j]);
+        if (desde == '\\' && j + 1 < patron.size()) desde = static_cast<unsigned char>(patron[++j]);
+        unsigned char hasta = desde;
+        if (j + 2 < patron.size() && patron[j + 1] == '-' && patron[j + 2] != ']') {
+            hasta = static_cast<unsigned char>(patron[j + 2]);
+            j += 2;
+        }
+        if (desde <= c && c <= hasta) coincide = true;
+        j++;
+    }
+    
+    cerrada = j < patron.size();
+    if (!cerrada) return false;
+    i = j + 1;
+    return coincide != negada;
+}
+
+// Comparación glob con retroceso al último '*': tiempo O(|patrón| * |nombre|)
+bool coincidePatron(string_view patron, string_view nombre) {
+    size_t p = 0, n = 0;
+    size_t estrella = string_view::npos, reanudar = 0;
+    
+    while (n < nombre.size()) {
+        if (p < patron.size()) {
+            char c = patron[p];
+            if (c == '*') {
+                estrella = p++;
+                reanudar = n;
+                continue;
+            }
+            if (c == '?') {
+                p++;
+                n++;
+                continue;
+            }
+            if (c == '[') {
+                size_t siguiente = p;
+                bool cerrada;
+                if (coincideClase(patron, siguiente, static_cast<unsigned char>(nombre[n]), cerrada)) {
+                    p = siguiente;
+                    n++;
+                    continue;
+                }
+                // Un '[' sin cerrar se toma como carácter literal
+                if (!cerrada && nombre[n] == '[') {
+                    p++;
+                    n++;
+                    continue;
+                }
+            } else {
+                if (c == '\\' && p + 1 < patron.size()) c = patron[++p];
+                if (c == nombre[n]) {
+                    p++;
+                    n++;
+                    continue;
+                }
+            }
+        }
+        
+        // Falló: que el último '*' absorba un carácter más
+        if (estrella == string_view::npos) return false;
+        p = estrella + 1;
+        n = ++reanudar;
+    }
+    
+    while (p < patron.size() && patron[p] == '*') p++;
+    return p == patron.size();
+}
+
+// Apilar los hijos de un directorio; con patrón, solo el rango de su parte literal
+void Recorrido::apilar(const BloqueHijos* bloque) {
+    size_t nivel = pila.size();
+    if (!componentes.empty()) {
+        string_view literal = parteLiteral(componentes[nivel]);
+        if (!literal.empty()) {
+            string sucesor = sucesorPrefijo(literal);
+            pila.push_back({cotaInferiorHijos(bloque, literal),
+                            sucesor.empty() ? finHijos(bloque) : cotaInferiorHijos(bloque, sucesor),
+                            ruta.size()});
+            return;
+        }
+    }
+    pila.push_back({inicioHijos(bloque), finHijos(bloque), ruta.size()});
+}
+
+// Avanzar hasta el siguiente resultado. Retorna false al terminar
+bool Recorrido::avanzar() {
+    while (!pila.empty()) {
+        Marco& marco = pila.back();
+        if (marco.actual == marco.fin) {
+            pila.pop_back();
+            continue;
+        }
+        
+        NodoArbol* nodo = *marco.actual;
+        ++marco.actual;
+        size_t nivel = pila.size() - 1;
+        if (!componentes.empty() && !coincidePatron(componentes[nivel], nodo->nombre)) continue;
+        
+        ruta.resize(marco.longitudRuta);
+        if (!ruta.empty()) ruta += '/';
+        ruta += nodo->nombre;
+        
+        bool ultimo = !componentes.empty() && nivel + 1 == componentes.size();
+        const BloqueHijos* hijos = nodo->hijos.leer();
+        if (!ultimo && hijos != nullptr && hijos->tam > 0) apilar(hijos);
+        
+        if (componentes.empty() || ultimo) {
+            actual = nodo;
+            return true;
+        }
+    }
+    
+    actual = nullptr;
+    return false;
+}
+
+// Listado perezoso de un directorio
+RangoHijos ArbolSistemaArchivos::listarDirectorio(string_view ruta) {
+    return listarConPrefijo(ruta, string_view());
+}
+
+RangoHijos ArbolSistemaArchivos::listarConPrefijo(string_view ruta, string_view prefijo) {
+    if (imagen) materializarImagen();
+    unique_ptr<GuardiaLectura> guardia;
+    if (modoConcurrente) guardia = make_unique<GuardiaLectura>();
+    
+    NodoArbol* nodo = buscarNodo(ruta);
+    if (nodo == nullptr) return {};
+    const BloqueHijos* bloque = nodo->hijos.leer();
+    if (prefijo.empty()) return {inicioHijos(bloque), finHijos(bloque), std::move(guardia)};
+    
+    // El rango termina en el primer nombre que ya no tiene el prefijo
+    string sucesor = sucesorPrefijo(prefijo);
+    return {cotaInferiorHijos(bloque, prefijo),
+            sucesor.empty() ? finHijos(bloque) : cotaInferiorHijos(bloque, sucesor),
+            std::move(guardia)};
+}
+
+// Recorrido perezoso de un subárbol: la ruta del buffer empieza con la de la raíz
+Recorrido ArbolSistemaArchivos::recorrerSubarbol(string_view ruta) {
+    if (imagen) materializarImagen();
+    Recorrido recorrido;
+    if (modoConcurrente) recorrido.guardia = make_unique<GuardiaLectura>();
+    
+    iniciarRecorrido(recorrido, buscarNodo(ruta), ruta);
+    return recorrido;
+}
+
+// Apilar los hijos del nodo encontrado para 'ruta' (nullptr si no existe) y
+// avanzar al primer resultado; también lo usan las instantáneas
+void ArbolSistemaArchivos::iniciarRecorrido(Recorrido& recorrido, const NodoArbol* nodo, string_view ruta) {
+    const BloqueHijos* bloque = nodo == nullptr ? nullptr : nodo->hijos.leer();
+    if (bloque != nullptr && bloque->tam > 0) {
+        string_view componente;
+        while (siguienteComponente(ruta, componente)) {
+            if (!recorrido.ruta.empty()) recorrido.ruta += '/';
+            recorrido.ruta += componente;
+        }
+        recorrido.apilar(bloque);
+    }
+    recorrido.avanzar();
+}
+
+// Búsqueda por patrón glob, componente a componente desde la raíz
+Recorrido ArbolSistemaArchivos::buscarPatron(string_view patron) {
+    if (imagen) materializarImagen();
+    Recorrido recorrido;
+    if (modoConcurrente) recorrido.guardia = make_unique<GuardiaLectura>();
+    
+    string_view componente;
+    while (siguienteComponente(patron, componente)) {
+        recorrido.componentes.emplace_back(componente);
+    }
+    
+    const BloqueHijos* bloque = raiz->hijos.leer();
+    if (!recorrido.componentes.empty() && bloque != nullptr && bloque->tam > 0) recorrido.apilar(bloque);
+    recorrido.avanzar();
+    return recorrido;
+}
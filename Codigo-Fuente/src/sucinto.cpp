@@ -0,0 +1,235 @@
+#include "sucinto.h"
+#include "tree.h"
+#include <bit>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+void VectorBits::agregar(bool bit) {
+    if (tam % 64 == 0) palabras.push_back(0);
+    if (bit) palabras.back() |= uint64_t(1) << (tam % 64);
+    tam++;
+}
+
+// Los bits de relleno de la última palabra se ponen en 1 para que el select
+// de ceros no los cuente
+void VectorBits::terminar() {
+    if (tam % 64 != 0) palabras.back() |= ~uint64_t(0) << (tam % 64);
+    palabras.shrink_to_fit();
+    
+    size_t superbloques = (palabras.size() + PALABRAS_SUPERBLOQUE - 1) / PALABRAS_SUPERBLOQUE;
+    cerosAntes.assign(superbloques + 1, 0);
+    muestras.clear();
+    uint64_t ceros = 0;
+    for (size_t s = 0; s < superbloques; s++) {
+        cerosAntes[s] = ceros;
+        size_t fin = min(palabras.size(), (s + 1) * PALABRAS_SUPERBLOQUE);
+        for (size_t w = s * PALABRAS_SUPERBLOQUE; w < fin; w++) {
+            ceros += static_cast<uint64_t>(popcount(~palabras[w]));
+        }
+        while (muestras.size() * MUESTRA_CEROS < ceros) muestras.push_back(static_cast<uint32_t>(s));
+    }
+    cerosAntes[superbloques] = ceros;
+    muestras.shrink_to_fit();
+}
+
+// Posición del k-ésimo bit en 1 de una palabra
+static unsigned seleccionarEnPalabra(uint64_t palabra, unsigned k) {
+#ifdef __BMI2__
+    return static_cast<unsigned>(countr_zero(_pdep_u64(uint64_t(1) << k, palabra)));
+#else
+    for (; k > 0; k--) palabra &= palabra - 1;
+    return static_cast<unsigned>(countr_zero(palabra));
+#endif
+}
+
+// La muestra acota el superbloque; la búsqueda binaria da el último cuyo
+// conteo no supera k, y el resto se cuenta palabra por palabra
+size_t VectorBits::seleccionarCero(size_t k) const {
+    size_t j = k / MUESTRA_CEROS;
+    size_t izq = muestras[j];
+    size_t der = j + 1 < muestras.size() ? size_t(muestras[j + 1]) + 1 : cerosAntes.size() - 1;
+    while (der - izq > 1) {
+        size_t medio = izq + (der - izq) / 2;
+        if (cerosAntes[medio] <= k) {
+            izq = medio;
+        } else {
+            der = medio;
+        }
+    }
+    
+    uint64_t resto = k - cerosAntes[izq];
+    for (size_t w = izq * PALABRAS_SUPERBLOQUE; ; w++) {
+        uint64_t ceros = ~palabras[w];
+        uint64_t cuenta = static_cast<uint64_t>(popcount(ceros));
+        if (resto < cuenta) return w * 64 + seleccionarEnPalabra(ceros, static_cast<unsigned>(resto));
+        resto -= cuenta;
+    }
+}
+
+size_t VectorBits::siguienteCero(size_t desde, size_t k) const {
+    uint64_t ceros = ~palabras[desde / 64] >> (desde % 64);
+    return ceros != 0 ? desde + static_cast<size_t>(countr_zero(ceros)) : seleccionarCero(k);
+}
+
+size_t VectorBits::obtenerBytes() const {
+    return palabras.capacity() * sizeof(uint64_t) + cerosAntes.capacity() * sizeof(uint64_t)
+         + muestras.capacity() * sizeof(uint32_t);
+}
+
+// Enteros sin signo de 7 bits por byte (LEB128): los largos de nombre casi
+// siempre caben en uno
+static void escribirVarint(vector<char>& destino, size_t valor) {
+    while (valor >= 0x80) {
+        destino.push_back(static_cast<char>((valor & 0x7f) | 0x80));
+        valor >>= 7;
+    }
+    destino.push_back(static_cast<char>(valor));
+}
+
+static size_t leerVarint(const char*& p) {
+    size_t valor = 0;
+    for (int desplazamiento = 0; ; desplazamiento += 7) {
+        unsigned char byte = static_cast<unsigned char>(*p++);
+        valor |= size_t(byte & 0x7f) << desplazamiento;
+        if (byte < 0x80) return valor;
+    }
+}
+
+void ArbolSucinto::agregar(string_view nombre, size_t numHijos, bool directorio, bool primeroDeHermanos) {
+    size_t v = numNodos++;
+    for (size_t i = 0; i < numHijos; i++) {
+        topologia.agregar(true);
+    }
+    topologia.agregar(false);
+    if (v % 64 == 0) esDirectorio.push_back(0);
+    if (directorio) esDirectorio.back() |= uint64_t(1) << (v % 64);
+    
+    // Prefijo común con el hermano anterior del mismo bloque
+    size_t prefijo = 0;
+    if (v % TAM_BLOQUE_SUCINTO == 0) {
+        bloques.push_back(nombres.size());
+    } else if (!primeroDeHermanos) {
+        size_t tope = min(anterior.size(), nombre.size());
+        while (prefijo < tope && anterior[prefijo] == nombre[prefijo]) prefijo++;
+    }
+    escribirVarint(nombres, prefijo);
+    escribirVarint(nombres, nombre.size() - prefijo);
+    nombres.insert(nombres.end(), nombre.begin() + static_cast<ptrdiff_t>(prefijo), nombre.end());
+    anterior.assign(nombre);
+}
+
+void ArbolSucinto::terminar() {
+    topologia.terminar();
+    esDirectorio.shrink_to_fit();
+    nombres.shrink_to_fit();
+    bloques.shrink_to_fit();
+    string().swap(anterior);
+}
+
+string_view ArbolSucinto::cabeza(size_t bloque) const {
+    const char* p = nombres.data() + bloques[bloque];
+    leerVarint(p); // Prefijo 0
+    size_t largo = leerVarint(p);
+    return string_view(p, largo);
+}
+
+// Los hijos de v ocupan los ids [primero, ultimo). Una búsqueda binaria sobre
+// las cabezas de los bloques que empiezan dentro del rango elige el bloque, y
+// ese bloque se recorre comparando sin reconstruir los nombres: basta saber
+// cuántos bytes del buscado coinciden con el nombre anterior, que es menor
+int64_t ArbolSucinto::buscarHijo(size_t v, string_view nombre) const {
+    size_t inicio = v == 0 ? 0 : topologia.seleccionarCero(v - 1) + 1;
+    size_t fin = topologia.siguienteCero(inicio, v);
+    if (inicio == fin) return -1;
+    size_t primero = inicio - v + 1;
+    size_t ultimo = primero + (fin - inicio);
+    
+    size_t izq = primero / TAM_BLOQUE_SUCINTO + 1, der = (ultimo - 1) / TAM_BLOQUE_SUCINTO + 1;
+    while (izq < der) {
+        size_t medio = izq + (der - izq) / 2;
+        if (cabeza(medio) <= nombre) {
+            izq = medio + 1;
+        } else {
+            der = medio;
+        }
+    }
+    size_t bloque = izq - 1;
+    
+    // Saltar los nodos del bloque que son de otro directorio
+    size_t id = bloque * TAM_BLOQUE_SUCINTO;
+    const char* p = nombres.data() + bloques[bloque];
+    for (; id < primero; id++) {
+        leerVarint(p);
+        size_t largo = leerVarint(p);
+        p += largo;
+    }
+    
+    // El primero que se compara va completo (prefijo 0)
+    size_t hasta = min(ultimo, (bloque + 1) * TAM_BLOQUE_SUCINTO);
+    size_t coincide = 0;
+    for (; id < hasta; id++) {
+        size_t prefijo = leerVarint(p);
+        size_t largo = leerVarint(p);
+        const char* resto = p;
+        p += largo;
+        if (prefijo > coincide) continue; // Difiere del buscado donde el anterior: sigue siendo menor
+        if (prefijo < coincide) return -1; // Ya es mayor que el buscado
+        
+        size_t tope = min(largo, nombre.size() - coincide);
+        size_t m = 0;
+        while (m < tope && resto[m] == nombre[coincide + m]) m++;
+        if (m == largo && coincide + m == nombre.size()) return static_cast<int64_t>(id);
+        if (m < largo && (coincide + m == nombre.size() ||
+                          static_cast<unsigned char>(resto[m]) > static_cast<unsigned char>(nombre[coincide + m]))) {
+            return -1;
+        }
+        coincide += m;
+    }
+    return -1;
+}
+
+int ArbolSucinto::buscar(string_view ruta) const {
+    if (numNodos == 0) return 1;
+    size_t actual = 0;
+    string_view componente;
+    while (siguienteComponente(ruta, componente)) {
+        int64_t hijo = buscarHijo(actual, componente);
+        if (hijo == -1) return 1;
+        actual = static_cast<size_t>(hijo);
+    }
+    return directorio(actual) ? 2 : 0;
+}
+
+size_t ArbolSucinto::obtenerBytes() const {
+    return topologia.obtenerBytes() + esDirectorio.capacity() * sizeof(uint64_t) + nombres.capacity()
+         + bloques.capacity() * sizeof(uint64_t);
+}
+
+// Recorrer por niveles: los hijos de cada directorio se agregan seguidos y en
+// orden, que es exactamente la numeración BFS. Solo se guardan los directorios
+// con hijos del nivel siguiente
+ArbolSucinto ArbolSistemaArchivos::congelar() {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    ArbolSucinto congelado;
+    congelado.agregar(string_view(), raiz->hijos.size(), true, true);
+    vector<NodoArbol*> nivel, siguiente;
+    if (!raiz->hijos.empty()) nivel.push_back(raiz);
+    while (!nivel.empty()) {
+        siguiente.clear();
+        for (NodoArbol* padre : nivel) {
+            bool primero = true;
+            for (NodoArbol* hijo : padre->hijos) {
+                congelado.agregar(hijo->nombre, hijo->hijos.size(), !hijo->esArchivo(), primero);
+                primero = false;
+                if (!hijo->hijos.empty()) siguiente.push_back(hijo);
+            }
+        }
+        nivel.swap(siguiente);
+    }
+    congelado.terminar();
+    return congelado;
+}
@@ -1,313 +1,2870 @@
 #include "tree.h"
+#include "contadores.h"
+#include "diario.h"
+#include "directorio.h"
+#include "epocas.h"
+#include "imagen.h"
+#include "pool.h"
+#include "reclamador.h"
+#include "vigilante.h"
+#include <bit>
 #include <filesystem>  
-#include <fstream>     
-#include <sstream>     
 #include <exception> 
 #include <algorithm>
 #include <iostream> 
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-// Destructor del nodo
-NodoArbol::~NodoArbol() {
-    for (NodoArbol* hijo : hijos) {
-        delete hijo;
+// Constructor de la clase ArbolSistemaArchivos
+ArbolSistemaArchivos::ArbolSistemaArchivos(unique_ptr<Almacenamiento> almacenamientoInicial)
+    : almacenamiento(std::move(almacenamientoInicial)), indiceActivo(false), modoConcurrente(false),
+      generacion(0), apartados(0), versionDirectorios(0), descriptoresManejadores(0), capturarTamanos(false), presupuestoMemoria(0),
+      inicioCargaProceso(0), inicioCargaArbol(0), cargaExcedida(false), picoCarga(0), compactarTrasCarga(false) {
+    if (!almacenamiento) almacenamiento = make_unique<AlmacenamientoSistema>();
+    raiz = almacen.crearNodo("raiz");
+    raiz->marcarDirectorio();
+}
+
+// Destructor: el almacén libera todos los nodos en bloque
+ArbolSistemaArchivos::~ArbolSistemaArchivos() {
+    diario.reset(); // Aplica lo pendiente antes de terminar
+    vigilante.reset();
+    reclamador.reset(); // Termina de desarmar antes de liberar el almacén
+    retirados.clear();
+    retenidos.clear();
+    imagen.reset();
+    almacen.liberarTodo();
+}
+
+// Prefijo de 8 bytes del nombre, empaquetado big-endian: comparar prefijos
+// como enteros equivale a comparar los nombres por sus primeros 8 bytes
+static inline uint64_t prefijoNombre(string_view nombre) {
+    uint64_t prefijo = 0;
+    if (!nombre.empty()) memcpy(&prefijo, nombre.data(), min(nombre.size(), sizeof(prefijo)));
+    if constexpr (endian::native == endian::little) prefijo = byteswap(prefijo);
+    return prefijo;
+}
+
+// Primera posición cuyo prefijo no es menor que 'clave'. La búsqueda binaria
+// recorre solo el arreglo contiguo de prefijos y los últimos 16 se cuentan con AVX2
+static size_t cotaPrefijos(const uint64_t* prefijos, size_t n, uint64_t clave) {
+    size_t base = 0;
+    while (n > 16) {
+        size_t mitad = n / 2;
+        if (prefijos[base + mitad] < clave) {
+            base += mitad + 1;
+            n -= mitad + 1;
+        } else {
+            n = mitad;
+        }
+    }
+    
+    size_t menores = 0, i = 0;
+#ifdef __AVX2__
+    // AVX2 solo compara con signo: se invierte el bit de signo de ambos lados
+    const __m256i signo = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i claveSigno = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(clave)), signo);
+    for (; i + 4 <= n; i += 4) {
+        __m256i valores = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prefijos + base + i));
+        __m256i menor = _mm256_cmpgt_epi64(claveSigno, _mm256_xor_si256(valores, signo));
+        menores += static_cast<size_t>(popcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(menor)))));
     }
+#endif
+    for (; i < n; i++) {
+        menores += prefijos[base + i] < clave ? 1 : 0;
+    }
+    return base + menores;
 }
 
-// Constructor de la clase ArbolSistemaArchivos
-ArbolSistemaArchivos::ArbolSistemaArchivos() {
-    raiz = new NodoArbol("raiz");
+// Mover hijos [desde, hasta) con sus prefijos; los rangos pueden solaparse
+static void moverHijos(const BloqueHijos* origen, size_t desde, size_t hasta, BloqueHijos* destino, size_t en) {
+    if (hasta == desde) return;
+    memmove(destino->datos() + en, origen->datos() + desde, (hasta - desde) * sizeof(NodoArbol*));
+    memmove(destino->prefijos() + en, origen->prefijos() + desde, (hasta - desde) * sizeof(uint64_t));
 }
 
-// Destructor
-ArbolSistemaArchivos::~ArbolSistemaArchivos() {
-    delete raiz;
+static void ponerHijo(BloqueHijos* bloque, size_t pos, NodoArbol* nodo) {
+    bloque->datos()[pos] = nodo;
+    bloque->prefijos()[pos] = prefijoNombre(nodo->nombre);
+}
+
+// Lo mismo para las entradas del índice de un bloque segmentado
+static void moverEntradas(const BloqueHijos* origen, size_t desde, size_t hasta, BloqueHijos* destino, size_t en) {
+    if (hasta == desde) return;
+    memmove(destino->entradas() + en, origen->entradas() + desde, (hasta - desde) * sizeof(EntradaSegmento));
+    memmove(destino->prefijos() + en, origen->prefijos() + desde, (hasta - desde) * sizeof(uint64_t));
+}
+
+static void ponerEntrada(BloqueHijos* directorio, size_t s, BloqueHijos* segmento, size_t inicio) {
+    directorio->entradas()[s] = {segmento, inicio};
+    directorio->prefijos()[s] = segmento->prefijos()[0];
+}
+
+// Posición del nombre en un bloque plano, o -1. Solo se lee el nodo para
+// confirmar los empates de prefijo
+static int buscarEnPlano(const BloqueHijos* bloque, string_view nombre) {
+    uint64_t clave = prefijoNombre(nombre);
+    const uint64_t* prefijos = bloque->prefijos();
+    for (size_t i = cotaPrefijos(prefijos, bloque->tam, clave); i < bloque->tam && prefijos[i] == clave; i++) {
+        CONTAR(comparaciones);
+        int cmp = bloque->datos()[i]->nombre.compare(nombre);
+        if (cmp == 0) return static_cast<int>(i);
+        if (cmp > 0) break;
+    }
+    return -1;
+}
+
+// Posición donde va 'nombre' dentro de un bloque plano
+static size_t posicionEnPlano(const BloqueHijos* bloque, string_view nombre) {
+    uint64_t clave = prefijoNombre(nombre);
+    const uint64_t* prefijos = bloque->prefijos();
+    size_t i = cotaPrefijos(prefijos, bloque->tam, clave);
+    while (i < bloque->tam && prefijos[i] == clave) {
+        CONTAR(comparaciones);
+        if (bloque->datos()[i]->nombre >= nombre) break;
+        i++;
+    }
+    return i;
+}
+
+// Segmento donde está (o iría) 'nombre': el último cuyo primer hijo no es mayor
+static size_t segmentoPorNombre(const BloqueHijos* directorio, string_view nombre) {
+    uint64_t clave = prefijoNombre(nombre);
+    const uint64_t* prefijos = directorio->prefijos();
+    size_t n = directorio->segmentos;
+    size_t s = cotaPrefijos(prefijos, n, clave);
+    while (s < n && prefijos[s] == clave) {
+        CONTAR(comparaciones);
+        if (directorio->entradas()[s].segmento->datos()[0]->nombre > nombre) break;
+        s++;
+    }
+    return s == 0 ? 0 : s - 1;
+}
+
+// Segmento que contiene la posición 'indice'
+static size_t segmentoPorPosicion(const BloqueHijos* directorio, size_t indice) {
+    const EntradaSegmento* entradas = directorio->entradas();
+    return static_cast<size_t>(upper_bound(entradas, entradas + directorio->segmentos, indice,
+        [](size_t valor, const EntradaSegmento& entrada) { return valor < entrada.inicio; }) - entradas) - 1;
+}
+
+// Iterador al primer hijo no menor que 'nombre'. Un hueco al final de un
+// segmento se expresa como el inicio del siguiente, igual que al avanzar
+IteradorHijos cotaInferiorHijos(const BloqueHijos* bloque, string_view nombre) {
+    if (bloque == nullptr || bloque->tam == 0) return finHijos(bloque);
+    if (!bloque->esSegmentado()) {
+        return {bloque->datos() + posicionEnPlano(bloque, nombre), bloque->datos() + bloque->tam, nullptr, nullptr};
+    }
+    
+    const EntradaSegmento* e = bloque->entradas();
+    size_t n = bloque->segmentos;
+    size_t s = segmentoPorNombre(bloque, nombre);
+    size_t pos = posicionEnPlano(e[s].segmento, nombre);
+    if (pos == e[s].segmento->tam && s + 1 < n) {
+        s++;
+        pos = 0;
+    }
+    const BloqueHijos* segmento = e[s].segmento;
+    return {segmento->datos() + pos, segmento->datos() + segmento->tam, e + s + 1, e + n};
+}
+
+// Abrir un hueco en 'pos' de un bloque plano con espacio y poner el nodo
+static void insertarEnPlano(BloqueHijos* bloque, size_t pos, NodoArbol* nodo) {
+    moverHijos(bloque, pos, bloque->tam, bloque, pos + 1);
+    ponerHijo(bloque, pos, nodo);
+    bloque->tam++;
+}
+
+// Mezclar desde el final los 'tam' hijos de 'origen' con 'nuevos' (ordenados)
+// en 'destino', que puede ser el mismo bloque si tiene capacidad
+static void mezclarEnBloque(const BloqueHijos* origen, size_t tam, const vector<NodoArbol*>& nuevos, BloqueHijos* destino) {
+    size_t i = tam, j = nuevos.size(), k = tam + nuevos.size();
+    destino->tam = static_cast<uint32_t>(k);
+    uint64_t prefijoNuevo = j > 0 ? prefijoNombre(nuevos[j - 1]->nombre) : 0;
+    while (j > 0) {
+        k--;
+        uint64_t prefijoViejo = i > 0 ? origen->prefijos()[i - 1] : 0;
+        if (i > 0 && (prefijoViejo > prefijoNuevo
+                      || (prefijoViejo == prefijoNuevo && origen->datos()[i - 1]->nombre > nuevos[j - 1]->nombre))) {
+            i--;
+            destino->datos()[k] = origen->datos()[i];
+            destino->prefijos()[k] = prefijoViejo;
+        } else {
+            j--;
+            destino->datos()[k] = nuevos[j];
+            destino->prefijos()[k] = prefijoNuevo;
+            if (j > 0) prefijoNuevo = prefijoNombre(nuevos[j - 1]->nombre);
+        }
+    }
+    if (origen != destino) moverHijos(origen, 0, i, destino, 0);
+}
+
+// Índice de segmentos con lugar para 'cantidad' entradas (dos punteros cada una)
+static BloqueHijos* reservarDirectorio(AlmacenNodos& destino, size_t cantidad) {
+    return destino.reservarHijos(static_cast<int>(bit_width(2 * cantidad - 1)));
+}
+
+static size_t capacidadEntradas(const BloqueHijos* directorio) {
+    return directorio->capacidadBloque() / 2;
+}
+
+// Búsqueda binaria en el bloque de hijos (en el segmento que corresponde si es segmentado)
+int ArbolSistemaArchivos::busquedaBinaria(const BloqueHijos* bloque, string_view nombre) {
+    if (bloque == nullptr || bloque->tam == 0) return -1;
+    
+    int base = 0;
+    if (bloque->esSegmentado()) {
+        const EntradaSegmento& entrada = bloque->entradas()[segmentoPorNombre(bloque, nombre)];
+        base = static_cast<int>(entrada.inicio);
+        bloque = entrada.segmento;
+    }
+    
+    int pos = buscarEnPlano(bloque, nombre);
+    return pos == -1 ? -1 : base + pos; // -1: no encontrado
 }
 
-// Dividir ruta en componentes
-vector<string> ArbolSistemaArchivos::dividirRuta(const string& ruta) {
-    vector<string> componentes;
-    stringstream ss(ruta);
-    string componente;
+// Insertar nodo manteniendo orden lexicográfico
+void ArbolSistemaArchivos::insertarOrdenado(ListaHijos& hijos, NodoArbol* nodo) {
+    if (hijos.esSegmentado()) {
+        insertarSegmentado(hijos, nodo);
+        return;
+    }
+    
+    size_t tam = hijos.size();
+    BloqueHijos* actual = hijos.bloque;
+    
+    // Un bloque plano lleno en el tamaño máximo pasa a segmentado: se envuelve
+    // como único segmento de un índice aún no publicado y la inserción lo divide
+    if (tam >= (1u << CLASE_MAXIMA_PLANA) && tam == hijos.capacidad()) {
+        ListaHijos envuelta;
+        envuelta.bloque = reservarDirectorio(almacen, 1);
+        ponerEntrada(envuelta.bloque, 0, actual, 0);
+        envuelta.bloque->tam = static_cast<uint32_t>(tam);
+        envuelta.bloque->segmentos = 1;
+        insertarSegmentado(envuelta, nodo);
+        hijos.publicar(envuelta.bloque);
+        return;
+    }
     
-    while (getline(ss, componente, '/')) {
-        if (!componente.empty()) {
-            componentes.push_back(componente);
+    size_t pos = actual == nullptr ? 0 : posicionEnPlano(actual, nodo->nombre);
+    
+    // En modo concurrente el bloque publicado no se toca: se arma uno nuevo.
+    // Si no, solo hace falta uno nuevo (del doble) cuando el actual está lleno
+    if (modoConcurrente || tam == hijos.capacidad()) {
+        int clase = actual == nullptr ? 0 : actual->clase + (tam == hijos.capacidad() ? 1 : 0);
+        BloqueHijos* nuevo = almacen.reservarHijos(clase);
+        if (actual != nullptr) {
+            moverHijos(actual, 0, pos, nuevo, 0);
+            moverHijos(actual, pos, tam, nuevo, pos + 1);
         }
+        ponerHijo(nuevo, pos, nodo);
+        nuevo->tam = static_cast<uint32_t>(tam + 1);
+        hijos.publicar(nuevo);
+        if (actual != nullptr) retirarBloque(actual);
+        return;
     }
     
-    return componentes;
+    insertarEnPlano(actual, pos, nodo);
 }
 
-// Búsqueda binaria en el vector de hijos
-int ArbolSistemaArchivos::busquedaBinaria(const vector<NodoArbol*>& hijos, const string& nombre) {
-    int izq = 0, der = static_cast<int>(hijos.size()) - 1;
+// Insertar en un bloque segmentado: solo se tocan un segmento (que se divide
+// en dos si está lleno) y el índice, en su lugar o en copias si hay lectores
+void ArbolSistemaArchivos::insertarSegmentado(ListaHijos& hijos, NodoArbol* nodo) {
+    BloqueHijos* directorio = hijos.bloque;
+    size_t n = directorio->segmentos;
+    size_t s = segmentoPorNombre(directorio, nodo->nombre);
+    EntradaSegmento* entradas = directorio->entradas();
+    EntradaSegmento anterior = entradas[s];
+    BloqueHijos* segmento = anterior.segmento;
+    size_t tamSegmento = segmento->tam;
+    size_t pos = posicionEnPlano(segmento, nodo->nombre);
+    bool lleno = tamSegmento == (1u << segmento->clase);
+    bool dividir = lleno && n < MAX_SEGMENTOS;
     
-    while (izq <= der) {
-        int medio = izq + (der - izq) / 2;
-        
-        if (hijos[medio]->nombre == nombre) {
-            return medio;
-        } else if (hijos[medio]->nombre < nombre) {
-            izq = medio + 1;
+    BloqueHijos* izquierdo;
+    BloqueHijos* derecho = nullptr;
+    if (dividir) {
+        size_t mitad = tamSegmento / 2;
+        izquierdo = modoConcurrente || compartido(segmento) ? almacen.reservarHijos(segmento->clase) : segmento;
+        derecho = almacen.reservarHijos(segmento->clase);
+        moverHijos(segmento, mitad, tamSegmento, derecho, 0);
+        if (izquierdo != segmento) moverHijos(segmento, 0, mitad, izquierdo, 0);
+        izquierdo->tam = static_cast<uint32_t>(mitad);
+        derecho->tam = static_cast<uint32_t>(tamSegmento - mitad);
+        if (pos <= mitad) {
+            insertarEnPlano(izquierdo, pos, nodo);
         } else {
-            der = medio - 1;
+            insertarEnPlano(derecho, pos - mitad, nodo);
+        }
+    } else {
+        izquierdo = modoConcurrente || lleno || compartido(segmento) ? almacen.reservarHijos(segmento->clase + (lleno ? 1 : 0)) : segmento;
+        if (izquierdo != segmento) {
+            moverHijos(segmento, 0, tamSegmento, izquierdo, 0);
+            izquierdo->tam = static_cast<uint32_t>(tamSegmento);
         }
+        insertarEnPlano(izquierdo, pos, nodo);
+    }
+    
+    size_t extra = dividir ? 1 : 0;
+    size_t total = n + extra;
+    BloqueHijos* destino = directorio;
+    if (modoConcurrente || total > capacidadEntradas(directorio)) {
+        destino = reservarDirectorio(almacen, total);
+        moverEntradas(directorio, 0, s, destino, 0);
+        moverEntradas(directorio, s + 1, n, destino, s + 1 + extra);
+    } else if (dividir) {
+        moverEntradas(directorio, s + 1, n, directorio, s + 2);
+    }
+    
+    EntradaSegmento* nuevas = destino->entradas();
+    ponerEntrada(destino, s, izquierdo, anterior.inicio);
+    if (dividir) ponerEntrada(destino, s + 1, derecho, anterior.inicio + izquierdo->tam);
+    for (size_t i = s + 1 + extra; i < total; i++) {
+        nuevas[i].inicio++;
     }
+    destino->tam = directorio->tam + 1;
+    destino->segmentos = static_cast<uint16_t>(total);
     
-    return -1; // No encontrado
+    if (destino != directorio) {
+        hijos.publicar(destino);
+        retirarBloque(directorio);
+    }
+    if (izquierdo != segmento) retirarBloque(segmento);
 }
 
-// Insertar nodo manteniendo orden lexicográfico
-void ArbolSistemaArchivos::insertarOrdenado(vector<NodoArbol*>& hijos, NodoArbol* nodo) {
-    auto it = lower_bound(hijos.begin(), hijos.end(), nodo,
-        [](const NodoArbol* a, const NodoArbol* b) {
-            return a->nombre < b->nombre;
-        });
-    hijos.insert(it, nodo);
+// Quitar el hijo en la posición indicada (sin liberar el nodo)
+void ArbolSistemaArchivos::quitarHijo(ListaHijos& hijos, int indice) {
+    if (hijos.esSegmentado()) {
+        quitarSegmentado(hijos, static_cast<size_t>(indice));
+        return;
+    }
+    
+    BloqueHijos* actual = hijos.bloque;
+    size_t tam = actual->tam;
+    size_t pos = static_cast<size_t>(indice);
+    
+    if (tam == 1) {
+        hijos.publicar(&BLOQUE_DIRECTORIO_VACIO);
+        retirarBloque(actual);
+        return;
+    }
+    
+    if (modoConcurrente) {
+        BloqueHijos* nuevo = almacen.reservarHijos(actual->clase);
+        moverHijos(actual, 0, pos, nuevo, 0);
+        moverHijos(actual, pos + 1, tam, nuevo, pos);
+        nuevo->tam = static_cast<uint32_t>(tam - 1);
+        hijos.publicar(nuevo);
+        retirarBloque(actual);
+        return;
+    }
+    
+    moverHijos(actual, pos + 1, tam, actual, pos);
+    actual->tam--;
 }
 
-// Buscar nodo por ruta
-NodoArbol* ArbolSistemaArchivos::buscarNodo(const string& ruta) {
-    if (ruta.empty() || ruta == "/") {
-        return raiz;
+// Quitar de un bloque segmentado. Un segmento que queda vacío sale del índice,
+// y por debajo de la mitad del tamaño máximo plano todo vuelve a ser plano
+void ArbolSistemaArchivos::quitarSegmentado(ListaHijos& hijos, size_t indice) {
+    BloqueHijos* directorio = hijos.bloque;
+    EntradaSegmento* entradas = directorio->entradas();
+    size_t n = directorio->segmentos;
+    size_t s = segmentoPorPosicion(directorio, indice);
+    EntradaSegmento anterior = entradas[s];
+    BloqueHijos* segmento = anterior.segmento;
+    size_t local = indice - anterior.inicio;
+    bool vaciado = segmento->tam == 1;
+    size_t total = directorio->tam - 1;
+    
+    if (total <= (1u << (CLASE_MAXIMA_PLANA - 1)) || (vaciado && n == 2)) {
+        vector<NodoArbol*> restantes;
+        restantes.reserve(total);
+        size_t i = 0;
+        for (NodoArbol* hijo : hijos) {
+            if (i++ != indice) restantes.push_back(hijo);
+        }
+        reemplazarLista(hijos, restantes);
+        return;
+    }
+    
+    BloqueHijos* nuevo = nullptr;
+    if (!vaciado) {
+        nuevo = modoConcurrente || compartido(segmento) ? almacen.reservarHijos(segmento->clase) : segmento;
+        if (nuevo != segmento) moverHijos(segmento, 0, local, nuevo, 0);
+        moverHijos(segmento, local + 1, segmento->tam, nuevo, local);
+        nuevo->tam = segmento->tam - 1;
+    }
+    
+    size_t quitadas = vaciado ? 1 : 0;
+    BloqueHijos* destino = modoConcurrente ? reservarDirectorio(almacen, n - quitadas) : directorio;
+    EntradaSegmento* nuevas = destino->entradas();
+    if (destino != directorio) moverEntradas(directorio, 0, s, destino, 0);
+    if (vaciado) {
+        moverEntradas(directorio, s + 1, n, destino, s);
+    } else {
+        if (destino != directorio) moverEntradas(directorio, s + 1, n, destino, s + 1);
+        ponerEntrada(destino, s, nuevo, anterior.inicio);
+    }
+    for (size_t i = s + 1 - quitadas; i < n - quitadas; i++) {
+        nuevas[i].inicio--;
     }
+    destino->tam = static_cast<uint32_t>(total);
+    destino->segmentos = static_cast<uint16_t>(n - quitadas);
     
-    vector<string> componentes = dividirRuta(ruta);
+    if (destino != directorio) {
+        hijos.publicar(destino);
+        retirarBloque(directorio);
+    }
+    if (nuevo != segmento) retirarBloque(segmento);
+}
+
+// Buscar nodo por ruta recorriendo los componentes en su lugar.
+// Cada bloque de hijos se lee una sola vez, así sirve también a lectores concurrentes
+NodoArbol* ArbolSistemaArchivos::buscarNodo(string_view ruta, vector<NodoArbol*>* ancestros) {
     NodoArbol* nodoActual = raiz;
+    string_view componente;
+    if (ancestros != nullptr) ancestros->assign(1, raiz);
     
-    for (const string& componente : componentes) {
-        int indice = busquedaBinaria(nodoActual->hijos, componente);
+    while (siguienteComponente(ruta, componente)) {
+        const BloqueHijos* bloque = nodoActual->hijos.leer();
+        int indice = busquedaBinaria(bloque, componente);
         if (indice == -1) {
             return nullptr;
         }
-        nodoActual = nodoActual->hijos[indice];
+        nodoActual = bloque->hijo(static_cast<size_t>(indice));
+        CONTAR(nodosVisitados);
+        if (ancestros != nullptr) ancestros->push_back(nodoActual);
     }
     
     return nodoActual;
 }
 
-// Cargar directorio recursivamente
-void ArbolSistemaArchivos::cargarDirectorioRecursivo(const filesystem::path& ruta, NodoArbol* nodo) {
+// Buscar el directorio padre de la ruta en una sola pasada.
+// Deja en 'nombre' el último componente; retorna nullptr si la ruta está vacía o el padre no existe
+NodoArbol* ArbolSistemaArchivos::buscarPadre(string_view ruta, string_view& nombre, vector<NodoArbol*>* ancestros) {
+    NodoArbol* nodoActual = raiz;
+    string_view componente;
+    nombre = string_view();
+    if (ancestros != nullptr) ancestros->assign(1, raiz);
+    
+    while (siguienteComponente(ruta, componente)) {
+        if (!nombre.empty()) {
+            int indice = busquedaBinaria(nodoActual->hijos.bloque, nombre);
+            if (indice == -1) {
+                return nullptr;
+            }
+            nodoActual = nodoActual->hijos[indice];
+            CONTAR(nodosVisitados);
+            if (ancestros != nullptr) ancestros->push_back(nodoActual);
+        }
+        nombre = componente;
+    }
+    
+    return nombre.empty() ? nullptr : nodoActual;
+}
+
+// Anotar el tamaño de un archivo (saturado al ancho del campo)
+static void anotarBytes(NodoArbol* nodo, uint64_t bytes) {
+    nodo->agregados.bytes = min(bytes, MAXIMO_BYTES_AGREGADOS) & MAXIMO_BYTES_AGREGADOS;
+}
+
+// Listar un directorio con filesystem::directory_iterator.
+// Crea un nodo por entrada en 'destino' y deja aparte los que son directorios
+static void listarConIterador(const filesystem::path& ruta, AlmacenNodos& destino, bool tamanos,
+                              vector<NodoArbol*>& nuevos, vector<NodoArbol*>& subdirectorios) {
     try {
         for (const auto& entrada : filesystem::directory_iterator(ruta)) {
-            string nombre = entrada.path().filename().string();
-            NodoArbol* nuevoNodo = new NodoArbol(nombre);
+            NodoArbol* nuevoNodo = destino.crearNodo(entrada.path().filename().string());
+            nuevos.push_back(nuevoNodo);
             
             if (entrada.is_directory()) {
-                cargarDirectorioRecursivo(entrada.path(), nuevoNodo);
+                nuevoNodo->marcarDirectorio();
+                subdirectorios.push_back(nuevoNodo);
+            } else if (tamanos && !entrada.is_symlink()) {
+                error_code error;
+                uintmax_t bytes = entrada.file_size(error);
+                if (!error) anotarBytes(nuevoNodo, bytes);
             }
-            
-            insertarOrdenado(nodo->hijos, nuevoNodo);
         }
     } catch (const filesystem::filesystem_error& e) {
         cerr << "Error al acceder al directorio: " << e.what() << endl;
     }
 }
 
-// Cargar desde directorio - ahora también guarda el directorio base
-void ArbolSistemaArchivos::cargarDesdeDirectorio(const string& rutaDirectorio) {
-    filesystem::path ruta(rutaDirectorio);
-    if (filesystem::exists(ruta) && filesystem::is_directory(ruta)) {
-        directorioBase = filesystem::absolute(ruta).string();
-        cargarDirectorioRecursivo(ruta, raiz);
+#ifdef __linux__
+// Listar un directorio abierto leyendo sus entradas crudas con getdents64.
+// El tipo sale de d_type; solo DT_UNKNOWN requiere un fstatat. Los enlaces
+// simbólicos no se siguen. Con 'tamanos' se hace un fstatat por archivo
+static void listarConGetdents(int fd, AlmacenNodos& destino, bool tamanos,
+                              vector<NodoArbol*>& nuevos, vector<NodoArbol*>& subdirectorios) {
+    static thread_local vector<char> buffer(TAM_BUFFER_GETDENTS);
+    
+    while (true) {
+        ssize_t leidos = getdents64(fd, buffer.data(), buffer.size());
+        CONTAR(llamadasSistema);
+        if (leidos < 0) {
+            cerr << "Error al leer el directorio: " << strerror(errno) << endl;
+            return;
+        }
+        if (leidos == 0) return;
+        
+        for (ssize_t pos = 0; pos < leidos; ) {
+            auto* entrada = reinterpret_cast<dirent64*>(buffer.data() + pos);
+            pos += entrada->d_reclen;
+            
+            string_view nombre(entrada->d_name);
+            if (nombre == "." || nombre == "..") continue;
+            
+            bool esDirectorio = entrada->d_type == DT_DIR;
+            struct stat info;
+            bool conInfo = false;
+            if (entrada->d_type == DT_UNKNOWN || (tamanos && !esDirectorio)) {
+                conInfo = fstatat(fd, entrada->d_name, &info, AT_SYMLINK_NOFOLLOW) == 0;
+                CONTAR(llamadasSistema);
+                esDirectorio = conInfo && S_ISDIR(info.st_mode);
+            }
+            
+            NodoArbol* nuevoNodo = destino.crearNodo(nombre);
+            nuevos.push_back(nuevoNodo);
+            if (esDirectorio) {
+                nuevoNodo->marcarDirectorio();
+                subdirectorios.push_back(nuevoNodo);
+            } else if (tamanos && conInfo && S_ISREG(info.st_mode)) {
+                anotarBytes(nuevoNodo, static_cast<uint64_t>(info.st_size));
+            }
+        }
     }
 }
 
-// Construir ruta completa del sistema de archivos
-string ArbolSistemaArchivos::construirRutaCompleta(const string& rutaRelativa) {
-    if (directorioBase.empty()) {
-        return rutaRelativa;
+// Abrir un directorio para leerlo con getdents64 (relativo a 'padre')
+static int abrirDescriptor(int padre, const char* ruta) {
+    int fd = openat(padre, ruta, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    CONTAR(llamadasSistema);
+    if (fd < 0) {
+        cerr << "Error al abrir el directorio '" << ruta << "': " << strerror(errno) << endl;
     }
+    return fd;
+}
+
+// Cargar directorio recursivamente usando descriptores relativos (openat)
+void ArbolSistemaArchivos::cargarDirectorioGetdents(int fd, NodoArbol* nodo) {
+    if (excedePresupuesto()) return;
+    vector<NodoArbol*> nuevos, subdirectorios;
+    listarConGetdents(fd, almacen, capturarTamanos, nuevos, subdirectorios);
+    asignarHijosOrdenados(almacen, nodo->hijos, nuevos);
     
-    if (rutaRelativa.empty() || rutaRelativa == "/") {
-        return directorioBase;
+    for (NodoArbol* subdirectorio : subdirectorios) {
+        int fdHijo = abrirDescriptor(fd, string(subdirectorio->nombre).c_str());
+        if (fdHijo < 0) continue;
+        cargarDirectorioGetdents(fdHijo, subdirectorio);
+        close(fdHijo);
     }
-    
-    return directorioBase + "/" + rutaRelativa;
 }
+#endif
 
-// Crear archivo en el sistema de archivos
-bool ArbolSistemaArchivos::crearArchivoSistema(const string& rutaCompleta) {
-    try {
-        // Crear directorios padre si no existen
-        filesystem::path ruta(rutaCompleta);
-        filesystem::create_directories(ruta.parent_path());
-        
-        // Crear archivo vacío
-        ofstream archivo(rutaCompleta);
-        if (archivo.is_open()) {
-            archivo.close();
-            return true;
-        }
-        return false;
-    } catch (const filesystem::filesystem_error& e) {
-        cerr << "Error al crear archivo: " << e.what() << endl;
-        return false;
+// Cargar directorio recursivamente
+void ArbolSistemaArchivos::cargarDirectorioRecursivo(const filesystem::path& ruta, NodoArbol* nodo) {
+    if (excedePresupuesto()) return;
+    vector<NodoArbol*> nuevos, subdirectorios;
+    listarConIterador(ruta, almacen, capturarTamanos, nuevos, subdirectorios);
+    asignarHijosOrdenados(almacen, nodo->hijos, nuevos);
+    
+    for (NodoArbol* subdirectorio : subdirectorios) {
+        cargarDirectorioRecursivo(ruta / subdirectorio->nombre, subdirectorio);
     }
 }
 
-// Crear directorio en el sistema de archivos
-bool ArbolSistemaArchivos::crearDirectorioSistema(const string& rutaCompleta) {
-    try {
-        return filesystem::create_directories(rutaCompleta);
-    } catch (const filesystem::filesystem_error& e) {
-        cerr << "Error al crear directorio: " << e.what() << endl;
-        return false;
+// Ordenar los hijos nuevos una sola vez y mezclarlos con los existentes
+// en un arreglo de la capacidad justa, reservado en 'destino'
+void ArbolSistemaArchivos::asignarHijosOrdenados(AlmacenNodos& destino, ListaHijos& hijos, vector<NodoArbol*>& nuevos) {
+    if (nuevos.empty()) return;
+    
+    auto porNombre = [](const NodoArbol* a, const NodoArbol* b) {
+        return a->nombre < b->nombre;
+    };
+    sort(nuevos.begin(), nuevos.end(), porNombre);
+    if (!hijos.empty()) {
+        size_t mitad = nuevos.size();
+        nuevos.insert(nuevos.end(), hijos.begin(), hijos.end());
+        inplace_merge(nuevos.begin(), nuevos.begin() + static_cast<ptrdiff_t>(mitad), nuevos.end(), porNombre);
+    }
+    
+    BloqueHijos* bloque = construirLista(destino, nuevos.data(), nuevos.size());
+    if (hijos.bloque != nullptr) {
+        liberarLista(destino, hijos.bloque);
     }
+    hijos.bloque = bloque;
 }
 
-// Eliminar del sistema de archivos
-bool ArbolSistemaArchivos::eliminarDelSistema(const string& rutaCompleta) {
-    try {
-        if (filesystem::exists(rutaCompleta)) {
-            if (filesystem::is_directory(rutaCompleta)) {
-                // Eliminar directorio y todo su contenido
-                return filesystem::remove_all(rutaCompleta) > 0;
-            } else {
-                // Eliminar archivo
-                return filesystem::remove(rutaCompleta);
-            }
+// Armar la lista para hijos ya ordenados: plana si cabe en el tamaño máximo
+// plano; si no, segmentada con segmentos a 3/4 para que las primeras
+// inserciones no los dividan
+BloqueHijos* ArbolSistemaArchivos::construirLista(AlmacenNodos& destino, NodoArbol* const* ordenados, size_t cantidad) {
+    if (cantidad <= (1u << CLASE_MAXIMA_PLANA)) {
+        BloqueHijos* bloque = destino.reservarHijos(static_cast<int>(bit_width(cantidad - 1)));
+        for (size_t i = 0; i < cantidad; i++) {
+            ponerHijo(bloque, i, ordenados[i]);
         }
-        return false;
-    } catch (const filesystem::filesystem_error& e) {
-        cerr << "Error al eliminar: " << e.what() << endl;
-        return false;
+        bloque->tam = static_cast<uint32_t>(cantidad);
+        return bloque;
+    }
+    
+    size_t porSegmento = (3u << CLASE_SEGMENTO) / 4;
+    if (cantidad > porSegmento * MAX_SEGMENTOS) {
+        porSegmento = (cantidad + MAX_SEGMENTOS - 1) / MAX_SEGMENTOS;
+    }
+    int claseSegmento = max(CLASE_SEGMENTO, static_cast<int>(bit_width(porSegmento - 1)));
+    size_t numSegmentos = (cantidad + porSegmento - 1) / porSegmento;
+    
+    BloqueHijos* directorio = reservarDirectorio(destino, numSegmentos);
+    for (size_t s = 0; s < numSegmentos; s++) {
+        size_t inicio = s * porSegmento;
+        size_t tam = min(porSegmento, cantidad - inicio);
+        BloqueHijos* segmento = destino.reservarHijos(claseSegmento);
+        for (size_t i = 0; i < tam; i++) {
+            ponerHijo(segmento, i, ordenados[inicio + i]);
+        }
+        segmento->tam = static_cast<uint32_t>(tam);
+        ponerEntrada(directorio, s, segmento, inicio);
     }
+    directorio->tam = static_cast<uint32_t>(cantidad);
+    directorio->segmentos = static_cast<uint16_t>(numSegmentos);
+    return directorio;
 }
 
-// Inserción 
-int ArbolSistemaArchivos::insertar(const string& ruta, bool esDirectorio) {
-    vector<string> componentes = dividirRuta(ruta);
-    if (componentes.empty()) {
-        return 2; // Ruta inválida
+// Devolver una lista completa (con sus segmentos) al almacén
+void ArbolSistemaArchivos::liberarLista(AlmacenNodos& destino, BloqueHijos* bloque) {
+    for (size_t s = 0; s < bloque->segmentos; s++) {
+        destino.liberarHijos(bloque->entradas()[s].segmento);
     }
-    
-    // Buscar directorio padre
-    string rutaPadre = "";
-    for (size_t i = 0; i < componentes.size() - 1; i++) {
-        if (i > 0) rutaPadre += "/";
-        rutaPadre += componentes[i];
+    destino.liberarHijos(bloque);
+}
+
+// Retirar una lista completa que ya fue reemplazada
+void ArbolSistemaArchivos::retirarLista(BloqueHijos* bloque) {
+    for (size_t s = 0; s < bloque->segmentos; s++) {
+        retirarBloque(bloque->entradas()[s].segmento);
     }
+    retirarBloque(bloque);
+}
+
+// Publicar una lista nueva armada desde cero y retirar la anterior
+void ArbolSistemaArchivos::reemplazarLista(ListaHijos& hijos, const vector<NodoArbol*>& ordenados) {
+    BloqueHijos* anterior = hijos.bloque;
+    hijos.publicar(ordenados.empty() ? &BLOQUE_DIRECTORIO_VACIO
+                                     : construirLista(almacen, ordenados.data(), ordenados.size()));
+    if (anterior != nullptr) retirarLista(anterior);
+}
+
+// Cambio en los hijos de un directorio: lo que suman o restan los hijos
+// agregados y quitados, y el mayor aporte a la altura (1 + la suya) de cada lado
+struct CambioAgregados {
+    int64_t archivos = 0;
+    int64_t directorios = 0;
+    int64_t bytes = 0;
+    uint32_t alturaAgregada = 0;
+    uint32_t alturaQuitada = 0;
     
-    NodoArbol* nodoPadre = buscarNodo(rutaPadre);
-    if (nodoPadre == nullptr || nodoPadre->esArchivo()) {
-        return 2; // No existe ruta padre o el padre es un archivo
+    void sumar(const NodoArbol* hijo, int64_t signo) {
+        bool esArchivo = hijo->esArchivo();
+        archivos += signo * (hijo->agregados.archivos + (esArchivo ? 1 : 0));
+        directorios += signo * (hijo->agregados.directorios + (esArchivo ? 0 : 1));
+        bytes += signo * static_cast<int64_t>(hijo->agregados.bytes);
     }
-    
-    // Verificar si ya existe
-    string nombreArchivo = componentes.back();
-    int indice = busquedaBinaria(nodoPadre->hijos, nombreArchivo);
-    if (indice != -1) {
-        return 1; // El archivo ya existe
+    void agregar(const NodoArbol* hijo) {
+        sumar(hijo, 1);
+        alturaAgregada = max(alturaAgregada, static_cast<uint32_t>(hijo->agregados.altura) + 1);
     }
+    void quitar(const NodoArbol* hijo) {
+        sumar(hijo, -1);
+        alturaQuitada = max(alturaQuitada, static_cast<uint32_t>(hijo->agregados.altura) + 1);
+    }
+};
+
+// Totales de un directorio a partir de los de sus hijos
+void ArbolSistemaArchivos::sumarAgregados(NodoArbol* nodo) {
+    if (nodo->esArchivo()) return; // Un archivo solo guarda su tamaño
     
-    // Crear en el sistema de archivos primero
-    string rutaCompleta = construirRutaCompleta(ruta);
-    bool exitoSistema = false;
+    uint32_t archivos = 0, directorios = 0, altura = 0;
+    uint64_t bytes = 0;
+    for (const NodoArbol* hijo : nodo->hijos) {
+        bool esArchivo = hijo->esArchivo();
+        archivos += hijo->agregados.archivos + (esArchivo ? 1u : 0u);
+        directorios += hijo->agregados.directorios + (esArchivo ? 0u : 1u);
+        bytes += hijo->agregados.bytes;
+        altura = max(altura, static_cast<uint32_t>(hijo->agregados.altura) + 1);
+    }
+    nodo->agregados.archivos = archivos;
+    nodo->agregados.directorios = directorios;
+    nodo->agregados.bytes = min(bytes, MAXIMO_BYTES_AGREGADOS) & MAXIMO_BYTES_AGREGADOS;
+    nodo->agregados.altura = altura & 0xFFFF;
+}
+
+// Calcular los agregados de todo un subárbol, de las hojas hacia arriba
+void ArbolSistemaArchivos::calcularAgregados(NodoArbol* nodo) {
+    for (NodoArbol* hijo : nodo->hijos) {
+        if (!hijo->esArchivo()) calcularAgregados(hijo);
+    }
+    sumarAgregados(nodo);
+}
+
+// Altura de un directorio según sus hijos; se detiene al alcanzar 'cota',
+// que no puede superar
+static uint32_t alturaDesdeHijos(const NodoArbol* nodo, uint32_t cota) {
+    uint32_t altura = 0;
+    for (const NodoArbol* hijo : nodo->hijos) {
+        altura = max(altura, static_cast<uint32_t>(hijo->agregados.altura) + 1);
+        if (altura >= cota) break;
+    }
+    return altura;
+}
+
+// Aplicar el cambio a todos los ancestros (de la raíz al directorio que
+// cambió). La altura solo se recalcula desde los hijos cuando se quitó el
+// hijo más alto, y deja de subir en cuanto un ancestro no cambia
+void ArbolSistemaArchivos::propagarAgregados(const vector<NodoArbol*>& ancestros, const CambioAgregados& cambio) {
+    uint32_t agregada = cambio.alturaAgregada, quitada = cambio.alturaQuitada;
+    bool alturas = true;
     
-    if (esDirectorio) {
-        exitoSistema = crearDirectorioSistema(rutaCompleta);
-    } else {
-        exitoSistema = crearArchivoSistema(rutaCompleta);
+    for (size_t i = ancestros.size(); i-- > 0; ) {
+        AgregadosSubarbol& agregados = ancestros[i]->agregados;
+        agregados.archivos = static_cast<uint32_t>(agregados.archivos + cambio.archivos);
+        agregados.directorios = static_cast<uint32_t>(agregados.directorios + cambio.directorios);
+        agregados.bytes = static_cast<uint64_t>(static_cast<int64_t>(agregados.bytes) + cambio.bytes) & MAXIMO_BYTES_AGREGADOS;
+        if (!alturas) continue;
+        
+        uint32_t antes = agregados.altura, despues = antes;
+        if (agregada > antes) {
+            despues = agregada;
+        } else if (quitada == antes && agregada < antes) {
+            despues = alturaDesdeHijos(ancestros[i], antes);
+        }
+        if (despues == antes) {
+            alturas = false;
+            continue;
+        }
+        agregados.altura = despues & 0xFFFF;
+        agregada = despues + 1;
+        quitada = antes + 1;
     }
+}
+
+// Cargar un directorio como tarea del pool: los nodos se crean en el almacén
+// del hilo y cada subdirectorio se agrega como una tarea nueva
+void ArbolSistemaArchivos::cargarDirectorioParalelo(PoolTrabajo& pool, vector<unique_ptr<AlmacenNodos>>& almacenes,
+                                                    const filesystem::path& ruta, NodoArbol* nodo,
+                                                    BackendCarga backend, int idHilo) {
+    if (excedePresupuesto()) return;
+    AlmacenNodos& local = *almacenes[static_cast<size_t>(idHilo)];
+    vector<NodoArbol*> nuevos, subdirectorios;
     
-    if (!exitoSistema) {
-        return 3; // Error del sistema de archivos
+#ifdef __linux__
+    if (backend == BackendCarga::Getdents) {
+        int fd = abrirDescriptor(AT_FDCWD, ruta.c_str());
+        if (fd >= 0) {
+            listarConGetdents(fd, local, capturarTamanos, nuevos, subdirectorios);
+            close(fd);
+        }
+    } else
+#endif
+    {
+        listarConIterador(ruta, local, capturarTamanos, nuevos, subdirectorios);
     }
     
-    // Si el sistema de archivos tuvo éxito, insertar en el árbol
-    NodoArbol* nuevoNodo = new NodoArbol(nombreArchivo);
-    insertarOrdenado(nodoPadre->hijos, nuevoNodo);
+    for (NodoArbol* subdirectorio : subdirectorios) {
+        pool.agregar(idHilo, [this, &pool, &almacenes, rutaHijo = ruta / subdirectorio->nombre,
+                              subdirectorio, backend](int id) {
+            cargarDirectorioParalelo(pool, almacenes, rutaHijo, subdirectorio, backend, id);
+        });
+    }
     
-    return 0; // Éxito
+    // Solo este hilo escribe los hijos de 'nodo'
+    asignarHijosOrdenados(local, nodo->hijos, nuevos);
 }
 
-// Eliminación 
-int ArbolSistemaArchivos::eliminar(const string& ruta) {
-    vector<string> componentes = dividirRuta(ruta);
-    if (componentes.empty()) {
-        return 1; // Ruta inválida
+// Cargar desde directorio - ahora también guarda el directorio base
+bool ArbolSistemaArchivos::cargarDesdeDirectorio(const string& rutaDirectorio, int numHilos, BackendCarga backend) {
+    if (modoConcurrente) {
+        cerr << "No se puede cargar un directorio en modo concurrente" << endl;
+        return false;
     }
-    
-    // Buscar directorio padre
-    string rutaPadre = "";
-    for (size_t i = 0; i < componentes.size() - 1; i++) {
-        if (i > 0) rutaPadre += "/";
-        rutaPadre += componentes[i];
+    if (!instantaneas.empty()) {
+        cerr << "No se puede cargar un directorio con instantáneas vivas" << endl;
+        return false;
     }
-    
-    NodoArbol* nodoPadre = buscarNodo(rutaPadre);
-    if (nodoPadre == nullptr) {
-        return 1; // No existe el padre
+    filesystem::path ruta(rutaDirectorio);
+    if (!filesystem::exists(ruta) || !filesystem::is_directory(ruta)) {
+        return false;
     }
+    if (imagen) materializarImagen();
+    directorioBase = filesystem::absolute(ruta).string();
+    desenlazarManejadores(""); // Sus descriptores apuntan al directorio anterior
+    versionDirectorios++;
     
-    // Buscar nodo a eliminar
-    string nombreArchivo = componentes.back();
-    int indice = busquedaBinaria(nodoPadre->hijos, nombreArchivo);
-    if (indice == -1) {
-        return 1; // No existe el archivo/directorio
-    }
+    reiniciarPicoArenas();
+    inicioCargaProceso = obtenerBytesArenas();
+    inicioCargaArbol = almacen.obtenerBytesReservados();
+    cargaExcedida.store(false, memory_order_relaxed);
     
-    // Eliminar del sistema de archivos primero
-    string rutaCompleta = construirRutaCompleta(ruta);
-    if (!eliminarDelSistema(rutaCompleta)) {
-        return 2; // Error del sistema de archivos
+    if (numHilos <= 1) {
+#ifdef __linux__
+        if (backend == BackendCarga::Getdents) {
+            int fd = abrirDescriptor(AT_FDCWD, ruta.c_str());
+            if (fd >= 0) {
+                cargarDirectorioGetdents(fd, raiz);
+                close(fd);
+            }
+        } else
+#endif
+        {
+            cargarDirectorioRecursivo(ruta, raiz);
+        }
+    } else {
+        // Un almacén por hilo para no sincronizar las reservas; al final se adoptan todos
+        PoolTrabajo pool(numHilos);
+        vector<unique_ptr<AlmacenNodos>> almacenes;
+        for (int i = 0; i < numHilos; i++) {
+            almacenes.push_back(make_unique<AlmacenNodos>());
+        }
+        
+        pool.agregar(0, [this, &pool, &almacenes, ruta, backend](int id) {
+            cargarDirectorioParalelo(pool, almacenes, ruta, raiz, backend, id);
+        });
+        pool.ejecutar();
+        
+        for (auto& local : almacenes) {
+            almacen.absorber(*local);
+        }
     }
     
-    // Si el sistema de archivos tuvo éxito, eliminar del árbol
-    NodoArbol* nodoAEliminar = nodoPadre->hijos[indice];
-    nodoPadre->hijos.erase(nodoPadre->hijos.begin() + indice);
-    eliminarSubarbol(nodoAEliminar);
+    size_t pico = obtenerPicoArenas();
+    picoCarga = inicioCargaArbol + (pico > inicioCargaProceso ? pico - inicioCargaProceso : 0);
+    if (cargaExcedida.load(memory_order_relaxed)) {
+        cerr << "La carga de '" << rutaDirectorio << "' pasó el presupuesto de " << presupuestoMemoria
+             << " bytes: se descarta" << endl;
+        vaciar();
+        return false;
+    }
+    calcularAgregados(raiz);
     
-    return 0; // Éxito
+    if (indiceActivo) {
+        indiceRutas.limpiar();
+        indexarSubarbol(raiz, HASH_RAIZ, true);
+    }
+    if (compactarTrasCarga) compactarMemoria();
+    return true;
 }
-// Obtener todas las rutas
-vector<string> ArbolSistemaArchivos::obtenerTodasLasRutas() {
-    vector<string> rutas;
-    obtenerRutasRecursivo(raiz, "", rutas);
-    return rutas;
+
+// Con presupuesto, cada directorio que se va a leer compara las arenas del
+// proceso (lo que creció desde el inicio de la carga) más lo que el árbol ya
+// tenía. Al pasarlo una vez, los directorios restantes ya no se leen
+bool ArbolSistemaArchivos::excedePresupuesto() {
+    if (presupuestoMemoria == 0) return false;
+    if (cargaExcedida.load(memory_order_relaxed)) return true;
+    size_t actual = obtenerBytesArenas();
+    size_t usados = inicioCargaArbol + (actual > inicioCargaProceso ? actual - inicioCargaProceso : 0);
+    if (usados <= presupuestoMemoria) return false;
+    cargaExcedida.store(true, memory_order_relaxed);
+    return true;
 }
 
-void ArbolSistemaArchivos::obtenerRutasRecursivo(NodoArbol* nodo, const string& rutaActual, vector<string>& rutas) {
-    if (nodo == nullptr) return;
+// Sin instantáneas ni modo concurrente: nada fuera del almacén apunta a sus
+// nodos salvo el reclamador, que se drena antes
+void ArbolSistemaArchivos::vaciar() {
+    if (reclamador) {
+        reclamador->drenar();
+        reclamador->recoger(almacen);
+    }
+    barrerRetenidos();
+    almacen.liberarTodo();
+    raiz = almacen.crearNodo("raiz");
+    raiz->marcarDirectorio();
+    indiceRutas.limpiar();
+    camino.clear();
+    directorioBase.clear();
+    desenlazarManejadores("");
+    versionDirectorios++;
+}
+
+// Primero todos los hijos, contiguos como al cargar, y después sus subárboles
+void ArbolSistemaArchivos::copiarHijos(AlmacenNodos& destino, const NodoArbol* origen, NodoArbol* copia) {
+    const BloqueHijos* bloque = origen->hijos.leer();
+    if (bloque == nullptr) return;
+    copia->marcarDirectorio();
+    if (bloque->tam == 0) return;
     
-    string nuevaRuta = rutaActual;
-    if (nodo != raiz) {
-        if (!nuevaRuta.empty()) nuevaRuta += "/";
-        nuevaRuta += nodo->nombre;
-        rutas.push_back(nuevaRuta);
+    vector<NodoArbol*> copias;
+    copias.reserve(bloque->tam);
+    for (NodoArbol* hijo : origen->hijos) {
+        NodoArbol* nuevo = destino.crearNodo(hijo->nombre);
+        nuevo->agregados = hijo->agregados;
+        copias.push_back(nuevo);
     }
+    copia->hijos.bloque = construirLista(destino, copias.data(), copias.size());
     
-    for (NodoArbol* hijo : nodo->hijos) {
-        obtenerRutasRecursivo(hijo, nuevaRuta, rutas);
+    size_t i = 0;
+    for (NodoArbol* hijo : origen->hijos) {
+        copiarHijos(destino, hijo, copias[i++]);
     }
 }
 
-// Contar nodos
-int ArbolSistemaArchivos::obtenerNumeroNodos() {
-    return contarNodosRecursivo(raiz) - 1; // -1 para no contar la raiz
+bool ArbolSistemaArchivos::compactarMemoria() {
+    if (modoConcurrente || !instantaneas.empty()) return false;
+    if (imagen) return true; // Solo la raíz está en el almacén
+    if (reclamador) {
+        reclamador->drenar();
+        reclamador->recoger(almacen);
+    }
+    barrerRetenidos();
+    
+    AlmacenNodos nuevo;
+    nuevo.fijarGeneracion(generacion);
+    NodoArbol* copia = nuevo.crearNodo(raiz->nombre);
+    copia->agregados = raiz->agregados;
+    copiarHijos(nuevo, raiz, copia);
+    
+    almacen.liberarTodo();
+    almacen.absorber(nuevo);
+    raiz = copia;
+    camino.clear();
+    versionDirectorios++;
+    if (indiceActivo) {
+        indiceRutas.limpiar();
+        indexarSubarbol(raiz, HASH_RAIZ, true);
+    }
+    return true;
 }
 
-int ArbolSistemaArchivos::contarNodosRecursivo(NodoArbol* nodo) {
-    if (nodo == nullptr) return 0;
+// Bytes de un bloque de hijos: la cabecera y, por posición, un puntero (o
+// media entrada de segmento) y un prefijo
+static void medirBloque(const BloqueHijos* bloque, InformeMemoria& informe) {
+    const size_t porPosicion = sizeof(NodoArbol*) + sizeof(uint64_t);
+    size_t ocupadas = bloque->esSegmentado() ? bloque->segmentos * (sizeof(EntradaSegmento) + sizeof(uint64_t))
+                                             : bloque->tam * porPosicion;
+    informe.hijos += sizeof(BloqueHijos) + ocupadas;
+    informe.holguraHijos += bloque->capacidadBloque() * porPosicion - ocupadas;
+}
+
+InformeMemoria ArbolSistemaArchivos::obtenerInformeMemoria() {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
     
-    int contador = 1;
-    for (NodoArbol* hijo : nodo->hijos) {
-        contador += contarNodosRecursivo(hijo);
+    InformeMemoria informe;
+    vector<const NodoArbol*> pendientes{raiz};
+    while (!pendientes.empty()) {
+        const NodoArbol* nodo = pendientes.back();
+        pendientes.pop_back();
+        informe.nodos += sizeof(NodoArbol);
+        informe.nombres += nodo->nombre.size();
+        
+        const BloqueHijos* bloque = nodo->hijos.leer();
+        if (bloque == nullptr || bloque->clase < 0) continue;
+        medirBloque(bloque, informe);
+        for (size_t s = 0; s < bloque->segmentos; s++) {
+            medirBloque(bloque->entradas()[s].segmento, informe);
+        }
+        for (NodoArbol* hijo : nodo->hijos) pendientes.push_back(hijo);
     }
     
-    return contador;
-}
-
-// Busca un nodo por ruta y devuelve:
-//   1 si no existe, 0 si es archivo, 2 si es directorio
-int ArbolSistemaArchivos::buscar(const string& ruta) {
-    NodoArbol* nodo = buscarNodo(ruta);
-    if (nodo == nullptr) return 1;        // No existe
-    return nodo->esArchivo() ? 0 : 2;     // 0=archivo, 2=directorio
+    size_t usados = almacen.obtenerBytesUsados();
+    size_t enlazados = informe.nodos + informe.nombres + informe.hijos + informe.holguraHijos;
+    informe.liberada = usados > enlazados ? usados - enlazados : 0;
+    informe.colaArenas = almacen.obtenerBytesReservados() - usados;
+    informe.indice = indiceRutas.obtenerBytes();
+    informe.imagen = imagen ? imagen->obtenerBytes() : 0;
+    informe.total = almacen.obtenerBytesReservados() + informe.indice;
+    informe.picoCarga = picoCarga;
+    return informe;
 }
 
-// Elimina recursivamente un subárbol liberando memoria
-void ArbolSistemaArchivos::eliminarSubarbol(NodoArbol* nodo) {
-    if (nodo) delete nodo;
+// Construir ruta completa del sistema de archivos
+string ArbolSistemaArchivos::construirRutaCompleta(string_view rutaRelativa) {
+    if (directorioBase.empty()) {
+        return string(rutaRelativa);
+    }
+    
+    if (rutaRelativa.empty() || rutaRelativa == "/") {
+        return directorioBase;
+    }
+    
+    string rutaCompleta;
+    rutaCompleta.reserve(directorioBase.size() + 1 + rutaRelativa.size());
+    rutaCompleta += directorioBase;
+    rutaCompleta += '/';
+    rutaCompleta += rutaRelativa;
+    return rutaCompleta;
+}
+
+// Unir una ruta relativa con un nombre ("" es la raíz)
+static string unirRuta(const string& ruta, string_view nombre) {
+    string resultado = ruta;
+    if (!resultado.empty()) resultado += '/';
+    resultado += nombre;
+    return resultado;
+}
+
+// Ruta relativa normalizada ("a//b/" queda "a/b")
+static string normalizarRuta(string_view ruta) {
+    string resultado;
+    string_view componente;
+    while (siguienteComponente(ruta, componente)) {
+        if (!resultado.empty()) resultado += '/';
+        resultado += componente;
+    }
+    return resultado;
+}
+
+// Aplicar una operación del diario. Es idempotente para poder reaplicarla:
+// lo que ya está como se pidió cuenta como éxito
+bool ArbolSistemaArchivos::aplicarOperacion(const OperacionDiario& op) {
+    error_code ec;
+    switch (op.tipo) {
+        case TipoOperacion::CrearArchivo:
+            return almacenamiento->crearArchivo(op.ruta);
+        case TipoOperacion::CrearDirectorio:
+            return almacenamiento->crearDirectorio(op.ruta) || filesystem::is_directory(op.ruta, ec);
+        case TipoOperacion::Eliminar:
+            return almacenamiento->eliminar(op.ruta) || !filesystem::exists(op.ruta, ec);
+        case TipoOperacion::Mover:
+            return almacenamiento->renombrar(op.ruta, op.destino)
+                || (!filesystem::exists(op.ruta, ec) && filesystem::exists(op.destino, ec));
+    }
+    return false;
+}
+
+// Crear un archivo o directorio (o encolarlo)
+bool ArbolSistemaArchivos::crearEnSistema(string_view ruta, bool esDirectorio) {
+    if (!almacenamiento->persistente()) return true;
+    string destino = almacenamiento->rutaDestino(directorioBase, ruta);
+    if (diario) {
+        diario->agregar(esDirectorio ? TipoOperacion::CrearDirectorio : TipoOperacion::CrearArchivo,
+                        std::move(destino));
+        return true;
+    }
+    CONTAR(llamadasSistema);
+    return esDirectorio ? almacenamiento->crearDirectorio(destino) : almacenamiento->crearArchivo(destino);
+}
+
+// Apartar con un rename a la papelera y encolar el borrado. No se aparta con
+// el diario (el orden de sus operaciones lo decide su hilo) ni con la
+// vigilancia (inotify seguiría informando lo borrado con la ruta anterior)
+bool ArbolSistemaArchivos::apartarEnSistema(string_view ruta) {
+    if (!almacenamiento->persistente() || diario || vigilante) return false;
+    string papelera = almacenamiento->rutaPapelera(directorioBase);
+    if (papelera.empty()) return false;
+    
+    string apartado = papelera + "/" + to_string(apartados++);
+    CONTAR(llamadasSistema);
+    if (!almacenamiento->mover(almacenamiento->rutaDestino(directorioBase, ruta), apartado)) return false;
+    reclamador->encolar(nullptr, std::move(apartado));
+    return true;
+}
+
+// Eliminar un archivo o directorio (o encolarlo)
+bool ArbolSistemaArchivos::eliminarEnSistema(string_view ruta) {
+    if (!almacenamiento->persistente()) return true;
+    string destino = almacenamiento->rutaDestino(directorioBase, ruta);
+    if (diario) {
+        diario->agregar(TipoOperacion::Eliminar, std::move(destino));
+        return true;
+    }
+    CONTAR(llamadasSistema);
+    return almacenamiento->eliminar(destino);
+}
+
+// Mover con un rename (o encolarlo)
+bool ArbolSistemaArchivos::moverEnSistema(string_view origen, string_view destino) {
+    if (!almacenamiento->persistente()) return true;
+    string desde = almacenamiento->rutaDestino(directorioBase, origen);
+    string hacia = almacenamiento->rutaDestino(directorioBase, destino);
+    if (diario) {
+        diario->agregar(TipoOperacion::Mover, std::move(desde), std::move(hacia));
+        return true;
+    }
+    CONTAR(llamadasSistema);
+    return almacenamiento->renombrar(desde, hacia);
+}
+
+// Crear dentro del directorio de un manejador: con su descriptor, salvo que
+// no lo tenga o que el diario deba encolar la ruta completa
+bool ArbolSistemaArchivos::crearEnSistema(const DirectorioAbierto& dir, string_view nombre, bool esDirectorio) {
+    if (!almacenamiento->persistente()) return true;
+    if (diario || dir.fd < 0) return crearEnSistema(unirRuta(dir.ruta, nombre), esDirectorio);
+    string hijo(nombre);
+    CONTAR(llamadasSistema);
+    return esDirectorio ? almacenamiento->crearDirectorioEn(dir.fd, hijo) : almacenamiento->crearArchivoEn(dir.fd, hijo);
+}
+
+// Eliminar un archivo dentro del directorio de un manejador, con la misma regla
+bool ArbolSistemaArchivos::eliminarEnSistema(const DirectorioAbierto& dir, string_view nombre) {
+    if (!almacenamiento->persistente()) return true;
+    if (diario || dir.fd < 0) return eliminarEnSistema(unirRuta(dir.ruta, nombre));
+    CONTAR(llamadasSistema);
+    return almacenamiento->eliminarArchivoEn(dir.fd, string(nombre));
+}
+
+// Activar la escritura diferida sobre el diario indicado
+bool ArbolSistemaArchivos::activarEscrituraDiferida(const string& archivoDiario) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (diario || !almacenamiento->persistente()) return false;
+    
+    auto nuevo = make_unique<Diario>([this](const OperacionDiario& op) { return aplicarOperacion(op); });
+    if (!nuevo->abrir(archivoDiario)) return false;
+    diario = std::move(nuevo);
+    return true;
+}
+
+// Aplicar lo pendiente y volver a la escritura inmediata
+void ArbolSistemaArchivos::desactivarEscrituraDiferida() {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    diario.reset();
+}
+
+// Lanzar (o detener, tras drenarlo) el hilo de reclamación
+void ArbolSistemaArchivos::activarReclamacion(bool activo) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (!activo) {
+        if (!reclamador) return;
+        reclamador->drenar();
+        reclamador->recoger(almacen);
+        reclamador.reset();
+        return;
+    }
+    if (reclamador) return;
+    
+    reclamador = make_unique<Reclamador>([this](const string& ruta) { return almacenamiento->eliminar(ruta); });
+    
+    // Lo que quedó apartado de una ejecución interrumpida
+    string papelera = almacenamiento->persistente() ? almacenamiento->rutaPapelera(directorioBase) : string();
+    error_code ec;
+    if (papelera.empty() || !filesystem::is_directory(papelera, ec)) return;
+    for (const auto& entrada : filesystem::directory_iterator(papelera, ec)) {
+        reclamador->encolar(nullptr, entrada.path().string());
+    }
+}
+
+bool ArbolSistemaArchivos::drenarReclamacion() {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (!reclamador) return true;
+    bool exito = reclamador->drenar();
+    reclamador->recoger(almacen);
+    return exito;
+}
+
+size_t ArbolSistemaArchivos::obtenerReclamacionPendiente() {
+    return reclamador ? reclamador->obtenerPendientes() : 0;
+}
+
+// Esperar a que el diario aplique todo lo encolado
+bool ArbolSistemaArchivos::sincronizar() {
+    return diario ? diario->sincronizar() : true;
+}
+
+// Inserción 
+int ArbolSistemaArchivos::insertar(string_view ruta, bool esDirectorio) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    // Buscar directorio padre
+    string_view nombreArchivo;
+    NodoArbol* nodoPadre = buscarPadre(ruta, nombreArchivo, &camino);
+    if (nodoPadre == nullptr || nodoPadre->esArchivo()) {
+        return 2; // Ruta inválida, no existe ruta padre o el padre es un archivo
+    }
+    
+    // Verificar si ya existe
+    int indice = busquedaBinaria(nodoPadre->hijos.bloque, nombreArchivo);
+    if (indice != -1) {
+        return 1; // El archivo ya existe
+    }
+    
+    // Crear en el sistema de archivos primero
+    if (!crearEnSistema(ruta, esDirectorio)) {
+        return 3; // Error del sistema de archivos
+    }
+    
+    // Si el sistema de archivos tuvo éxito, insertar en el árbol
+    NodoArbol* nuevoNodo = almacen.crearNodo(nombreArchivo);
+    if (esDirectorio) nuevoNodo->marcarDirectorio();
+    nodoPadre = copiarCamino(camino);
+    insertarOrdenado(nodoPadre->hijos, nuevoNodo);
+    CambioAgregados cambio;
+    cambio.agregar(nuevoNodo);
+    propagarAgregados(camino, cambio);
+    if (indiceActivo) {
+        string_view ultimo;
+        indiceRutas.insertar(hashRuta(ruta, ultimo), nuevoNodo);
+    }
+    if (modoConcurrente) reclamar(false);
+    if (reclamador) reclamador->recoger(almacen);
+    
+    return 0; // Éxito
+}
+
+// Eliminación 
+int ArbolSistemaArchivos::eliminar(string_view ruta) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    // Buscar directorio padre
+    string_view nombreArchivo;
+    NodoArbol* nodoPadre = buscarPadre(ruta, nombreArchivo, &camino);
+    if (nodoPadre == nullptr) {
+        return 1; // Ruta inválida o no existe el padre
+    }
+    
+    // Buscar nodo a eliminar
+    int indice = busquedaBinaria(nodoPadre->hijos.bloque, nombreArchivo);
+    if (indice == -1) {
+        return 1; // No existe el archivo/directorio
+    }
+    
+    // Eliminar del sistema de archivos primero (un subárbol grande se aparta
+    // y lo borra el reclamador)
+    NodoArbol* nodoAEliminar = nodoPadre->hijos[indice];
+    if (!(reclamable(nodoAEliminar) && apartarEnSistema(ruta)) && !eliminarEnSistema(ruta)) {
+        return 2; // Error del sistema de archivos
+    }
+    if (!nodoAEliminar->esArchivo()) desenlazarManejadores(normalizarRuta(ruta));
+    
+    // Si el sistema de archivos tuvo éxito, eliminar del árbol
+    nodoPadre = copiarCamino(camino);
+    quitarHijo(nodoPadre->hijos, indice);
+    CambioAgregados cambio;
+    cambio.quitar(nodoAEliminar);
+    propagarAgregados(camino, cambio);
+    if (indiceActivo) {
+        string_view ultimo;
+        indexarSubarbol(nodoAEliminar, hashRuta(ruta, ultimo), false);
+    }
+    retirarSubarbol(nodoAEliminar);
+    if (modoConcurrente) reclamar(false);
+    if (reclamador) reclamador->recoger(almacen);
+    
+    return 0; // Éxito
+}
+
+// Mover: dos búsquedas, un rename y el nodo cambia de lista. Primero se enlaza
+// en el destino y después se desenlaza del origen, para que un lector
+// concurrente lo encuentre al menos en uno de los dos
+int ArbolSistemaArchivos::mover(string_view origen, string_view destino) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    // Buscar el nodo a mover
+    string_view nombreOrigen;
+    NodoArbol* padreOrigen = buscarPadre(origen, nombreOrigen, &camino);
+    if (padreOrigen == nullptr) {
+        return 1; // Ruta inválida o no existe el padre
+    }
+    int indice = busquedaBinaria(padreOrigen->hijos.bloque, nombreOrigen);
+    if (indice == -1) {
+        return 1; // No existe el archivo/directorio
+    }
+    NodoArbol* nodo = padreOrigen->hijos[indice];
+    
+    // El padre del destino debe ser un directorio fuera del subárbol que se mueve
+    string_view nombreDestino;
+    NodoArbol* padreDestino = buscarPadre(destino, nombreDestino, &caminoDestino);
+    if (padreDestino == nullptr || padreDestino->esArchivo()) {
+        return 3;
+    }
+    if (busquedaBinaria(padreDestino->hijos.bloque, nombreDestino) != -1) {
+        return 2; // El destino ya existe
+    }
+    if (find(caminoDestino.begin(), caminoDestino.end(), nodo) != caminoDestino.end()) {
+        return 3; // El destino quedaría dentro de sí mismo
+    }
+    
+    if (!moverEnSistema(origen, destino)) {
+        return 4; // Error del sistema de archivos
+    }
+    
+    // El nombre de un nodo enlazado no cambia (lo leen los lectores y las
+    // instantáneas): con otro nombre se enlaza una copia que comparte el bloque de hijos
+    NodoArbol* movido = nodo;
+    if (nombreDestino != nodo->nombre) {
+        movido = almacen.crearNodo(nombreDestino);
+        movido->hijos.bloque = nodo->hijos.bloque;
+        movido->agregados = nodo->agregados;
+    }
+    
+    padreDestino = copiarCamino(caminoDestino);
+    insertarOrdenado(padreDestino->hijos, movido);
+    CambioAgregados llegada;
+    llegada.agregar(movido);
+    propagarAgregados(caminoDestino, llegada);
+    if (!nodo->esArchivo()) moverManejadores(normalizarRuta(origen), normalizarRuta(destino));
+    
+    // Copiar el camino del destino pudo reemplazar ancestros comunes
+    if (!instantaneas.empty()) padreOrigen = buscarPadre(origen, nombreOrigen, &camino);
+    padreOrigen = copiarCamino(camino);
+    quitarHijo(padreOrigen->hijos, busquedaBinaria(padreOrigen->hijos.bloque, nombreOrigen));
+    CambioAgregados salida;
+    salida.quitar(nodo);
+    propagarAgregados(camino, salida);
+    
+    // Solo el índice y la vigilancia guardan rutas completas de los descendientes
+    if (indiceActivo) {
+        string_view ultimo;
+        indexarSubarbol(nodo, hashRuta(origen, ultimo), false);
+        indexarSubarbol(movido, hashRuta(destino, ultimo), true);
+    }
+#ifdef __linux__
+    if (vigilante && !nodo->esArchivo()) vigilante->renombrar(normalizarRuta(origen), normalizarRuta(destino));
+#endif
+    
+    if (movido != nodo) {
+        retirarNodo(nodo);
+    } else if (!nodo->esArchivo()) {
+        versionDirectorios++;
+    }
+    if (modoConcurrente) reclamar(false);
+    if (reclamador) reclamador->recoger(almacen);
+    
+    return 0; // Éxito
+}
+
+// Un nombre relativo a un manejador es un solo componente
+static bool nombreSimple(string_view nombre) {
+    return !nombre.empty() && nombre.find('/') == string_view::npos;
+}
+
+// 'ruta' es 'base' o cuelga de ella ("" contiene a todas)
+static bool dentroDeRuta(string_view ruta, string_view base) {
+    return base.empty() || (ruta.starts_with(base) && (ruta.size() == base.size() || ruta[base.size()] == '/'));
+}
+
+void ArbolSistemaArchivos::desenlazarManejadores(string_view ruta) {
+    lock_guard<mutex> guardia(cerrojoManejadores);
+    for (DirectorioAbierto* dir : manejadores) {
+        if (dentroDeRuta(dir->movido ? dir->rutaMovida : dir->ruta, ruta)) dir->desenlazado = true;
+    }
+}
+
+void ArbolSistemaArchivos::moverManejadores(string_view origen, string_view destino) {
+    lock_guard<mutex> guardia(cerrojoManejadores);
+    for (DirectorioAbierto* dir : manejadores) {
+        const string& actual = dir->movido ? dir->rutaMovida : dir->ruta;
+        if (!dentroDeRuta(actual, origen)) continue;
+        string nueva(destino);
+        nueva.append(actual, origen.size());
+        dir->rutaMovida = std::move(nueva);
+        dir->movido = true;
+    }
+}
+
+// Aplicar las marcas del manejador y volver a buscar sus nodos por la ruta
+// (pudieron copiarse). La versión se lee antes de recorrer: si algo cambia
+// durante la resolución, el siguiente uso vuelve a resolver. El descriptor se
+// conserva: sigue al directorio aunque se haya movido
+bool ArbolSistemaArchivos::resolverDirectorio(DirectorioAbierto& dir) {
+    uint64_t version = versionDirectorios.load();
+    bool desenlazado;
+    {
+        lock_guard<mutex> guardia(cerrojoManejadores);
+        if (dir.movido) {
+            dir.ruta = std::move(dir.rutaMovida);
+            dir.movido = false;
+        }
+        desenlazado = dir.desenlazado;
+    }
+    if (desenlazado) {
+        dir.soltar();
+        return false;
+    }
+    
+    NodoArbol* nodo = buscarNodo(dir.ruta, &dir.ancestros);
+    if (nodo == nullptr || nodo->esArchivo()) return false; // Sin marca: vuelve a intentar
+    string_view ultimo;
+    dir.huella = hashRuta(dir.ruta, ultimo);
+    dir.version = version;
+    return true;
+}
+
+bool ArbolSistemaArchivos::validarDirectorio(DirectorioAbierto& dir) {
+    if (dir.arbol != this) return false;
+    if (dir.version == versionDirectorios.load()) return true;
+    return resolverDirectorio(dir);
+}
+
+// Abrir un manejador con la ruta normalizada ("a//b/" queda "a/b"), registrarlo
+// y abrir su descriptor
+DirectorioAbierto ArbolSistemaArchivos::abrirDirectorio(string_view ruta) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    DirectorioAbierto dir;
+    dir.ruta = normalizarRuta(ruta);
+    dir.version = versionDirectorios.load();
+    NodoArbol* nodo = buscarNodo(dir.ruta, &dir.ancestros);
+    if (nodo == nullptr || nodo->esArchivo()) {
+        dir.ancestros.clear();
+        return dir;
+    }
+    
+    string_view ultimo;
+    dir.huella = hashRuta(dir.ruta, ultimo);
+    dir.arbol = this;
+    {
+        lock_guard<mutex> registro(cerrojoManejadores);
+        manejadores.push_back(&dir);
+    }
+    
+    // Con el tope de descriptores alcanzado el manejador usa rutas completas
+    if (almacenamiento->persistente()) {
+        if (descriptoresManejadores.fetch_add(1) < MAXIMO_DESCRIPTORES_MANEJADORES) {
+            dir.fd = almacenamiento->abrirDirectorio(almacenamiento->rutaDestino(directorioBase, dir.ruta));
+        }
+        if (dir.fd < 0) descriptoresManejadores--;
+    }
+    return dir;
+}
+
+// Búsqueda de un nombre en el directorio del manejador: una búsqueda binaria
+int ArbolSistemaArchivos::buscarEn(DirectorioAbierto& dir, string_view nombre) {
+    optional<GuardiaLectura> guardia;
+    if (modoConcurrente) {
+        guardia.emplace();
+    } else if (imagen) {
+        materializarImagen();
+    }
+    if (!nombreSimple(nombre) || !validarDirectorio(dir)) return 1;
+    
+    const BloqueHijos* bloque = dir.ancestros.back()->hijos.leer();
+    int indice = busquedaBinaria(bloque, nombre);
+    if (indice == -1) return 1;
+    CONTAR(nodosVisitados);
+    return bloque->hijo(static_cast<size_t>(indice))->esArchivo() ? 0 : 2;
+}
+
+// Inserción relativa: como insertar, con el camino del manejador en vez del
+// que resuelve buscarPadre
+int ArbolSistemaArchivos::insertarEn(DirectorioAbierto& dir, string_view nombre, bool esDirectorio) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    if (!nombreSimple(nombre) || !validarDirectorio(dir)) {
+        return 2; // Nombre inválido o el directorio ya no existe
+    }
+    
+    NodoArbol* nodoPadre = dir.ancestros.back();
+    if (busquedaBinaria(nodoPadre->hijos.bloque, nombre) != -1) {
+        return 1; // El archivo ya existe
+    }
+    if (!crearEnSistema(dir, nombre, esDirectorio)) {
+        return 3; // Error del sistema de archivos
+    }
+    
+    NodoArbol* nuevoNodo = almacen.crearNodo(nombre);
+    if (esDirectorio) nuevoNodo->marcarDirectorio();
+    nodoPadre = copiarCamino(dir.ancestros);
+    dir.version = versionDirectorios.load(); // Sus ancestros ya son las copias
+    insertarOrdenado(nodoPadre->hijos, nuevoNodo);
+    CambioAgregados cambio;
+    cambio.agregar(nuevoNodo);
+    propagarAgregados(dir.ancestros, cambio);
+    if (indiceActivo) {
+        indiceRutas.insertar(extenderHash(dir.huella, nombre, dir.ruta.empty()), nuevoNodo);
+    }
+    if (modoConcurrente) reclamar(false);
+    if (reclamador) reclamador->recoger(almacen);
+    
+    return 0; // Éxito
+}
+
+// Eliminación relativa. Un archivo se borra con el descriptor del manejador;
+// un directorio sigue por su ruta (apartado a la papelera o borrado entero)
+int ArbolSistemaArchivos::eliminarEn(DirectorioAbierto& dir, string_view nombre) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    if (!nombreSimple(nombre) || !validarDirectorio(dir)) {
+        return 1; // Nombre inválido o el directorio ya no existe
+    }
+    
+    NodoArbol* nodoPadre = dir.ancestros.back();
+    int indice = busquedaBinaria(nodoPadre->hijos.bloque, nombre);
+    if (indice == -1) {
+        return 1; // No existe el archivo/directorio
+    }
+    
+    NodoArbol* nodoAEliminar = nodoPadre->hijos[indice];
+    bool exito;
+    if (nodoAEliminar->esArchivo()) {
+        exito = eliminarEnSistema(dir, nombre);
+    } else {
+        string ruta = unirRuta(dir.ruta, nombre);
+        exito = (reclamable(nodoAEliminar) && apartarEnSistema(ruta)) || eliminarEnSistema(ruta);
+    }
+    if (!exito) {
+        return 2; // Error del sistema de archivos
+    }
+    if (!nodoAEliminar->esArchivo()) desenlazarManejadores(unirRuta(dir.ruta, nombre));
+    
+    nodoPadre = copiarCamino(dir.ancestros);
+    quitarHijo(nodoPadre->hijos, indice);
+    CambioAgregados cambio;
+    cambio.quitar(nodoAEliminar);
+    propagarAgregados(dir.ancestros, cambio);
+    if (indiceActivo) {
+        indexarSubarbol(nodoAEliminar, extenderHash(dir.huella, nombre, dir.ruta.empty()), false);
+    }
+    retirarSubarbol(nodoAEliminar);
+    dir.version = versionDirectorios.load(); // Lo eliminado no era su directorio
+    if (modoConcurrente) reclamar(false);
+    if (reclamador) reclamador->recoger(almacen);
+    
+    return 0; // Éxito
+}
+
+// Ruta de un lote separada en padre y nombre, con su posición original
+struct RutaLote {
+    string_view padre;
+    string_view nombre;
+    size_t posicion;
+};
+
+// Separar las rutas válidas de un lote y ordenarlas por (padre, nombre).
+// El orden es estable: entre rutas repetidas la primera queda adelante
+static vector<RutaLote> agruparPorPadre(const vector<string>& rutas) {
+    vector<RutaLote> lote;
+    lote.reserve(rutas.size());
+    
+    for (size_t i = 0; i < rutas.size(); i++) {
+        string_view ruta = rutas[i];
+        size_t fin = ruta.find_last_not_of('/');
+        if (fin == string_view::npos) continue; // Ruta vacía
+        ruta = ruta.substr(0, fin + 1);
+        
+        size_t barra = ruta.rfind('/');
+        string_view nombre = barra == string_view::npos ? ruta : ruta.substr(barra + 1);
+        string_view padre = barra == string_view::npos ? string_view() : ruta.substr(0, barra);
+        size_t finPadre = padre.find_last_not_of('/');
+        padre = finPadre == string_view::npos ? string_view() : padre.substr(0, finPadre + 1);
+        lote.push_back({padre, nombre, i});
+    }
+    
+    stable_sort(lote.begin(), lote.end(), [](const RutaLote& a, const RutaLote& b) {
+        return a.padre != b.padre ? a.padre < b.padre : a.nombre < b.nombre;
+    });
+    return lote;
+}
+
+// Mezclar hijos nuevos (ordenados y sin repetir los existentes) en una pasada
+void ArbolSistemaArchivos::mezclarHijos(ListaHijos& hijos, const vector<NodoArbol*>& nuevos) {
+    if (nuevos.empty()) return;
+    
+    auto porNombre = [](const NodoArbol* a, const NodoArbol* b) {
+        return a->nombre < b->nombre;
+    };
+    BloqueHijos* actual = hijos.bloque;
+    size_t tam = hijos.size();
+    size_t total = tam + nuevos.size();
+    
+    // En un bloque segmentado, pocos nuevos se insertan uno a uno; muchos
+    // (o un bloque plano que se pasa del máximo) rearman la lista completa
+    if (hijos.esSegmentado() || total > (1u << CLASE_MAXIMA_PLANA)) {
+        if (hijos.esSegmentado() && nuevos.size() * ((1u << CLASE_SEGMENTO) + actual->segmentos) < tam) {
+            for (NodoArbol* nodo : nuevos) {
+                insertarSegmentado(hijos, nodo);
+            }
+            return;
+        }
+        vector<NodoArbol*> mezclados(total);
+        merge(hijos.begin(), hijos.end(), nuevos.begin(), nuevos.end(), mezclados.begin(), porNombre);
+        reemplazarLista(hijos, mezclados);
+        return;
+    }
+    
+    // Con espacio y sin lectores concurrentes se mezcla en su lugar desde el final
+    if (!modoConcurrente && total <= hijos.capacidad()) {
+        mezclarEnBloque(actual, tam, nuevos, actual);
+        return;
+    }
+    
+    BloqueHijos* nuevo = almacen.reservarHijos(static_cast<int>(bit_width(total - 1)));
+    mezclarEnBloque(actual == nullptr ? &BLOQUE_DIRECTORIO_VACIO : actual, tam, nuevos, nuevo);
+    hijos.publicar(nuevo);
+    if (actual != nullptr) retirarBloque(actual);
+}
+
+// Quitar varios hijos (posiciones crecientes) en una pasada, sin liberar los nodos
+void ArbolSistemaArchivos::quitarHijos(ListaHijos& hijos, const vector<int>& posiciones) {
+    if (posiciones.empty()) return;
+    if (hijos.esSegmentado()) {
+        quitarHijosSegmentado(hijos, posiciones);
+        return;
+    }
+    
+    BloqueHijos* actual = hijos.bloque;
+    size_t tam = actual->tam;
+    size_t quedan = tam - posiciones.size();
+    if (quedan == 0) {
+        hijos.publicar(&BLOQUE_DIRECTORIO_VACIO);
+        retirarBloque(actual);
+        return;
+    }
+    
+    BloqueHijos* destino = modoConcurrente ? almacen.reservarHijos(actual->clase) : actual;
+    size_t escritos = 0, siguiente = 0;
+    for (size_t i = 0; i < tam; i++) {
+        if (siguiente < posiciones.size() && static_cast<size_t>(posiciones[siguiente]) == i) {
+            siguiente++;
+            continue;
+        }
+        moverHijos(actual, i, i + 1, destino, escritos++);
+    }
+    destino->tam = static_cast<uint32_t>(quedan);
+    
+    if (destino != actual) {
+        hijos.publicar(destino);
+        retirarBloque(actual);
+    }
+}
+
+// Quitar varios hijos de un bloque segmentado: se filtra cada segmento afectado
+// y se rearma el índice, sin tocar los segmentos que no cambian
+void ArbolSistemaArchivos::quitarHijosSegmentado(ListaHijos& hijos, const vector<int>& posiciones) {
+    BloqueHijos* directorio = hijos.bloque;
+    const EntradaSegmento* entradas = directorio->entradas();
+    size_t n = directorio->segmentos;
+    size_t total = directorio->tam - posiciones.size();
+    
+    if (total <= (1u << (CLASE_MAXIMA_PLANA - 1))) {
+        vector<NodoArbol*> restantes;
+        restantes.reserve(total);
+        size_t i = 0, siguiente = 0;
+        for (NodoArbol* hijo : hijos) {
+            if (siguiente < posiciones.size() && static_cast<size_t>(posiciones[siguiente]) == i) {
+                siguiente++;
+            } else {
+                restantes.push_back(hijo);
+            }
+            i++;
+        }
+        reemplazarLista(hijos, restantes);
+        return;
+    }
+    
+    vector<EntradaSegmento> nuevas;
+    vector<BloqueHijos*> reemplazados; // Se retiran después de publicar
+    nuevas.reserve(n);
+    size_t siguiente = 0, inicio = 0;
+    for (size_t s = 0; s < n; s++) {
+        BloqueHijos* segmento = entradas[s].segmento;
+        size_t base = entradas[s].inicio;
+        size_t primero = siguiente;
+        while (siguiente < posiciones.size() && static_cast<size_t>(posiciones[siguiente]) < base + segmento->tam) {
+            siguiente++;
+        }
+        if (siguiente == primero) {
+            nuevas.push_back({segmento, inicio});
+            inicio += segmento->tam;
+            continue;
+        }
+        
+        size_t quedan = segmento->tam - (siguiente - primero);
+        if (quedan > 0) {
+            BloqueHijos* filtrado = modoConcurrente || compartido(segmento) ? almacen.reservarHijos(segmento->clase) : segmento;
+            size_t escritos = 0, k = primero;
+            for (size_t i = 0; i < segmento->tam; i++) {
+                if (k < siguiente && static_cast<size_t>(posiciones[k]) == base + i) {
+                    k++;
+                    continue;
+                }
+                moverHijos(segmento, i, i + 1, filtrado, escritos++);
+            }
+            filtrado->tam = static_cast<uint32_t>(quedan);
+            nuevas.push_back({filtrado, inicio});
+            inicio += quedan;
+            if (filtrado == segmento) continue;
+        }
+        reemplazados.push_back(segmento);
+    }
+    
+    BloqueHijos* destino;
+    if (nuevas.size() == 1) {
+        destino = nuevas[0].segmento; // Un solo segmento ya es un bloque plano
+        if (compartido(destino)) {
+            reemplazados.push_back(destino); // El bloque del padre debe ser propio
+            destino = copiarBloque(destino);
+        }
+    } else {
+        destino = modoConcurrente ? reservarDirectorio(almacen, nuevas.size()) : directorio;
+        for (size_t s = 0; s < nuevas.size(); s++) {
+            ponerEntrada(destino, s, nuevas[s].segmento, nuevas[s].inicio);
+        }
+        destino->tam = static_cast<uint32_t>(total);
+        destino->segmentos = static_cast<uint16_t>(nuevas.size());
+    }
+    
+    if (destino != directorio) {
+        hijos.publicar(destino);
+        retirarBloque(directorio);
+    }
+    for (BloqueHijos* segmento : reemplazados) {
+        retirarBloque(segmento);
+    }
+}
+
+// Inserción por lotes
+vector<int> ArbolSistemaArchivos::insertarLote(const vector<string>& rutas, bool esDirectorio) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    vector<int> resultados(rutas.size(), 2); // Rutas inválidas: 2
+    vector<RutaLote> lote = agruparPorPadre(rutas);
+    vector<NodoArbol*> nuevos;
+    
+    for (size_t inicio = 0; inicio < lote.size(); ) {
+        size_t fin = inicio;
+        while (fin < lote.size() && lote[fin].padre == lote[inicio].padre) fin++;
+        
+        // Un solo recorrido por padre
+        NodoArbol* nodoPadre = buscarNodo(lote[inicio].padre, &camino);
+        if (nodoPadre == nullptr || nodoPadre->esArchivo()) {
+            inicio = fin; // No existe ruta padre o el padre es un archivo
+            continue;
+        }
+        
+        nuevos.clear();
+        CambioAgregados cambio;
+        for (size_t i = inicio; i < fin; i++) {
+            const RutaLote& r = lote[i];
+            if ((i > inicio && lote[i - 1].nombre == r.nombre)
+                || busquedaBinaria(nodoPadre->hijos.bloque, r.nombre) != -1) {
+                resultados[r.posicion] = 1; // Ya existe (o repetida en el lote)
+                continue;
+            }
+            
+            if (!crearEnSistema(rutas[r.posicion], esDirectorio)) {
+                resultados[r.posicion] = 3;
+                continue;
+            }
+            
+            NodoArbol* nuevoNodo = almacen.crearNodo(r.nombre);
+            if (esDirectorio) nuevoNodo->marcarDirectorio();
+            nuevos.push_back(nuevoNodo);
+            cambio.agregar(nuevoNodo);
+            if (indiceActivo) {
+                string_view ultimo;
+                indiceRutas.insertar(hashRuta(rutas[r.posicion], ultimo), nuevoNodo);
+            }
+            resultados[r.posicion] = 0;
+        }
+        if (!nuevos.empty()) nodoPadre = copiarCamino(camino);
+        mezclarHijos(nodoPadre->hijos, nuevos);
+        propagarAgregados(camino, cambio);
+        inicio = fin;
+    }
+    
+    if (modoConcurrente) reclamar(false);
+    if (reclamador) reclamador->recoger(almacen);
+    return resultados;
+}
+
+// Eliminación por lotes
+vector<int> ArbolSistemaArchivos::eliminarLote(const vector<string>& rutas) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    vector<int> resultados(rutas.size(), 1); // Rutas inválidas: 1
+    vector<RutaLote> lote = agruparPorPadre(rutas);
+    vector<int> posiciones;
+    vector<NodoArbol*> quitados;
+    
+    for (size_t inicio = 0; inicio < lote.size(); ) {
+        size_t fin = inicio;
+        while (fin < lote.size() && lote[fin].padre == lote[inicio].padre) fin++;
+        
+        NodoArbol* nodoPadre = buscarNodo(lote[inicio].padre, &camino);
+        if (nodoPadre == nullptr) {
+            inicio = fin;
+            continue;
+        }
+        
+        posiciones.clear();
+        quitados.clear();
+        CambioAgregados cambio;
+        for (size_t i = inicio; i < fin; i++) {
+            const RutaLote& r = lote[i];
+            if (i > inicio && lote[i - 1].nombre == r.nombre) continue; // Repetida: ya no existe
+            int indice = busquedaBinaria(nodoPadre->hijos.bloque, r.nombre);
+            if (indice == -1) continue;
+            
+            NodoArbol* nodo = nodoPadre->hijos[static_cast<size_t>(indice)];
+            if (!(reclamable(nodo) && apartarEnSistema(rutas[r.posicion])) && !eliminarEnSistema(rutas[r.posicion])) {
+                resultados[r.posicion] = 2;
+                continue;
+            }
+            if (!nodo->esArchivo()) desenlazarManejadores(normalizarRuta(rutas[r.posicion]));
+            
+            if (indiceActivo) {
+                string_view ultimo;
+                indexarSubarbol(nodo, hashRuta(rutas[r.posicion], ultimo), false);
+            }
+            posiciones.push_back(indice);
+            quitados.push_back(nodo);
+            cambio.quitar(nodo);
+            resultados[r.posicion] = 0;
+        }
+        
+        if (!posiciones.empty()) nodoPadre = copiarCamino(camino);
+        quitarHijos(nodoPadre->hijos, posiciones);
+        propagarAgregados(camino, cambio);
+        for (NodoArbol* nodo : quitados) {
+            retirarSubarbol(nodo);
+        }
+        inicio = fin;
+    }
+    
+    if (modoConcurrente) reclamar(false);
+    if (reclamador) reclamador->recoger(almacen);
+    return resultados;
+}
+
+// Obtener todas las rutas
+vector<string> ArbolSistemaArchivos::obtenerTodasLasRutas() {
+    vector<string> rutas;
+    if (imagen) {
+        obtenerRutasImagen(0, "", rutas);
+        return rutas;
+    }
+    obtenerRutasRecursivo(raiz, "", rutas);
+    return rutas;
+}
+
+void ArbolSistemaArchivos::obtenerRutasRecursivo(NodoArbol* nodo, const string& rutaActual, vector<string>& rutas) {
+    if (nodo == nullptr) return;
+    
+    string nuevaRuta = rutaActual;
+    if (nodo != raiz) {
+        if (!nuevaRuta.empty()) nuevaRuta += "/";
+        nuevaRuta += nodo->nombre;
+        rutas.push_back(nuevaRuta);
+    }
+    
+    for (NodoArbol* hijo : nodo->hijos) {
+        obtenerRutasRecursivo(hijo, nuevaRuta, rutas);
+    }
+}
+
+// Contar nodos
+int ArbolSistemaArchivos::obtenerNumeroNodos() {
+    if (imagen) return static_cast<int>(imagen->obtenerNumeroNodos()) - 1;
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    return static_cast<int>(raiz->agregados.archivos + raiz->agregados.directorios);
+}
+
+// Totales de un subárbol: se leen del nodo, ya están al día
+bool ArbolSistemaArchivos::obtenerAgregados(string_view ruta, AgregadosSubarbol& agregados) {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    NodoArbol* nodo = buscarNodo(ruta);
+    if (nodo == nullptr) return false;
+    agregados = nodo->agregados;
+    return true;
+}
+
+int ArbolSistemaArchivos::contarNodosRecursivo(NodoArbol* nodo) {
+    if (nodo == nullptr) return 0;
+    
+    int contador = 1;
+    for (NodoArbol* hijo : nodo->hijos) {
+        contador += contarNodosRecursivo(hijo);
+    }
+    
+    return contador;
+}
+
+// Busca un nodo por ruta y devuelve:
+//   1 si no existe, 0 si es archivo, 2 si es directorio
+int ArbolSistemaArchivos::buscar(string_view ruta) {
+    if (modoConcurrente) {
+        GuardiaLectura guardia;
+        NodoArbol* nodo = buscarNodo(ruta);
+        if (nodo == nullptr) return 1;
+        return nodo->esArchivo() ? 0 : 2;
+    }
+    
+    if (indiceActivo) {
+        string_view ultimo;
+        HashRuta huella = hashRuta(ruta, ultimo);
+        if (!ultimo.empty()) {
+            NodoArbol* nodo = indiceRutas.buscar(huella);
+            if (nodo == nullptr) return 1;
+            CONTAR(nodosVisitados);
+            CONTAR(comparaciones);
+            if (nodo->nombre != ultimo) return 1;
+            return nodo->esArchivo() ? 0 : 2;
+        }
+    }
+    
+    if (imagen) {
+        int64_t indice = imagen->buscarNodo(ruta);
+        if (indice == -1) return 1;
+        return imagen->nodo(static_cast<size_t>(indice)).banderas & NODO_IMAGEN_DIRECTORIO ? 2 : 0;
+    }
+    
+    NodoArbol* nodo = buscarNodo(ruta);
+    if (nodo == nullptr) return 1;        // No existe
+    return nodo->esArchivo() ? 0 : 2;     // 0=archivo, 2=directorio
+}
+
+// Búsqueda de buscarLote en curso. Cada turno usa solo lo que se pidió en el
+// turno anterior y pide lo del siguiente, así que un nivel de un bloque plano
+// son cinco turnos: el nodo (su bloque), la cabecera (los prefijos), los
+// prefijos (el candidato), el candidato (su nombre) y el nombre (confirmar).
+// Los bloques segmentados, poco comunes, se buscan en un solo turno
+struct BusquedaEnCurso {
+    enum Etapa : uint8_t { Nodo, Cabecera, Prefijos, Nombre, Confirmar, Segmentado };
+    
+    string_view resto;      // Componentes que faltan
+    string_view componente; // El que se busca en 'bloque'
+    const NodoArbol* nodo;
+    const BloqueHijos* bloque;
+    const NodoArbol* candidato; // Hijo cuyo prefijo coincide con el componente
+    size_t indice;              // Su posición en el bloque
+    size_t posicion;            // Índice de la ruta en el lote
+    Etapa etapa;
+};
+
+// Bloques planos cuyos hijos y prefijos se piden enteros a la caché; en los
+// más grandes solo el centro de los prefijos, donde empieza la búsqueda binaria
+const size_t PRECARGA_BLOQUE_MAXIMA = 1024;
+
+// Motor intercalado sobre rutas[desde, hasta): al terminar una búsqueda su
+// lugar lo toma la siguiente ruta, que empieza por la raíz (ya en caché)
+void ArbolSistemaArchivos::buscarIntercalado(const vector<string>& rutas, size_t desde, size_t hasta,
+                                             vector<int>& codigos) {
+    BusquedaEnCurso vuelo[BUSQUEDAS_EN_VUELO];
+    size_t activas = 0, siguiente = desde;
+    auto empezar = [&](BusquedaEnCurso& b) {
+        b = {rutas[siguiente], string_view(), raiz, nullptr, nullptr, 0, siguiente, BusquedaEnCurso::Nodo};
+        siguiente++;
+    };
+    while (activas < BUSQUEDAS_EN_VUELO && siguiente < hasta) empezar(vuelo[activas++]);
+    
+    while (activas > 0) {
+        for (size_t i = 0; i < activas; ) {
+            BusquedaEnCurso& b = vuelo[i];
+            int codigo = -1;
+            switch (b.etapa) {
+                case BusquedaEnCurso::Nodo:
+                    if (!siguienteComponente(b.resto, b.componente)) {
+                        codigo = b.nodo->esArchivo() ? 0 : 2;
+                        break;
+                    }
+                    b.bloque = b.nodo->hijos.leer();
+                    if (b.bloque == nullptr) {
+                        codigo = 1; // Un archivo no tiene hijos
+                        break;
+                    }
+                    __builtin_prefetch(b.bloque);
+                    b.etapa = BusquedaEnCurso::Cabecera;
+                    break;
+                case BusquedaEnCurso::Cabecera: {
+                    const BloqueHijos* bloque = b.bloque;
+                    if (bloque->tam == 0) {
+                        codigo = 1;
+                        break;
+                    }
+                    if (bloque->esSegmentado()) {
+                        __builtin_prefetch(bloque->prefijos() + bloque->segmentos / 2);
+                        b.etapa = BusquedaEnCurso::Segmentado;
+                        break;
+                    }
+                    const char* inicio = reinterpret_cast<const char*>(bloque->datos());
+                    const char* fin = reinterpret_cast<const char*>(bloque->prefijos() + bloque->tam);
+                    if (static_cast<size_t>(fin - inicio) <= PRECARGA_BLOQUE_MAXIMA) {
+                        for (const char* linea = inicio; linea < fin; linea += 64) __builtin_prefetch(linea);
+                    } else {
+                        __builtin_prefetch(bloque->prefijos() + bloque->tam / 2);
+                    }
+                    b.etapa = BusquedaEnCurso::Prefijos;
+                    break;
+                }
+                case BusquedaEnCurso::Prefijos: {
+                    uint64_t clave = prefijoNombre(b.componente);
+                    const uint64_t* prefijos = b.bloque->prefijos();
+                    b.indice = cotaPrefijos(prefijos, b.bloque->tam, clave);
+                    if (b.indice == b.bloque->tam || prefijos[b.indice] != clave) {
+                        codigo = 1;
+                        break;
+                    }
+                    b.candidato = b.bloque->datos()[b.indice];
+                    __builtin_prefetch(b.candidato);
+                    b.etapa = BusquedaEnCurso::Nombre;
+                    break;
+                }
+                case BusquedaEnCurso::Nombre:
+                    __builtin_prefetch(b.candidato->nombre.data());
+                    b.etapa = BusquedaEnCurso::Confirmar;
+                    break;
+                case BusquedaEnCurso::Confirmar: {
+                    CONTAR(comparaciones);
+                    int cmp = b.candidato->nombre.compare(b.componente);
+                    if (cmp == 0) {
+                        b.nodo = b.candidato; // Ya en caché: sigue en este mismo turno
+                        CONTAR(nodosVisitados);
+                        b.etapa = BusquedaEnCurso::Nodo;
+                        continue;
+                    }
+                    // Empate de prefijo con un nombre menor: probar el siguiente
+                    const uint64_t* prefijos = b.bloque->prefijos();
+                    if (cmp < 0 && b.indice + 1 < b.bloque->tam && prefijos[b.indice + 1] == prefijos[b.indice]) {
+                        b.candidato = b.bloque->datos()[++b.indice];
+                        __builtin_prefetch(b.candidato);
+                        b.etapa = BusquedaEnCurso::Nombre;
+                        break;
+                    }
+                    codigo = 1;
+                    break;
+                }
+                case BusquedaEnCurso::Segmentado: {
+                    int indice = busquedaBinaria(b.bloque, b.componente);
+                    if (indice == -1) {
+                        codigo = 1;
+                        break;
+                    }
+                    b.nodo = b.bloque->hijo(static_cast<size_t>(indice));
+                    CONTAR(nodosVisitados);
+                    __builtin_prefetch(b.nodo);
+                    b.etapa = BusquedaEnCurso::Nodo;
+                    break;
+                }
+            }
+            if (codigo == -1) {
+                i++;
+                continue;
+            }
+            
+            codigos[b.posicion] = codigo;
+            if (siguiente < hasta) {
+                empezar(b);
+                i++;
+            } else {
+                b = vuelo[--activas];
+            }
+        }
+    }
+}
+
+// Con el índice hash cada ruta es un solo sondeo: se calculan las huellas de
+// un grupo y se piden sus casillas antes de sondear la primera
+void ArbolSistemaArchivos::buscarIndiceIntercalado(const vector<string>& rutas, size_t desde, size_t hasta,
+                                                   vector<int>& codigos) {
+    HashRuta huellas[BUSQUEDAS_EN_VUELO];
+    string_view ultimos[BUSQUEDAS_EN_VUELO];
+    for (size_t inicio = desde; inicio < hasta; inicio += BUSQUEDAS_EN_VUELO) {
+        size_t cantidad = min(BUSQUEDAS_EN_VUELO, hasta - inicio);
+        for (size_t k = 0; k < cantidad; k++) {
+            huellas[k] = hashRuta(rutas[inicio + k], ultimos[k]);
+            indiceRutas.precargar(huellas[k]);
+        }
+        for (size_t k = 0; k < cantidad; k++) {
+            if (ultimos[k].empty()) {
+                codigos[inicio + k] = 2; // La raíz
+                continue;
+            }
+            NodoArbol* nodo = indiceRutas.buscar(huellas[k]);
+            if (nodo == nullptr) {
+                codigos[inicio + k] = 1;
+                continue;
+            }
+            CONTAR(nodosVisitados);
+            CONTAR(comparaciones);
+            codigos[inicio + k] = nodo->nombre != ultimos[k] ? 1 : nodo->esArchivo() ? 0 : 2;
+        }
+    }
+}
+
+// Repartir el lote en fragmentos: cada uno con su propia sección de lectura en
+// modo concurrente, para no frenar la liberación de lo retirado todo el lote
+vector<int> ArbolSistemaArchivos::buscarLote(const vector<string>& rutas, int numHilos) {
+    vector<int> codigos(rutas.size());
+    if (imagen) {
+        for (size_t i = 0; i < rutas.size(); i++) {
+            codigos[i] = buscar(rutas[i]);
+        }
+        return codigos;
+    }
+    
+    bool conIndice = indiceActivo && !modoConcurrente;
+    auto resolver = [&](size_t desde, size_t hasta) {
+        optional<GuardiaLectura> guardia;
+        if (modoConcurrente) guardia.emplace();
+        if (conIndice) {
+            buscarIndiceIntercalado(rutas, desde, hasta, codigos);
+        } else {
+            buscarIntercalado(rutas, desde, hasta, codigos);
+        }
+    };
+    
+    size_t tamFragmento = FRAGMENTO_BUSQUEDA_LOTE;
+    if (numHilos <= 1 || rutas.size() < 2 * tamFragmento) {
+        for (size_t desde = 0; desde < rutas.size(); desde += tamFragmento) {
+            resolver(desde, min(rutas.size(), desde + tamFragmento));
+        }
+        return codigos;
+    }
+    
+    // Unos cuatro fragmentos por hilo para que el robo de trabajo equilibre
+    size_t porHilo = (rutas.size() + static_cast<size_t>(numHilos) * 4 - 1) / (static_cast<size_t>(numHilos) * 4);
+    tamFragmento = max(tamFragmento, porHilo);
+    PoolTrabajo pool(numHilos);
+    int hilo = 0;
+    for (size_t desde = 0; desde < rutas.size(); desde += tamFragmento) {
+        size_t hasta = min(rutas.size(), desde + tamFragmento);
+        pool.agregar(hilo, [&resolver, desde, hasta](int) { resolver(desde, hasta); });
+        hilo = (hilo + 1) % numHilos;
+    }
+    pool.ejecutar();
+    return codigos;
+}
+
+// Devuelve un subárbol al almacén de forma iterativa (sin recursión)
+void ArbolSistemaArchivos::eliminarSubarbol(NodoArbol* nodo) {
+    if (nodo == nullptr) return;
+    
+    vector<NodoArbol*> pendientes{nodo};
+    while (!pendientes.empty()) {
+        NodoArbol* actual = pendientes.back();
+        pendientes.pop_back();
+        for (NodoArbol* hijo : actual->hijos) {
+            pendientes.push_back(hijo);
+        }
+        if (actual->hijos.bloque != nullptr) {
+            liberarLista(almacen, actual->hijos.bloque);
+        }
+        almacen.liberarNodo(actual);
+    }
+}
+
+// Escribir todo el búfer en el descriptor, reintentando escrituras parciales
+static bool escribirCompleto(int fd, const char* datos, size_t restantes) {
+    while (restantes > 0) {
+        ssize_t escritos = write(fd, datos, restantes);
+        if (escritos < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        datos += escritos;
+        restantes -= static_cast<size_t>(escritos);
+    }
+    return true;
+}
+
+// Guardar con la identidad actual del directorio base
+bool ArbolSistemaArchivos::guardarImagen(const string& archivo) {
+    CabeceraImagen identidad{};
+    ImagenArbol::leerIdentidad(directorioBase, identidad);
+    return guardarImagen(archivo, identidad);
+}
+
+// Guardar el árbol en orden por niveles: cabecera, tabla de nodos, nombres y ruta base.
+// La identidad viene de antes del recorrido: si el directorio cambió durante la
+// carga, la imagen queda vieja y se descarta al abrirla
+bool ArbolSistemaArchivos::guardarImagen(const string& archivo, const CabeceraImagen& identidad) {
+    if (imagen) materializarImagen();
+    
+    vector<NodoArbol*> orden{raiz};
+    uint64_t bytesNombres = 0;
+    for (size_t i = 0; i < orden.size(); i++) {
+        bytesNombres += orden[i]->nombre.size();
+        orden.insert(orden.end(), orden[i]->hijos.begin(), orden[i]->hijos.end());
+    }
+    
+    CabeceraImagen cab = identidad;
+    memcpy(cab.magia, IMAGEN_MAGIA, sizeof(IMAGEN_MAGIA));
+    cab.version = IMAGEN_VERSION;
+    cab.tamNodo = sizeof(NodoImagen);
+    cab.numNodos = orden.size();
+    cab.bytesNombres = bytesNombres;
+    cab.bytesBase = directorioBase.size();
+    
+    string temporal = archivo + ".tmp";
+    int fd = open(temporal.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    
+    // Se escribe por tramos para no duplicar la imagen entera en memoria
+    const size_t TAM_TRAMO = 1 << 20;
+    string bufer;
+    bufer.reserve(TAM_TRAMO + sizeof(NodoImagen));
+    bool correcto = true;
+    auto agregar = [&](const void* datos, size_t tam) {
+        bufer.append(static_cast<const char*>(datos), tam);
+        if (bufer.size() >= TAM_TRAMO) {
+            correcto = correcto && escribirCompleto(fd, bufer.data(), bufer.size());
+            bufer.clear();
+        }
+    };
+    
+    agregar(&cab, sizeof(cab));
+    
+    // Los hijos de cada nodo quedan justo después de los de sus hermanos anteriores
+    uint64_t desplazamiento = 0, siguiente = 1;
+    for (NodoArbol* nodo : orden) {
+        NodoImagen entrada{desplazamiento, static_cast<uint16_t>(nodo->nombre.size()),
+                           static_cast<uint16_t>(nodo->esArchivo() ? 0 : NODO_IMAGEN_DIRECTORIO),
+                           static_cast<uint32_t>(nodo->hijos.size()), siguiente};
+        agregar(&entrada, sizeof(entrada));
+        desplazamiento += nodo->nombre.size();
+        siguiente += nodo->hijos.size();
+    }
+    for (NodoArbol* nodo : orden) {
+        agregar(nodo->nombre.data(), nodo->nombre.size());
+    }
+    agregar(directorioBase.data(), directorioBase.size());
+    correcto = correcto && escribirCompleto(fd, bufer.data(), bufer.size());
+    
+    // El contenido debe estar en disco antes de que el rename lo haga visible
+    correcto = correcto && fdatasync(fd) == 0;
+    if (close(fd) != 0) correcto = false;
+    
+    if (!correcto) {
+        cerr << "Error al escribir la imagen: " << strerror(errno) << endl;
+        unlink(temporal.c_str());
+        return false;
+    }
+    if (rename(temporal.c_str(), archivo.c_str()) != 0) {
+        cerr << "Error al guardar la imagen: " << strerror(errno) << endl;
+        unlink(temporal.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Abrir una imagen vigente sobre un árbol vacío
+bool ArbolSistemaArchivos::abrirImagen(const string& archivo, const string& rutaDirectorio) {
+    if (imagen || !raiz->hijos.empty() || !instantaneas.empty()) return false;
+    
+    auto nueva = make_unique<ImagenArbol>();
+    if (!nueva->abrir(archivo)) return false;
+    
+    error_code ec;
+    string absoluta = filesystem::absolute(rutaDirectorio, ec).string();
+    if (ec || !nueva->esVigente(absoluta)) return false;
+    
+    directorioBase = absoluta;
+    imagen = std::move(nueva);
+    return true;
+}
+
+// Usar la imagen si está vigente; en otro caso recorrer y regenerarla
+bool ArbolSistemaArchivos::cargarConImagen(const string& rutaDirectorio, const string& archivoImagen, int numHilos) {
+    if (abrirImagen(archivoImagen, rutaDirectorio)) {
+        return true;
+    }
+    
+    // La identidad se toma antes de recorrer: un cambio durante la carga deja la imagen vieja
+    CabeceraImagen identidad{};
+    error_code ec;
+    string absoluta = filesystem::absolute(rutaDirectorio, ec).string();
+    if (ec || !ImagenArbol::leerIdentidad(absoluta, identidad)) return false;
+    
+    // Una carga fallida o cortada por el presupuesto no debe quedar como imagen
+    if (!cargarDesdeDirectorio(rutaDirectorio, numHilos)) return false;
+    if (!guardarImagen(archivoImagen, identidad)) {
+        cerr << "No se pudo guardar la imagen en '" << archivoImagen << "'" << endl;
+    }
+    return false;
+}
+
+// Convertir la imagen en nodos del almacén para poder modificar el árbol
+void ArbolSistemaArchivos::materializarImagen() {
+    size_t numNodos = imagen->obtenerNumeroNodos();
+    vector<NodoArbol*> nodos(numNodos);
+    nodos[0] = raiz;
+    for (size_t i = 1; i < numNodos; i++) {
+        nodos[i] = almacen.crearNodo(imagen->nombre(imagen->nodo(i)));
+    }
+    
+    // Los hijos ya vienen ordenados y contiguos en la tabla
+    for (size_t i = 0; i < numNodos; i++) {
+        const NodoImagen& entrada = imagen->nodo(i);
+        if (entrada.banderas & NODO_IMAGEN_DIRECTORIO) nodos[i]->marcarDirectorio();
+        if (entrada.numHijos == 0) continue;
+        
+        nodos[i]->hijos.bloque = construirLista(almacen, nodos.data() + entrada.primerHijo, entrada.numHijos);
+    }
+    
+    // En orden por niveles los hijos van después del padre: de atrás hacia adelante
+    for (size_t i = numNodos; i-- > 0; ) {
+        sumarAgregados(nodos[i]);
+    }
+    imagen.reset();
+}
+
+// Recorrer la imagen construyendo las rutas en el mismo orden que el árbol
+void ArbolSistemaArchivos::obtenerRutasImagen(size_t indice, const string& rutaActual, vector<string>& rutas) {
+    const NodoImagen& entrada = imagen->nodo(indice);
+    
+    string nuevaRuta = rutaActual;
+    if (indice != 0) {
+        if (!nuevaRuta.empty()) nuevaRuta += "/";
+        nuevaRuta += imagen->nombre(entrada);
+        rutas.push_back(nuevaRuta);
+    }
+    
+    for (uint64_t i = 0; i < entrada.numHijos; i++) {
+        obtenerRutasImagen(static_cast<size_t>(entrada.primerHijo + i), nuevaRuta, rutas);
+    }
+}
+
+// Construir o vaciar el índice de rutas completas
+void ArbolSistemaArchivos::activarIndice(bool activo) {
+    indiceRutas.limpiar();
+    indiceActivo = activo && !modoConcurrente && instantaneas.empty();
+    if (!indiceActivo) return;
+    
+    if (imagen) materializarImagen();
+    indexarSubarbol(raiz, HASH_RAIZ, true);
+}
+
+// Agregar (o quitar) del índice todas las rutas bajo 'nodo', cuya huella es 'huella'.
+// Las huellas de los descendientes se extienden desde la del padre, sin armar rutas
+void ArbolSistemaArchivos::indexarSubarbol(NodoArbol* nodo, HashRuta huella, bool agregar) {
+    if (agregar && nodo == raiz) {
+        indiceRutas.reservar(static_cast<size_t>(obtenerNumeroNodos()));
+    }
+    
+    vector<pair<NodoArbol*, HashRuta>> pendientes{{nodo, huella}};
+    while (!pendientes.empty()) {
+        auto [actual, huellaActual] = pendientes.back();
+        pendientes.pop_back();
+        
+        if (actual != raiz) {
+            if (agregar) {
+                indiceRutas.insertar(huellaActual, actual);
+            } else {
+                indiceRutas.eliminar(huellaActual);
+            }
+        }
+        for (NodoArbol* hijo : actual->hijos) {
+            pendientes.push_back({hijo, extenderHash(huellaActual, hijo->nombre, actual == raiz)});
+        }
+    }
+}
+
+// Entrar o salir del modo concurrente (sin lectores activos en este momento)
+void ArbolSistemaArchivos::activarConcurrencia(bool activo) {
+    lock_guard<mutex> guardia(cerrojoEscritura);
+    if (activo) {
+        if (!instantaneas.empty()) {
+            cerr << "No se puede activar el modo concurrente con instantáneas vivas" << endl;
+            return;
+        }
+        if (imagen) materializarImagen();
+        indiceRutas.limpiar();
+        indiceActivo = false;
+    } else {
+        reclamar(true);
+    }
+    modoConcurrente = activo;
+}
+
+// Devolver un bloque reemplazado: de inmediato o, con lectores, al pasar su época
+void ArbolSistemaArchivos::retirarBloque(BloqueHijos* bloque) {
+    if (modoConcurrente) {
+        retirados.push_back({Epocas::avanzar(), bloque, nullptr, nullptr});
+    } else if (!instantaneas.empty()) {
+        if (bloque->clase >= 0) retener(nullptr, bloque, bloque->generacion);
+    } else {
+        almacen.liberarHijos(bloque);
+    }
+}
+
+// Devolver un subárbol desenlazado, con la misma regla que retirarBloque.
+// La versión cambia antes de etiquetarlo: un lector que ya la vea vieja entró
+// antes y el subárbol no se libera mientras siga leyendo
+void ArbolSistemaArchivos::retirarSubarbol(NodoArbol* nodo) {
+    if (!nodo->esArchivo()) versionDirectorios++;
+    if (modoConcurrente) {
+        retirados.push_back({Epocas::avanzar(), nullptr, nodo, nullptr});
+    } else if (!instantaneas.empty()) {
+        retenerSubarbol(nodo);
+    } else {
+        desecharSubarbol(nodo);
+    }
+}
+
+// Devolver solo un nodo desenlazado cuyos hijos pasaron a otro nodo (el de un
+// directorio renombrado): su bloque no se retira
+void ArbolSistemaArchivos::retirarNodo(NodoArbol* nodo) {
+    if (!nodo->esArchivo()) versionDirectorios++;
+    if (modoConcurrente) {
+        retirados.push_back({Epocas::avanzar(), nullptr, nullptr, nodo});
+    } else if (!instantaneas.empty()) {
+        retener(nodo, nullptr, nodo->nacimiento());
+    } else {
+        almacen.liberarNodo(nodo);
+    }
+}
+
+// Liberar un subárbol desenlazado que nadie más ve: en el momento, o en el
+// reclamador si es grande
+void ArbolSistemaArchivos::desecharSubarbol(NodoArbol* nodo) {
+    if (reclamable(nodo)) {
+        reclamador->encolar(nodo, string());
+    } else {
+        eliminarSubarbol(nodo);
+    }
+}
+
+bool ArbolSistemaArchivos::reclamable(const NodoArbol* nodo) const {
+    return reclamador && uint64_t(nodo->agregados.archivos) + nodo->agregados.directorios >= UMBRAL_RECLAMACION;
+}
+
+// Liberar lo retirado que ningún lector activo puede alcanzar (o todo)
+void ArbolSistemaArchivos::reclamar(bool todo) {
+    uint64_t minima = todo ? UINT64_MAX : Epocas::minimaActiva();
+    
+    size_t quedan = 0;
+    for (const Retirado& r : retirados) {
+        if (r.epoca >= minima) {
+            retirados[quedan++] = r;
+        } else if (r.bloque != nullptr) {
+            almacen.liberarHijos(r.bloque);
+        } else if (r.nodo != nullptr) {
+            almacen.liberarNodo(r.nodo);
+        } else {
+            desecharSubarbol(r.subarbol);
+        }
+    }
+    retirados.resize(quedan);
+}
+
+// Un bloque está compartido si nació en o antes de la última instantánea viva
+bool ArbolSistemaArchivos::compartido(const BloqueHijos* bloque) const {
+    return !instantaneas.empty() && bloque->generacion <= *instantaneas.rbegin();
+}
+
+// ¿Alguna instantánea viva se tomó en [desde, hasta)?
+bool ArbolSistemaArchivos::visible(uint64_t desde, uint64_t hasta) const {
+    auto siguiente = instantaneas.lower_bound(desde);
+    return siguiente != instantaneas.end() && *siguiente < hasta;
+}
+
+// Copia propia de un bloque: plano con sus hijos, o segmentado solo con su
+// índice (los segmentos se copian al modificarlos). El vacío compartido pasa
+// a ser un bloque real para que el directorio pueda crecer en su lugar
+BloqueHijos* ArbolSistemaArchivos::copiarBloque(const BloqueHijos* bloque) {
+    BloqueHijos* copia = almacen.reservarHijos(max<int>(bloque->clase, 0));
+    if (bloque->esSegmentado()) {
+        moverEntradas(bloque, 0, bloque->segmentos, copia, 0);
+    } else {
+        moverHijos(bloque, 0, bloque->tam, copia, 0);
+    }
+    copia->tam = bloque->tam;
+    copia->segmentos = bloque->segmentos;
+    return copia;
+}
+
+// Antes de modificar los hijos del último nodo de 'ancestros': copiar desde el
+// primer nodo compartido hasta él (los de más arriba ya son propios), enlazar
+// cada copia en su padre y retener los originales. Sin instantáneas no hace nada
+NodoArbol* ArbolSistemaArchivos::copiarCamino(vector<NodoArbol*>& ancestros) {
+    if (instantaneas.empty()) return ancestros.back();
+    uint64_t ultima = *instantaneas.rbegin();
+    
+    size_t i = 0;
+    while (i < ancestros.size() && ancestros[i]->nacimiento() > ultima) i++;
+    if (i < ancestros.size()) versionDirectorios++;
+    for (; i < ancestros.size(); i++) {
+        NodoArbol* original = ancestros[i];
+        NodoArbol* copia = almacen.crearNodo(string_view());
+        copia->nombre = original->nombre;
+        copia->agregados = original->agregados;
+        copia->hijos.bloque = copiarBloque(original->hijos.bloque);
+        if (i == 0) {
+            raiz = copia;
+        } else {
+            reemplazarHijo(ancestros[i - 1]->hijos, copia);
+        }
+        
+        uint64_t nacido = original->nacimiento();
+        retirarBloque(original->hijos.bloque); // Solo el índice si es segmentado
+        retener(original, nullptr, nacido);
+        ancestros[i] = copia;
+    }
+    return ancestros.back();
+}
+
+// Poner la copia en el lugar del hijo del mismo nombre, en un bloque propio.
+// En un bloque segmentado se copia antes el segmento si está compartido
+void ArbolSistemaArchivos::reemplazarHijo(ListaHijos& hijos, NodoArbol* copia) {
+    BloqueHijos* bloque = hijos.bloque;
+    if (!bloque->esSegmentado()) {
+        bloque->datos()[buscarEnPlano(bloque, copia->nombre)] = copia;
+        return;
+    }
+    
+    EntradaSegmento& entrada = bloque->entradas()[segmentoPorNombre(bloque, copia->nombre)];
+    if (compartido(entrada.segmento)) {
+        BloqueHijos* anterior = entrada.segmento;
+        entrada.segmento = copiarBloque(anterior);
+        retirarBloque(anterior);
+    }
+    entrada.segmento->datos()[buscarEnPlano(entrada.segmento, copia->nombre)] = copia;
+}
+
+// Desenlazar un nodo o un bloque nacido en 'desde': se retiene si alguna
+// instantánea lo ve y si no se libera de inmediato
+void ArbolSistemaArchivos::retener(NodoArbol* nodo, BloqueHijos* bloque, uint64_t desde) {
+    if (visible(desde, generacion)) {
+        retenidos.push_back({desde, generacion, nodo, bloque});
+    } else if (nodo != nullptr) {
+        almacen.liberarNodo(nodo);
+    } else {
+        almacen.liberarHijos(bloque);
+    }
+}
+
+// Retener o liberar cada nodo, índice y segmento de un subárbol desenlazado
+void ArbolSistemaArchivos::retenerSubarbol(NodoArbol* nodo) {
+    vector<NodoArbol*> pendientes{nodo};
+    while (!pendientes.empty()) {
+        NodoArbol* actual = pendientes.back();
+        pendientes.pop_back();
+        for (NodoArbol* hijo : actual->hijos) {
+            pendientes.push_back(hijo);
+        }
+        
+        uint64_t nacido = actual->nacimiento();
+        BloqueHijos* bloque = actual->hijos.bloque;
+        if (bloque != nullptr && bloque->clase >= 0) {
+            for (size_t s = 0; s < bloque->segmentos; s++) {
+                BloqueHijos* segmento = bloque->entradas()[s].segmento;
+                retener(nullptr, segmento, segmento->generacion);
+            }
+            retener(nullptr, bloque, bloque->generacion);
+        }
+        retener(actual, nullptr, nacido);
+    }
+}
+
+// Liberar lo retenido que ya ninguna instantánea viva alcanza
+void ArbolSistemaArchivos::barrerRetenidos() {
+    size_t quedan = 0;
+    for (const Retenido& r : retenidos) {
+        if (visible(r.desde, r.hasta)) {
+            retenidos[quedan++] = r;
+        } else if (r.nodo != nullptr) {
+            almacen.liberarNodo(r.nodo);
+        } else {
+            almacen.liberarHijos(r.bloque);
+        }
+    }
+    retenidos.resize(quedan);
+}
+
+// Empezar a vigilar todos los directorios del árbol
+bool ArbolSistemaArchivos::activarVigilancia() {
+#ifdef __linux__
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (vigilante || directorioBase.empty() || !instantaneas.empty()) return false;
+    if (imagen) materializarImagen();
+    
+    auto nuevo = make_unique<Vigilante>();
+    if (!nuevo->abrir(directorioBase)) return false;
+    vigilante = std::move(nuevo);
+    vigilarSubarbol(raiz, "");
+    
+    // Un directorio sin vigilar dejaría pasar sus cambios en silencio
+    if (vigilante->obtenerFallidas() > 0) {
+        cerr << "No se pudieron vigilar " << vigilante->obtenerFallidas() << " directorios" << endl;
+        vigilante.reset();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Dejar de seguir los cambios externos
+void ArbolSistemaArchivos::desactivarVigilancia() {
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    vigilante.reset();
+}
+
+int ArbolSistemaArchivos::obtenerDescriptorVigilancia() const {
+#ifdef __linux__
+    return vigilante ? vigilante->obtenerDescriptor() : -1;
+#else
+    return -1;
+#endif
+}
+
+// Leer los eventos pendientes (sin cerrojo) y aplicarlos como un escritor más
+int ArbolSistemaArchivos::procesarCambios(int esperaMs) {
+#ifdef __linux__
+    if (!vigilante) return -1;
+    vector<CambioVigilancia> cambios;
+    if (!vigilante->leer(cambios, esperaMs)) return -1;
+    if (cambios.empty()) return 0;
+    
+    unique_lock<mutex> guardia(cerrojoEscritura, defer_lock);
+    if (modoConcurrente) guardia.lock();
+    if (imagen) materializarImagen();
+    
+    for (const CambioVigilancia& cambio : cambios) {
+        switch (cambio.tipo) {
+            case TipoCambio::Creado:
+                agregarDesdeSistema(cambio.ruta);
+                break;
+            case TipoCambio::Eliminado:
+                quitarDesdeSistema(cambio.ruta);
+                break;
+            case TipoCambio::Desborde:
+                // Se perdieron eventos: releer solo los directorios que cambiaron
+                for (const string& ruta : vigilante->directoriosModificados()) {
+                    NodoArbol* nodo = buscarNodo(ruta);
+                    if (nodo != nullptr && !nodo->esArchivo()) {
+                        reconciliarDirectorio(ruta, nodo);
+                    }
+                }
+                break;
+        }
+    }
+    
+    if (modoConcurrente) reclamar(false);
+    if (reclamador) reclamador->recoger(almacen);
+    return static_cast<int>(cambios.size());
+#else
+    return -1;
+#endif
+}
+
+#ifdef __linux__
+// Vigilar los directorios bajo 'nodo' (de forma iterativa)
+void ArbolSistemaArchivos::vigilarSubarbol(NodoArbol* nodo, const string& ruta) {
+    vector<pair<NodoArbol*, string>> pendientes{{nodo, ruta}};
+    while (!pendientes.empty()) {
+        auto [actual, rutaActual] = std::move(pendientes.back());
+        pendientes.pop_back();
+        
+        vigilante->vigilar(rutaActual);
+        for (NodoArbol* hijo : actual->hijos) {
+            if (!hijo->esArchivo()) {
+                pendientes.push_back({hijo, unirRuta(rutaActual, hijo->nombre)});
+            }
+        }
+    }
+}
+
+// Cargar un directorio nuevo todavía no enlazado, vigilándolo antes de listarlo:
+// lo que se cree después llega como evento y se aplica sin duplicar.
+// Iterativo: cada directorio se apila dos veces y en la segunda, con sus
+// subdirectorios ya cargados, suma sus agregados
+void ArbolSistemaArchivos::escanearDirectorio(const string& ruta, NodoArbol* nodo) {
+    struct Pendiente {
+        NodoArbol* nodo;
+        string ruta;
+        bool listado;
+    };
+    vector<Pendiente> pendientes;
+    pendientes.push_back({nodo, ruta, false});
+    vector<NodoArbol*> nuevos, subdirectorios;
+    
+    while (!pendientes.empty()) {
+        Pendiente actual = std::move(pendientes.back());
+        pendientes.pop_back();
+        if (actual.listado) {
+            sumarAgregados(actual.nodo);
+            continue;
+        }
+        
+        vigilante->vigilar(actual.ruta);
+        pendientes.push_back({actual.nodo, actual.ruta, true});
+        
+        int fd = abrirDescriptor(AT_FDCWD, construirRutaCompleta(actual.ruta).c_str());
+        if (fd < 0) continue;
+        nuevos.clear();
+        subdirectorios.clear();
+        listarConGetdents(fd, almacen, capturarTamanos, nuevos, subdirectorios);
+        close(fd);
+        asignarHijosOrdenados(almacen, actual.nodo->hijos, nuevos);
+        
+        for (NodoArbol* subdirectorio : subdirectorios) {
+            pendientes.push_back({subdirectorio, unirRuta(actual.ruta, subdirectorio->nombre), false});
+        }
+    }
+}
+
+// Agregar al árbol una entrada creada afuera. El tipo se toma del sistema de
+// archivos y si la entrada ya no existe se ignora (su eliminación viene detrás)
+void ArbolSistemaArchivos::agregarDesdeSistema(const string& ruta) {
+    struct stat info;
+    if (lstat(construirRutaCompleta(ruta).c_str(), &info) != 0) return;
+    bool esDirectorio = S_ISDIR(info.st_mode);
+    
+    string_view nombre;
+    NodoArbol* padre = buscarPadre(ruta, nombre, &camino);
+    if (padre == nullptr || padre->esArchivo()) return; // Llegará con el escaneo del padre
+    
+    int indice = busquedaBinaria(padre->hijos.bloque, nombre);
+    if (indice != -1) {
+        NodoArbol* existente = padre->hijos[static_cast<size_t>(indice)];
+        if (existente->esArchivo() != esDirectorio) {
+            // Ya estaba (por ejemplo, lo insertó este mismo árbol): falta vigilarlo
+            if (esDirectorio && !vigilante->estaVigilado(ruta)) {
+                vigilante->vigilar(ruta);
+                reconciliarDirectorio(ruta, existente);
+            }
+            return;
+        }
+        quitarDesdeSistema(ruta); // Cambió de tipo (deja en 'camino' los mismos ancestros)
+    }
+    
+    NodoArbol* nuevoNodo = almacen.crearNodo(nombre);
+    if (esDirectorio) {
+        nuevoNodo->marcarDirectorio();
+        escanearDirectorio(ruta, nuevoNodo);
+    } else if (capturarTamanos && S_ISREG(info.st_mode)) {
+        anotarBytes(nuevoNodo, static_cast<uint64_t>(info.st_size));
+    }
+    insertarOrdenado(padre->hijos, nuevoNodo);
+    CambioAgregados cambio;
+    cambio.agregar(nuevoNodo);
+    propagarAgregados(camino, cambio);
+    if (indiceActivo) {
+        string_view ultimo;
+        indexarSubarbol(nuevoNodo, hashRuta(ruta, ultimo), true);
+    }
+}
+
+// Quitar del árbol una entrada eliminada (o movida) afuera
+void ArbolSistemaArchivos::quitarDesdeSistema(const string& ruta) {
+    string_view nombre;
+    NodoArbol* padre = buscarPadre(ruta, nombre, &camino);
+    if (padre == nullptr) return;
+    int indice = busquedaBinaria(padre->hijos.bloque, nombre);
+    if (indice == -1) return;
+    
+    NodoArbol* nodo = padre->hijos[static_cast<size_t>(indice)];
+    if (!nodo->esArchivo()) {
+        vigilante->dejarDeVigilar(ruta);
+        desenlazarManejadores(ruta);
+    }
+    quitarHijo(padre->hijos, indice);
+    CambioAgregados cambio;
+    cambio.quitar(nodo);
+    propagarAgregados(camino, cambio);
+    if (indiceActivo) {
+        string_view ultimo;
+        indexarSubarbol(nodo, hashRuta(ruta, ultimo), false);
+    }
+    retirarSubarbol(nodo);
+}
+
+// Igualar los hijos de un directorio con su contenido actual, recorriendo
+// ambas listas ordenadas a la vez. Solo se relee este directorio: los
+// subdirectorios que no cambiaron conservan sus nodos
+void ArbolSistemaArchivos::reconciliarDirectorio(const string& ruta, NodoArbol* nodo) {
+    int fd = abrirDescriptor(AT_FDCWD, construirRutaCompleta(ruta).c_str());
+    if (fd < 0) return;
+    AlmacenNodos temporal;
+    vector<NodoArbol*> listados, subdirectorios;
+    listarConGetdents(fd, temporal, capturarTamanos, listados, subdirectorios);
+    close(fd);
+    sort(listados.begin(), listados.end(), [](const NodoArbol* a, const NodoArbol* b) {
+        return a->nombre < b->nombre;
+    });
+    
+    HashRuta huella = HASH_RAIZ;
+    if (indiceActivo) {
+        string_view ultimo;
+        huella = hashRuta(ruta, ultimo);
+    }
+    
+    vector<NodoArbol*> nuevos, quitados;
+    vector<int> posiciones;
+    CambioAgregados cambio;
+    size_t tam = nodo->hijos.size();
+    size_t i = 0, j = 0;
+    while (i < listados.size() || j < tam) {
+        int cmp = i == listados.size() ? 1
+                : j == tam ? -1
+                : listados[i]->nombre.compare(nodo->hijos[j]->nombre);
+        NodoArbol* existente = cmp >= 0 ? nodo->hijos[j] : nullptr;
+        bool mismoTipo = cmp == 0 && existente->esArchivo() == listados[i]->esArchivo();
+        
+        if (cmp > 0 || (cmp == 0 && !mismoTipo)) {
+            // Ya no existe (o cambió de tipo): se quita
+            string rutaHijo = unirRuta(ruta, existente->nombre);
+            if (!existente->esArchivo()) {
+                vigilante->dejarDeVigilar(rutaHijo);
+                desenlazarManejadores(rutaHijo);
+            }
+            if (indiceActivo) {
+                indexarSubarbol(existente, extenderHash(huella, existente->nombre, nodo == raiz), false);
+            }
+            posiciones.push_back(static_cast<int>(j));
+            quitados.push_back(existente);
+            cambio.quitar(existente);
+        }
+        if (cmp < 0 || (cmp == 0 && !mismoTipo)) {
+            // Nuevo: se crea en el almacén (y se escanea si es directorio)
+            NodoArbol* nuevoNodo = almacen.crearNodo(listados[i]->nombre);
+            if (!listados[i]->esArchivo()) {
+                nuevoNodo->marcarDirectorio();
+                escanearDirectorio(unirRuta(ruta, nuevoNodo->nombre), nuevoNodo);
+            } else {
+                nuevoNodo->agregados.bytes = listados[i]->agregados.bytes;
+            }
+            nuevos.push_back(nuevoNodo);
+            cambio.agregar(nuevoNodo);
+        }
+        if (mismoTipo && !existente->esArchivo()) {
+            string rutaHijo = unirRuta(ruta, existente->nombre);
+            if (!vigilante->estaVigilado(rutaHijo)) {
+                vigilante->vigilar(rutaHijo);
+                reconciliarDirectorio(rutaHijo, existente);
+            }
+        }
+        
+        if (cmp <= 0) i++;
+        if (cmp >= 0) j++;
+    }
+    
+    quitarHijos(nodo->hijos, posiciones);
+    mezclarHijos(nodo->hijos, nuevos);
+    if (buscarNodo(ruta, &camino) == nodo) propagarAgregados(camino, cambio);
+    for (NodoArbol* quitado : quitados) {
+        retirarSubarbol(quitado);
+    }
+    if (indiceActivo) {
+        for (NodoArbol* nuevoNodo : nuevos) {
+            indexarSubarbol(nuevoNodo, extenderHash(huella, nuevoNodo->nombre, nodo == raiz), true);
+        }
+    }
 }
+#endif
@@ -0,0 +1,217 @@
+#include "vigilante.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Eventos que cambian los nombres de un directorio
+static const uint32_t MASCARA_VIGILANCIA = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                         | IN_ONLYDIR | IN_DONT_FOLLOW;
+
+// Constructor
+Vigilante::Vigilante() : fd(-1), fallidas(0), buffer(1 << 16) {}
+
+// Destructor
+Vigilante::~Vigilante() {
+    cerrar();
+}
+
+// Crear la instancia de inotify (no bloqueante, para vaciar la cola sin esperar)
+bool Vigilante::abrir(const string& base) {
+    if (fd >= 0) return false;
+    
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        cerr << "Error al iniciar inotify: " << strerror(errno) << endl;
+        return false;
+    }
+    directorioBase = base;
+    return true;
+}
+
+// Cerrar el descriptor (el núcleo quita todas las vigilancias)
+void Vigilante::cerrar() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    porDescriptor.clear();
+    porRuta.clear();
+}
+
+// Ruta absoluta de una ruta relativa a la base
+string Vigilante::rutaCompleta(string_view rutaRelativa) const {
+    string ruta = directorioBase;
+    if (!rutaRelativa.empty()) {
+        ruta += '/';
+        ruta += rutaRelativa;
+    }
+    return ruta;
+}
+
+// Quitar un descriptor de las dos tablas
+void Vigilante::olvidar(int descriptor) {
+    auto it = porDescriptor.find(descriptor);
+    if (it == porDescriptor.end()) return;
+    
+    auto itRuta = porRuta.find(it->second.ruta);
+    if (itRuta != porRuta.end() && itRuta->second == descriptor) {
+        porRuta.erase(itRuta);
+    }
+    porDescriptor.erase(it);
+}
+
+// Registrar la vigilancia y anotar el mtime actual del directorio
+bool Vigilante::vigilar(const string& rutaRelativa) {
+    string ruta = rutaCompleta(rutaRelativa);
+    int descriptor = inotify_add_watch(fd, ruta.c_str(), MASCARA_VIGILANCIA);
+    if (descriptor < 0) {
+        // Se informa una sola vez: al agotar max_user_watches fallan todos los siguientes
+        if (fallidas++ == 0) {
+            cerr << "Error al vigilar '" << ruta << "': " << strerror(errno) << endl;
+        }
+        return false;
+    }
+    
+    struct stat info;
+    if (stat(ruta.c_str(), &info) != 0) {
+        info.st_mtim = {};
+    }
+    
+    // El mismo inodo bajo otra ruta (se movió): la vigilancia es la misma
+    olvidar(descriptor);
+    porDescriptor[descriptor] = {rutaRelativa, info.st_mtim.tv_sec, info.st_mtim.tv_nsec};
+    porRuta[rutaRelativa] = descriptor;
+    return true;
+}
+
+bool Vigilante::estaVigilado(string_view rutaRelativa) const {
+    return porRuta.find(rutaRelativa) != porRuta.end();
+}
+
+// Quitar las vigilancias de la ruta y de todas las que empiezan con "ruta/"
+void Vigilante::dejarDeVigilar(string_view rutaRelativa) {
+    vector<int> descriptores;
+    auto itExacto = porRuta.find(rutaRelativa);
+    if (itExacto != porRuta.end()) descriptores.push_back(itExacto->second);
+    
+    string prefijo(rutaRelativa);
+    if (!prefijo.empty()) prefijo += '/';
+    for (auto it = porRuta.lower_bound(prefijo);
+         it != porRuta.end() && it->first.starts_with(prefijo); ++it) {
+        if (it->first != rutaRelativa) descriptores.push_back(it->second);
+    }
+    
+    for (int descriptor : descriptores) {
+        inotify_rm_watch(fd, descriptor);
+        olvidar(descriptor);
+    }
+}
+
+// Reanotar la ruta y las que empiezan con "origen/" bajo 'destino'
+void Vigilante::renombrar(string_view origen, string_view destino) {
+    string prefijo(origen);
+    prefijo += '/';
+    vector<pair<string, int>> movidos;
+    auto itExacto = porRuta.find(origen);
+    if (itExacto != porRuta.end()) movidos.emplace_back(itExacto->first, itExacto->second);
+    for (auto it = porRuta.lower_bound(prefijo);
+         it != porRuta.end() && it->first.starts_with(prefijo); ++it) {
+        movidos.emplace_back(it->first, it->second);
+    }
+    
+    for (const auto& [ruta, descriptor] : movidos) {
+        porRuta.erase(ruta);
+    }
+    for (auto& [ruta, descriptor] : movidos) {
+        string nueva(destino);
+        nueva.append(ruta, origen.size());
+        porDescriptor[descriptor].ruta = nueva;
+        porRuta[std::move(nueva)] = descriptor;
+    }
+}
+
+// Leer los eventos pendientes y traducirlos a cambios con ruta relativa
+bool Vigilante::leer(vector<CambioVigilancia>& cambios, int esperaMs) {
+    if (fd < 0) return false;
+    
+    if (esperaMs != 0) {
+        pollfd espera{fd, POLLIN, 0};
+        if (poll(&espera, 1, esperaMs) < 0 && errno != EINTR) {
+            cerr << "Error al esperar eventos: " << strerror(errno) << endl;
+            return false;
+        }
+    }
+    
+    while (true) {
+        ssize_t leidos = read(fd, buffer.data(), buffer.size());
+        if (leidos < 0) {
+            if (errno == EAGAIN) return true;
+            if (errno == EINTR) continue;
+            cerr << "Error al leer eventos: " << strerror(errno) << endl;
+            return false;
+        }
+        
+        for (ssize_t pos = 0; pos < leidos; ) {
+            auto* evento = reinterpret_cast<inotify_event*>(buffer.data() + pos);
+            pos += static_cast<ssize_t>(sizeof(inotify_event) + evento->len);
+            
+            if (evento->mask & IN_Q_OVERFLOW) {
+                cambios.push_back({TipoCambio::Desborde, false, string()});
+                continue;
+            }
+            if (evento->mask & IN_IGNORED) {
+                olvidar(evento->wd); // El directorio se borró o se quitó la vigilancia
+                continue;
+            }
+            
+            auto it = porDescriptor.find(evento->wd);
+            if (it == porDescriptor.end() || evento->len == 0) continue;
+            
+            string ruta = it->second.ruta;
+            if (!ruta.empty()) ruta += '/';
+            ruta += evento->name;
+            bool esDirectorio = (evento->mask & IN_ISDIR) != 0;
+            
+            if (evento->mask & (IN_CREATE | IN_MOVED_TO)) {
+                cambios.push_back({TipoCambio::Creado, esDirectorio, std::move(ruta)});
+            } else if (evento->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                cambios.push_back({TipoCambio::Eliminado, esDirectorio, std::move(ruta)});
+            }
+        }
+    }
+}
+
+// Comparar el mtime de cada directorio vigilado con el anotado
+vector<string> Vigilante::directoriosModificados() {
+    vector<string> modificados;
+    vector<int> desaparecidos;
+    
+    for (auto& [descriptor, directorio] : porDescriptor) {
+        struct stat info;
+        if (stat(rutaCompleta(directorio.ruta).c_str(), &info) != 0) {
+            desaparecidos.push_back(descriptor);
+            continue;
+        }
+        if (info.st_mtim.tv_sec != directorio.mtimeSeg || info.st_mtim.tv_nsec != directorio.mtimeNs) {
+            directorio.mtimeSeg = info.st_mtim.tv_sec;
+            directorio.mtimeNs = info.st_mtim.tv_nsec;
+            modificados.push_back(directorio.ruta);
+        }
+    }
+    
+    for (int descriptor : desaparecidos) {
+        inotify_rm_watch(fd, descriptor);
+        olvidar(descriptor);
+    }
+    
+    // Los padres antes que los hijos
+    sort(modificados.begin(), modificados.end());
+    return modificados;
+}
+#endif